@@ -0,0 +1,21 @@
+"""Build the imgfilters Python extension (src/pyfilters.c + src/filters.c).
+
+    python3 setup.py build_ext --inplace
+"""
+from setuptools import setup, Extension
+
+imgfilters = Extension(
+    "imgfilters",
+    sources=["src/pyfilters.c", "src/filters.c", "src/pngdec.c"],
+    include_dirs=["src"],
+    extra_compile_args=["-O3", "-std=c11", "-fopenmp"],
+    extra_link_args=["-fopenmp"],
+    libraries=["m"],
+)
+
+setup(
+    name="imgfilters",
+    version="1.0",
+    description="Zero-copy Python bindings for the image filters",
+    ext_modules=[imgfilters],
+)
@@ -0,0 +1,247 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "autotune.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+/*
+ * AUTOTUNING THE PARALLEL DRIVER
+ * ------------------------------
+ *
+ * The best OpenMP configuration depends on the machine (core count,
+ * SMT, cache sizes) and on the workload (image sizes, disk speed).
+ * Instead of a full grid search we do a cheap coordinate search:
+ *
+ *   1) thread count   with schedule(dynamic, 1)
+ *   2) schedule kind  with the best thread count
+ *   3) chunk size     with the best thread count and schedule
+ *
+ * The winner is stored per host in results/profiles/<host key>.json
+ * and picked up automatically by later runs of bin/parallel.
+ */
+
+static void ensure_directory(const char *path) {
+    if (!path) return;
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return;
+        fprintf(stderr, "[autotune] %s exists but is not a directory!\n", path);
+        return;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror("[autotune] mkdir");
+    }
+}
+
+static int extract_int(const char *buf, const char *key) {
+    const char *pos = strstr(buf, key);
+    if (!pos) return -1;
+    const char *colon = strchr(pos, ':');
+    if (!colon) return -1;
+    return atoi(colon + 1);
+}
+
+const char *tune_schedule_name(int schedule) {
+    switch (schedule) {
+    case omp_sched_static:  return "static";
+    case omp_sched_dynamic: return "dynamic";
+    case omp_sched_guided:  return "guided";
+    case omp_sched_auto:    return "auto";
+    default:                return "unknown";
+    }
+}
+
+static void read_cpu_model(char *buf, size_t len) {
+    snprintf(buf, len, "unknown_cpu");
+
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (!f) return;
+
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "model name", 10) != 0) continue;
+        const char *colon = strchr(line, ':');
+        if (!colon) break;
+        colon++;
+        while (*colon == ' ' || *colon == '\t') colon++;
+        snprintf(buf, len, "%s", colon);
+        break;
+    }
+    fclose(f);
+}
+
+int tune_host_key(char *buf, size_t len) {
+    if (!buf || len == 0) return -1;
+
+    char model[256];
+    read_cpu_model(model, sizeof(model));
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+
+    // Keep [A-Za-z0-9.-], collapse everything else into single '_'
+    size_t o = 0;
+    int last_us = 1;
+    for (const char *p = model; *p && o + 1 < len; ++p) {
+        unsigned char ch = (unsigned char)*p;
+        if (isalnum(ch) || ch == '.' || ch == '-') {
+            buf[o++] = (char)ch;
+            last_us = 0;
+        } else if (!last_us) {
+            buf[o++] = '_';
+            last_us = 1;
+        }
+    }
+    if (o > 0 && buf[o - 1] == '_') o--;
+    buf[o] = '\0';
+
+    size_t used = strlen(buf);
+    snprintf(buf + used, len - used, "_%ldc", cores);
+    return 0;
+}
+
+void tune_profile_path(const char *dir, char *buf, size_t len) {
+    char key[256];
+    tune_host_key(key, sizeof(key));
+    snprintf(buf, len, "%s/%s.json", dir, key);
+}
+
+int tune_load_profile(const char *dir, TuneProfile *out) {
+    if (!dir || !out) return 0;
+
+    char path[512];
+    tune_profile_path(dir, path, sizeof(path));
+
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    char buf[2048];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[n] = '\0';
+    fclose(f);
+
+    TuneProfile p;
+    p.threads  = extract_int(buf, "\"threads\"");
+    p.schedule = extract_int(buf, "\"schedule_kind\"");
+    p.chunk    = extract_int(buf, "\"chunk_size\"");
+
+    if (p.threads < 1 || p.schedule < omp_sched_static ||
+        p.schedule > omp_sched_auto || p.chunk < 0) {
+        fprintf(stderr, "[autotune] Ignoring malformed profile %s\n", path);
+        return 0;
+    }
+
+    *out = p;
+    return 1;
+}
+
+int tune_save_profile(const char *dir, const TuneProfile *p, double best_sec) {
+    if (!dir || !p) return -1;
+
+    ensure_directory(dir);
+
+    char key[256];
+    char path[512];
+    tune_host_key(key, sizeof(key));
+    tune_profile_path(dir, path, sizeof(path));
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror("[autotune] fopen profile");
+        return -1;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"host_key\": \"%s\",\n", key);
+    fprintf(f, "  \"threads\": %d,\n", p->threads);
+    fprintf(f, "  \"schedule\": \"%s\",\n", tune_schedule_name(p->schedule));
+    fprintf(f, "  \"schedule_kind\": %d,\n", p->schedule);
+    fprintf(f, "  \"chunk_size\": %d,\n", p->chunk);
+    fprintf(f, "  \"best_sample_wall_time_sec\": %.9f\n", best_sec);
+    fprintf(f, "}\n");
+
+    fclose(f);
+    printf("[autotune] Profile written to %s\n", path);
+    return 0;
+}
+
+static double measure(TuneTrialFn fn, void *ctx, const TuneProfile *p,
+                      int reps) {
+    double best = -1.0;
+    for (int r = 0; r < reps; ++r) {
+        double t = fn(p, ctx);
+        if (t < 0.0) continue;
+        if (best < 0.0 || t < best) best = t;
+    }
+    printf("[autotune]   threads=%-3d schedule=%-7s chunk=%-3d -> %.6f s\n",
+           p->threads, tune_schedule_name(p->schedule), p->chunk, best);
+    return best;
+}
+
+/* Keep cand if it beats *best_t; returns 1 when it does. */
+static int consider(TuneTrialFn fn, void *ctx, const TuneProfile *cand,
+                    int reps, TuneProfile *best, double *best_t) {
+    double t = measure(fn, ctx, cand, reps);
+    if (t < 0.0) return 0;
+    if (*best_t < 0.0 || t < *best_t) {
+        *best   = *cand;
+        *best_t = t;
+        return 1;
+    }
+    return 0;
+}
+
+double tune_search(TuneTrialFn fn, void *ctx, int max_threads, int reps,
+                   TuneProfile *best) {
+    if (!fn || !best) return -1.0;
+    if (max_threads < 1) max_threads = 1;
+    if (reps < 1) reps = 1;
+
+    double best_t = -1.0;
+    TuneProfile cand = { 1, omp_sched_dynamic, 1 };
+    *best = cand;
+
+    // 1) Threads: powers of two plus the maximum itself
+    printf("[autotune] Searching thread count (max %d)\n", max_threads);
+    for (int t = 1; ; t *= 2) {
+        if (t > max_threads) t = max_threads;
+        cand.threads = t;
+        consider(fn, ctx, &cand, reps, best, &best_t);
+        if (t == max_threads) break;
+    }
+
+    // 2) Schedule kind
+    printf("[autotune] Searching schedule kind\n");
+    static const int kinds[] = {
+        omp_sched_static, omp_sched_dynamic, omp_sched_guided
+    };
+    cand = *best;
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); ++k) {
+        if (kinds[k] == best->schedule) continue;
+        cand.schedule = kinds[k];
+        cand.chunk    = (kinds[k] == omp_sched_static) ? 0 : 1;
+        consider(fn, ctx, &cand, reps, best, &best_t);
+    }
+
+    // 3) Chunk size
+    printf("[autotune] Searching chunk size\n");
+    static const int chunks[] = { 0, 1, 2, 4, 8 };
+    cand = *best;
+    for (size_t k = 0; k < sizeof(chunks) / sizeof(chunks[0]); ++k) {
+        if (chunks[k] == best->chunk) continue;
+        cand.chunk = chunks[k];
+        consider(fn, ctx, &cand, reps, best, &best_t);
+    }
+
+    printf("[autotune] Best: threads=%d schedule=%s chunk=%d (%.6f s)\n",
+           best->threads, tune_schedule_name(best->schedule),
+           best->chunk, best_t);
+    return best_t;
+}
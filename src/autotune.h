@@ -0,0 +1,61 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stddef.h>
+
+/**
+ * One point in the tuning space of the parallel driver.
+ *   threads  - OpenMP team size
+ *   schedule - omp_sched_t kind (static, dynamic, guided)
+ *   chunk    - chunk size passed to omp_set_schedule (0 = runtime default)
+ */
+typedef struct {
+    int threads;
+    int schedule;
+    int chunk;
+} TuneProfile;
+
+/**
+ * Callback that runs one benchmark trial with the given profile and
+ * returns its wall time in seconds (negative on failure).
+ */
+typedef double (*TuneTrialFn)(const TuneProfile *p, void *ctx);
+
+/**
+ * Build a filesystem-safe key identifying this host:
+ * "<cpu model>_<online cores>c", e.g. "Intel_R_Xeon_R_CPU_E5-2680_16c".
+ * Returns 0 on success.
+ */
+int tune_host_key(char *buf, size_t len);
+
+/**
+ * Path of the profile file for this host inside dir.
+ */
+void tune_profile_path(const char *dir, char *buf, size_t len);
+
+/**
+ * Load the saved profile for this host from dir.
+ * Returns 1 if a valid profile was found, 0 otherwise.
+ */
+int tune_load_profile(const char *dir, TuneProfile *out);
+
+/**
+ * Save the profile for this host into dir (created if missing).
+ * Returns 0 on success, non-zero on failure.
+ */
+int tune_save_profile(const char *dir, const TuneProfile *p, double best_sec);
+
+/**
+ * Coordinate search over threads, then schedule kind, then chunk size.
+ * Each candidate is measured `reps` times and its best time is kept.
+ * The winning profile is written to *best; returns its wall time.
+ */
+double tune_search(TuneTrialFn fn, void *ctx, int max_threads, int reps,
+                   TuneProfile *best);
+
+/**
+ * Human-readable name of a schedule kind ("static", "dynamic", ...).
+ */
+const char *tune_schedule_name(int schedule);
+
+#endif // AUTOTUNE_H
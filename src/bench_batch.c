@@ -0,0 +1,191 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include "filters.h"
+#include "timer.h"
+
+/*
+ * Benchmark: per-image filters vs apply_pipeline_batch() on a synthetic
+ * set of thumbnails (8x8 .. 64x64, random content).
+ *
+ *   bench_batch [num_images] [batch_size]     (default 1000000, 64)
+ *
+ * Thumbnails are generated one batch at a time so memory stays bounded.
+ * Each batch is processed by both paths from identical inputs; only the
+ * filter calls are timed, and the outputs are compared byte for byte.
+ * Results go to results/logs/batch_metrics.json.
+ */
+
+typedef struct {
+    long long images;
+    long long total_pixels;
+    int       batch_size;
+
+    double    per_image_sec;
+    double    batch_sec;
+    double    per_image_images_per_sec;
+    double    batch_images_per_sec;
+    double    speedup;
+    long long mismatched_images;
+} BatchMetrics;
+
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+static uint32_t xorshift32(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+static Image *make_thumbnail(void) {
+    Image *img = (Image *)malloc(sizeof(Image));
+    if (!img) return NULL;
+    img->width    = 8 + (int)(xorshift32() % 57);
+    img->height   = 8 + (int)(xorshift32() % 57);
+    img->channels = 3;
+    img->type     = SAMPLE_U8;
+
+    size_t size = (size_t)img->width * img->height * 3;
+    img->data = (unsigned char *)malloc(size);
+    if (!img->data) {
+        free(img);
+        return NULL;
+    }
+    for (size_t i = 0; i < size; ++i)
+        img->data[i] = (unsigned char)xorshift32();
+    return img;
+}
+
+static void ensure_directory(const char *path) {
+    if (!path) return;
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return;
+        fprintf(stderr, "[bench_batch] %s exists but is not a directory!\n", path);
+        return;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror("[bench_batch] mkdir");
+    }
+}
+
+static void write_batch_metrics_json(const char *json_path,
+                                     const BatchMetrics *m) {
+    ensure_directory("results");
+    ensure_directory("results/logs");
+
+    FILE *f = fopen(json_path, "w");
+    if (!f) {
+        perror("[bench_batch] fopen metrics json");
+        return;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"variant\": \"batch_thumbnails\",\n");
+    fprintf(f, "  \"metrics\": {\n");
+    fprintf(f, "    \"images\": %lld,\n", m->images);
+    fprintf(f, "    \"total_pixels\": %lld,\n", m->total_pixels);
+    fprintf(f, "    \"batch_size\": %d,\n", m->batch_size);
+    fprintf(f, "    \"per_image_sec\": %.9f,\n", m->per_image_sec);
+    fprintf(f, "    \"batch_sec\": %.9f,\n", m->batch_sec);
+    fprintf(f, "    \"per_image_images_per_sec\": %.3f,\n",
+            m->per_image_images_per_sec);
+    fprintf(f, "    \"batch_images_per_sec\": %.3f,\n", m->batch_images_per_sec);
+    fprintf(f, "    \"speedup\": %.6f,\n", m->speedup);
+    fprintf(f, "    \"mismatched_images\": %lld\n", m->mismatched_images);
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+    printf("[bench_batch] Metrics written to %s\n", json_path);
+}
+
+int main(int argc, char **argv) {
+    long long n_images = 1000000;
+    int batch_size = 64;
+
+    if (argc >= 2) n_images   = atoll(argv[1]);
+    if (argc >= 3) batch_size = atoi(argv[2]);
+    if (n_images <= 0 || batch_size <= 0) {
+        fprintf(stderr, "usage: %s [num_images] [batch_size]\n", argv[0]);
+        return 1;
+    }
+
+    Image **a = (Image **)calloc(batch_size, sizeof(Image *));
+    Image **b = (Image **)calloc(batch_size, sizeof(Image *));
+    if (!a || !b) {
+        fprintf(stderr, "[bench_batch] Out of memory.\n");
+        return 1;
+    }
+
+    BatchMetrics m;
+    memset(&m, 0, sizeof(m));
+    m.batch_size = batch_size;
+
+    for (long long done = 0; done < n_images; ) {
+        int n = (n_images - done < batch_size) ? (int)(n_images - done)
+                                               : batch_size;
+        for (int i = 0; i < n; ++i) {
+            a[i] = make_thumbnail();
+            b[i] = a[i] ? clone_image(a[i]) : NULL;
+            if (!a[i] || !b[i]) {
+                fprintf(stderr, "[bench_batch] Out of memory.\n");
+                return 1;
+            }
+            m.total_pixels += (long long)a[i]->width * a[i]->height;
+        }
+
+        double t0 = wall_time();
+        for (int i = 0; i < n; ++i) {
+            apply_grayscale(a[i]);
+            apply_box_blur(a[i], 2);
+            apply_sobel_edge(a[i]);
+        }
+        double t1 = wall_time();
+        if (apply_pipeline_batch(b, n, 2) != 0) {
+            fprintf(stderr, "[bench_batch] apply_pipeline_batch failed\n");
+            return 1;
+        }
+        double t2 = wall_time();
+
+        m.per_image_sec += t1 - t0;
+        m.batch_sec     += t2 - t1;
+
+        for (int i = 0; i < n; ++i) {
+            size_t size = (size_t)a[i]->width * a[i]->height * 3;
+            if (memcmp(a[i]->data, b[i]->data, size) != 0)
+                m.mismatched_images++;
+            free_image(a[i]);
+            free_image(b[i]);
+        }
+        done += n;
+    }
+    m.images = n_images;
+
+    if (m.per_image_sec > 0.0)
+        m.per_image_images_per_sec = (double)m.images / m.per_image_sec;
+    if (m.batch_sec > 0.0)
+        m.batch_images_per_sec = (double)m.images / m.batch_sec;
+    if (m.batch_sec > 0.0)
+        m.speedup = m.per_image_sec / m.batch_sec;
+
+    printf("[bench_batch] Images            : %lld (batch size %d)\n",
+           m.images, m.batch_size);
+    printf("[bench_batch] Per-image (img/s) : %.1f\n", m.per_image_images_per_sec);
+    printf("[bench_batch] Batched   (img/s) : %.1f\n", m.batch_images_per_sec);
+    printf("[bench_batch] Speedup           : %.3f\n", m.speedup);
+    printf("[bench_batch] Mismatched images : %lld\n", m.mismatched_images);
+
+    write_batch_metrics_json("results/logs/batch_metrics.json", &m);
+
+    free(a);
+    free(b);
+    return m.mismatched_images == 0 ? 0 : 2;
+}
@@ -0,0 +1,282 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include <omp.h>
+
+#include "filters.h"
+#include "ccl.h"
+#include "timer.h"
+
+/*
+ * Benchmark: connected-component labelling of a large synthetic edge
+ * mask (random line segments, like a thresholded Sobel map).
+ *
+ *   bench_ccl [width] [height] [segments] [threads]
+ *             (default 8192 6144 = 50 MP, 200000 segments, all threads)
+ *
+ * label_components() runs with 1 thread and with `threads`. Both results
+ * are compared with a serial pixel flood fill (8-connectivity), which
+ * finds components in the same raster order. Results go to
+ * results/logs/ccl_metrics.json.
+ */
+
+typedef struct {
+    int       width;
+    int       height;
+    int       segments;
+    int       threads;
+    long long set_pixels;
+    long long runs;
+    int       components;
+
+    double    flood_fill_sec;
+    double    one_thread_sec;
+    double    parallel_sec;
+    double    speedup;          // one_thread / parallel
+    double    mpix_per_sec;     // parallel
+    int       mismatches;
+} CclMetrics;
+
+static uint64_t rng_state = 0x853C49E6748FEA9BULL;
+
+static uint32_t xorshift32(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+static int get_bit(const BitMask *m, int x, int y) {
+    return (m->bits[(size_t)y * m->stride + (x >> 3)] >> (7 - (x & 7))) & 1;
+}
+
+static void set_bit(BitMask *m, int x, int y) {
+    m->bits[(size_t)y * m->stride + (x >> 3)] |= (unsigned char)(0x80 >> (x & 7));
+}
+
+static BitMask *make_mask(int width, int height, int segments) {
+    BitMask *m = (BitMask *)malloc(sizeof(BitMask));
+    if (!m) return NULL;
+    m->width  = width;
+    m->height = height;
+    m->stride = ((size_t)width + 7) / 8;
+    m->bits   = (unsigned char *)calloc(m->stride * height, 1);
+    if (!m->bits) {
+        free(m);
+        return NULL;
+    }
+
+    for (int s = 0; s < segments; ++s) {
+        int x  = (int)(xorshift32() % (uint32_t)width);
+        int y  = (int)(xorshift32() % (uint32_t)height);
+        int len = 4 + (int)(xorshift32() % 60);
+        int dx = (int)(xorshift32() % 3) - 1;
+        int dy = (int)(xorshift32() % 3) - 1;
+        if (dx == 0 && dy == 0) dx = 1;
+        for (int i = 0; i < len; ++i) {
+            if (x < 0 || x >= width || y < 0 || y >= height) break;
+            set_bit(m, x, y);
+            x += dx;
+            y += dy;
+        }
+    }
+    return m;
+}
+
+/* Reference: serial 8-connected flood fill in raster order. */
+static ComponentSet *flood_fill(const BitMask *m) {
+    size_t pixels = (size_t)m->width * m->height;
+    unsigned char *seen = (unsigned char *)calloc(pixels, 1);
+    size_t cap = 1 << 16;
+    int *stack = (int *)malloc(cap * 2 * sizeof(int));
+    ComponentSet *set = (ComponentSet *)calloc(1, sizeof(ComponentSet));
+    int items_cap = 1024;
+    if (set) set->items = (Component *)malloc(items_cap * sizeof(Component));
+    if (!seen || !stack || !set || !set->items) {
+        free(seen);
+        free(stack);
+        free_components(set);
+        return NULL;
+    }
+    set->width = m->width;
+    set->height = m->height;
+    set->connectivity = 8;
+
+    for (int y = 0; y < m->height; ++y) {
+        for (int x = 0; x < m->width; ++x) {
+            if (!get_bit(m, x, y) || seen[(size_t)y * m->width + x]) continue;
+            if (set->n == items_cap) {
+                items_cap *= 2;
+                set->items = (Component *)realloc(set->items, items_cap * sizeof(Component));
+                if (!set->items) exit(1);
+            }
+            Component *c = &set->items[set->n++];
+            c->area = 0;
+            c->x0 = c->x1 = x;
+            c->y0 = c->y1 = y;
+
+            size_t top = 0;
+            stack[0] = x;
+            stack[1] = y;
+            top = 1;
+            seen[(size_t)y * m->width + x] = 1;
+            while (top > 0) {
+                --top;
+                int px = stack[2 * top], py = stack[2 * top + 1];
+                c->area++;
+                if (px < c->x0) c->x0 = px;
+                if (px > c->x1) c->x1 = px;
+                if (py < c->y0) c->y0 = py;
+                if (py > c->y1) c->y1 = py;
+                for (int ny = py - 1; ny <= py + 1; ++ny) {
+                    for (int nx = px - 1; nx <= px + 1; ++nx) {
+                        if (nx < 0 || ny < 0 || nx >= m->width || ny >= m->height) continue;
+                        size_t idx = (size_t)ny * m->width + nx;
+                        if (seen[idx] || !get_bit(m, nx, ny)) continue;
+                        seen[idx] = 1;
+                        if (top == cap) {
+                            cap *= 2;
+                            stack = (int *)realloc(stack, cap * 2 * sizeof(int));
+                            if (!stack) exit(1);
+                        }
+                        stack[2 * top]     = nx;
+                        stack[2 * top + 1] = ny;
+                        top++;
+                    }
+                }
+            }
+        }
+    }
+    free(seen);
+    free(stack);
+    return set;
+}
+
+static int count_mismatches(const ComponentSet *a, const ComponentSet *b) {
+    if (!a || !b) return 1;
+    if (a->n != b->n) return 1;
+    int bad = 0;
+    for (int i = 0; i < a->n; ++i)
+        if (memcmp(&a->items[i], &b->items[i], sizeof(Component)) != 0) bad++;
+    return bad;
+}
+
+static void ensure_directory(const char *path) {
+    if (!path) return;
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return;
+        fprintf(stderr, "[bench_ccl] %s exists but is not a directory!\n", path);
+        return;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror("[bench_ccl] mkdir");
+    }
+}
+
+static void write_ccl_metrics_json(const char *json_path, const CclMetrics *m) {
+    ensure_directory("results");
+    ensure_directory("results/logs");
+
+    FILE *f = fopen(json_path, "w");
+    if (!f) {
+        perror("[bench_ccl] fopen metrics json");
+        return;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"variant\": \"ccl_union_find\",\n");
+    fprintf(f, "  \"metrics\": {\n");
+    fprintf(f, "    \"width\": %d,\n", m->width);
+    fprintf(f, "    \"height\": %d,\n", m->height);
+    fprintf(f, "    \"segments\": %d,\n", m->segments);
+    fprintf(f, "    \"threads\": %d,\n", m->threads);
+    fprintf(f, "    \"set_pixels\": %lld,\n", m->set_pixels);
+    fprintf(f, "    \"runs\": %lld,\n", m->runs);
+    fprintf(f, "    \"components\": %d,\n", m->components);
+    fprintf(f, "    \"flood_fill_sec\": %.9f,\n", m->flood_fill_sec);
+    fprintf(f, "    \"one_thread_sec\": %.9f,\n", m->one_thread_sec);
+    fprintf(f, "    \"parallel_sec\": %.9f,\n", m->parallel_sec);
+    fprintf(f, "    \"speedup\": %.6f,\n", m->speedup);
+    fprintf(f, "    \"mpix_per_sec\": %.3f,\n", m->mpix_per_sec);
+    fprintf(f, "    \"mismatches\": %d\n", m->mismatches);
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+    printf("[bench_ccl] Metrics written to %s\n", json_path);
+}
+
+int main(int argc, char **argv) {
+    CclMetrics m;
+    memset(&m, 0, sizeof(m));
+    m.width    = 8192;
+    m.height   = 6144;
+    m.segments = 200000;
+    m.threads  = omp_get_max_threads();
+
+    if (argc >= 2) m.width    = atoi(argv[1]);
+    if (argc >= 3) m.height   = atoi(argv[2]);
+    if (argc >= 4) m.segments = atoi(argv[3]);
+    if (argc >= 5) m.threads  = atoi(argv[4]);
+    if (m.width <= 0 || m.height <= 0 || m.segments < 0 || m.threads <= 0) {
+        fprintf(stderr, "usage: %s [width] [height] [segments] [threads]\n", argv[0]);
+        return 1;
+    }
+
+    BitMask *mask = make_mask(m.width, m.height, m.segments);
+    if (!mask) {
+        fprintf(stderr, "[bench_ccl] Out of memory.\n");
+        return 1;
+    }
+    for (size_t i = 0; i < mask->stride * mask->height; ++i)
+        m.set_pixels += __builtin_popcount(mask->bits[i]);
+
+    double t0 = wall_time();
+    ComponentSet *ref = flood_fill(mask);
+    double t1 = wall_time();
+    omp_set_num_threads(1);
+    ComponentSet *one = label_components(mask, 8);
+    double t2 = wall_time();
+    omp_set_num_threads(m.threads);
+    ComponentSet *par = label_components(mask, 8);
+    double t3 = wall_time();
+
+    if (!ref || !one || !par) {
+        fprintf(stderr, "[bench_ccl] Labelling failed.\n");
+        return 1;
+    }
+    m.flood_fill_sec = t1 - t0;
+    m.one_thread_sec = t2 - t1;
+    m.parallel_sec   = t3 - t2;
+    m.runs           = par->runs;
+    m.components     = par->n;
+    m.mismatches     = count_mismatches(ref, one) + count_mismatches(ref, par);
+    if (m.parallel_sec > 0.0) {
+        m.speedup      = m.one_thread_sec / m.parallel_sec;
+        m.mpix_per_sec = (double)m.width * m.height / 1e6 / m.parallel_sec;
+    }
+
+    printf("[bench_ccl] %dx%d mask, %lld set pixels, %lld runs, %d components\n",
+           m.width, m.height, m.set_pixels, m.runs, m.components);
+    printf("[bench_ccl] Flood fill (reference) : %.4f s\n", m.flood_fill_sec);
+    printf("[bench_ccl] Union-find, 1 thread   : %.4f s\n", m.one_thread_sec);
+    printf("[bench_ccl] Union-find, %d threads  : %.4f s (%.2fx, %.0f MP/s)\n",
+           m.threads, m.parallel_sec, m.speedup, m.mpix_per_sec);
+    printf("[bench_ccl] Mismatched components  : %d\n", m.mismatches);
+
+    write_ccl_metrics_json("results/logs/ccl_metrics.json", &m);
+
+    free_components(ref);
+    free_components(one);
+    free_components(par);
+    free(mask->bits);
+    free(mask);
+    return m.mismatches == 0 ? 0 : 2;
+}
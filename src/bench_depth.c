@@ -0,0 +1,217 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <errno.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "filters.h"
+#include "timer.h"
+
+/*
+ * Benchmark: the gray -> blur -> Sobel pipeline at each sample type.
+ *
+ *   bench_depth [width] [height] [iterations] [radius]
+ *               (default 4000 3000 5 2)
+ *
+ * The same random RGB image is built as u8, u16 and f32 (the f32
+ * values are the u16 ones scaled to [0, 1]). Each iteration restores
+ * the input and times apply_grayscale, apply_box_blur and
+ * apply_sobel_edge separately; the best time of each stage counts.
+ * Threads are whatever OpenMP gives (OMP_NUM_THREADS). Results go to
+ * results/logs/depth_metrics.json.
+ */
+
+#define DEPTH_TYPES 3
+
+typedef struct {
+    SampleType type;
+    double     gray_sec;     // best iteration
+    double     blur_sec;
+    double     sobel_sec;
+    double     gray_mpix_per_sec;
+    double     blur_mpix_per_sec;
+    double     sobel_mpix_per_sec;
+    double     pipeline_mpix_per_sec;   // sum of the three best times
+} DepthResult;
+
+typedef struct {
+    int         width;
+    int         height;
+    int         iterations;
+    int         radius;
+    int         threads;
+    DepthResult types[DEPTH_TYPES];
+} DepthMetrics;
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t xorshift32(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+/* Same pixels for every type: u16 noise, narrowed to u8 or scaled to f32. */
+static Image *make_image(int width, int height, SampleType type) {
+    Image *img = (Image *)malloc(sizeof(Image));
+    if (!img) return NULL;
+    img->width    = width;
+    img->height   = height;
+    img->channels = 3;
+    img->type     = type;
+
+    size_t n = (size_t)width * height * 3;
+    img->data = (unsigned char *)malloc(n * sample_size(type));
+    if (!img->data) {
+        free(img);
+        return NULL;
+    }
+    rng_state = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < n; ++i) {
+        uint16_t v = (uint16_t)xorshift32();
+        switch (type) {
+        case SAMPLE_U16: ((uint16_t *)img->data)[i] = v;                   break;
+        case SAMPLE_F32: ((float *)img->data)[i] = (float)v / 65535.0f;  break;
+        default:         img->data[i] = (unsigned char)(v >> 8);           break;
+        }
+    }
+    return img;
+}
+
+static void ensure_directory(const char *path) {
+    if (!path) return;
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return;
+        fprintf(stderr, "[bench_depth] %s exists but is not a directory!\n", path);
+        return;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror("[bench_depth] mkdir");
+    }
+}
+
+static void write_depth_metrics_json(const char *json_path, const DepthMetrics *m) {
+    ensure_directory("results");
+    ensure_directory("results/logs");
+
+    FILE *f = fopen(json_path, "w");
+    if (!f) {
+        perror("[bench_depth] fopen metrics json");
+        return;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"variant\": \"sample_depth\",\n");
+    fprintf(f, "  \"metrics\": {\n");
+    fprintf(f, "    \"width\": %d,\n", m->width);
+    fprintf(f, "    \"height\": %d,\n", m->height);
+    fprintf(f, "    \"iterations\": %d,\n", m->iterations);
+    fprintf(f, "    \"blur_radius\": %d,\n", m->radius);
+    fprintf(f, "    \"threads\": %d,\n", m->threads);
+    for (int t = 0; t < DEPTH_TYPES; ++t) {
+        const DepthResult *r = &m->types[t];
+        fprintf(f, "    \"%s\": {\n", sample_type_name(r->type));
+        fprintf(f, "      \"gray_sec\": %.9f,\n", r->gray_sec);
+        fprintf(f, "      \"blur_sec\": %.9f,\n", r->blur_sec);
+        fprintf(f, "      \"sobel_sec\": %.9f,\n", r->sobel_sec);
+        fprintf(f, "      \"gray_mpix_per_sec\": %.3f,\n", r->gray_mpix_per_sec);
+        fprintf(f, "      \"blur_mpix_per_sec\": %.3f,\n", r->blur_mpix_per_sec);
+        fprintf(f, "      \"sobel_mpix_per_sec\": %.3f,\n", r->sobel_mpix_per_sec);
+        fprintf(f, "      \"pipeline_mpix_per_sec\": %.3f\n", r->pipeline_mpix_per_sec);
+        fprintf(f, "    }%s\n", t + 1 < DEPTH_TYPES ? "," : "");
+    }
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+    printf("[bench_depth] Metrics written to %s\n", json_path);
+}
+
+/* Best-of-iterations stage times for one sample type. */
+static int bench_type(const DepthMetrics *m, DepthResult *r) {
+    Image *src  = make_image(m->width, m->height, r->type);
+    Image *work = src ? clone_image(src) : NULL;
+    if (!src || !work) {
+        free_image(src);
+        free_image(work);
+        return -1;
+    }
+    size_t bytes = image_bytes(src);
+
+    for (int it = 0; it < m->iterations; ++it) {
+        memcpy(work->data, src->data, bytes);
+
+        double t0 = wall_time();
+        apply_grayscale(work);
+        double t1 = wall_time();
+        apply_box_blur(work, m->radius);
+        double t2 = wall_time();
+        apply_sobel_edge(work);
+        double t3 = wall_time();
+
+        if (it == 0 || t1 - t0 < r->gray_sec)  r->gray_sec  = t1 - t0;
+        if (it == 0 || t2 - t1 < r->blur_sec)  r->blur_sec  = t2 - t1;
+        if (it == 0 || t3 - t2 < r->sobel_sec) r->sobel_sec = t3 - t2;
+    }
+
+    double mpix = (double)m->width * m->height / 1e6;
+    double total = r->gray_sec + r->blur_sec + r->sobel_sec;
+    if (r->gray_sec > 0.0)  r->gray_mpix_per_sec  = mpix / r->gray_sec;
+    if (r->blur_sec > 0.0)  r->blur_mpix_per_sec  = mpix / r->blur_sec;
+    if (r->sobel_sec > 0.0) r->sobel_mpix_per_sec = mpix / r->sobel_sec;
+    if (total > 0.0)        r->pipeline_mpix_per_sec = mpix / total;
+
+    free_image(src);
+    free_image(work);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    DepthMetrics m;
+    memset(&m, 0, sizeof(m));
+    m.width      = 4000;
+    m.height     = 3000;
+    m.iterations = 5;
+    m.radius     = 2;
+    m.threads    = 1;
+#ifdef _OPENMP
+    m.threads    = omp_get_max_threads();
+#endif
+
+    if (argc >= 2) m.width      = atoi(argv[1]);
+    if (argc >= 3) m.height     = atoi(argv[2]);
+    if (argc >= 4) m.iterations = atoi(argv[3]);
+    if (argc >= 5) m.radius     = atoi(argv[4]);
+    if (m.width < 3 || m.height < 3 || m.iterations <= 0 || m.radius < 0) {
+        fprintf(stderr, "usage: %s [width] [height] [iterations] [radius]\n", argv[0]);
+        return 1;
+    }
+
+    const SampleType types[DEPTH_TYPES] = { SAMPLE_U8, SAMPLE_U16, SAMPLE_F32 };
+    printf("[bench_depth] %dx%d, blur radius %d, best of %d, %d threads\n",
+           m.width, m.height, m.radius, m.iterations, m.threads);
+    printf("[bench_depth] type    gray MP/s    blur MP/s   Sobel MP/s    all MP/s\n");
+    for (int t = 0; t < DEPTH_TYPES; ++t) {
+        DepthResult *r = &m.types[t];
+        r->type = types[t];
+        if (bench_type(&m, r) != 0) {
+            fprintf(stderr, "[bench_depth] Out of memory.\n");
+            return 1;
+        }
+        printf("[bench_depth] %-4s %12.1f %12.1f %12.1f %11.1f\n",
+               sample_type_name(r->type), r->gray_mpix_per_sec,
+               r->blur_mpix_per_sec, r->sobel_mpix_per_sec,
+               r->pipeline_mpix_per_sec);
+    }
+
+    write_depth_metrics_json("results/logs/depth_metrics.json", &m);
+    return 0;
+}
@@ -0,0 +1,255 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include <omp.h>
+
+#include "filters.h"
+#include "edgelist.h"
+#include "hough.h"
+#include "timer.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/*
+ * Benchmark: Hough line voting with per-thread accumulators vs one
+ * shared atomic accumulator, on a synthetic image of known lines.
+ *
+ *   bench_hough [width] [height] [lines] [threads]
+ *               (default 4096 4096 12, all threads)
+ *
+ * The image is Sobel-filtered and thresholded into an edge list once.
+ * Runs:
+ *
+ *   private-1   hough_from_edges, 1 thread
+ *   private-N   hough_from_edges, N threads, per-thread accumulators
+ *   atomic-N    hough_from_edges, N threads, one shared accumulator with
+ *               atomic increments
+ *   gradient-N  hough_from_gray, N threads: Sobel in the same pass and
+ *               votes restricted to the gradient angle
+ *
+ * Each run reports votes/sec and how many drawn lines it found. Results
+ * go to results/logs/hough_metrics.json.
+ */
+
+typedef struct {
+    const char *name;
+    double      votes_per_sec;
+    double      sec;            // vote + merge
+    long long   votes;
+    int         found;
+} HoughRun;
+
+typedef struct {
+    int       width;
+    int       height;
+    int       lines;
+    int       threads;
+    long long edge_pixels;
+    HoughRun  runs[4];
+} HoughMetrics;
+
+static uint64_t rng_state = 0xDA942042E4DD58B5ULL;
+
+static uint32_t xorshift32(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+/*
+ * Black image with `n` bright anti-aliased lines (3-pixel core, 1-pixel
+ * ramp) through random points of the image; truth[i] = {rho, theta}.
+ * Angles are centres of the n_theta accumulator bins, so a miss is an
+ * accumulator or peak error, not angular resolution.
+ */
+static Image *make_lines(int width, int height, int n, int n_theta, double (*truth)[2]) {
+    Image *img = (Image *)malloc(sizeof(Image));
+    if (!img) return NULL;
+    img->width    = width;
+    img->height   = height;
+    img->channels = 3;
+    img->type     = SAMPLE_U8;
+    img->data     = (unsigned char *)calloc((size_t)width * height * 3, 1);
+    if (!img->data) {
+        free(img);
+        return NULL;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        double theta = M_PI * (xorshift32() % (uint32_t)n_theta) / n_theta;
+        double c = cos(theta), s = sin(theta);
+        double rho = (xorshift32() % (uint32_t)width) * c +
+                     (xorshift32() % (uint32_t)height) * s;
+        truth[i][0] = rho;
+        truth[i][1] = theta;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                double a = 2.0 - fabs(x * c + y * s - rho);
+                if (a <= 0.0) continue;
+                unsigned char v = (unsigned char)lround((a > 1.0 ? 1.0 : a) * 255.0);
+                unsigned char *p = &img->data[((size_t)y * width + x) * 3];
+                if (v > p[0]) p[0] = p[1] = p[2] = v;
+            }
+        }
+    }
+    return img;
+}
+
+/*
+ * A truth line is found if some reported line is within 1 degree of it
+ * and within 3 pixels of the truth line's point nearest the image centre.
+ */
+static int count_found(const HoughResult *r, double (*truth)[2], int n) {
+    double cx = 0.5 * r->width, cy = 0.5 * r->height;
+    int found = 0;
+    for (int i = 0; i < n; ++i) {
+        double c = cos(truth[i][1]), s = sin(truth[i][1]);
+        double off = truth[i][0] - (cx * c + cy * s);
+        double px = cx + off * c, py = cy + off * s;
+        for (int j = 0; j < r->n; ++j) {
+            double dt = fabs(r->lines[j].theta - truth[i][1]);
+            if (dt > M_PI / 2) dt = M_PI - dt;     // theta wraps at pi
+            double d = px * cos(r->lines[j].theta) + py * sin(r->lines[j].theta) -
+                       r->lines[j].rho;
+            if (dt <= M_PI / 180.0 && fabs(d) <= 3.0) {
+                found++;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+static void ensure_directory(const char *path) {
+    if (!path) return;
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return;
+        fprintf(stderr, "[bench_hough] %s exists but is not a directory!\n", path);
+        return;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror("[bench_hough] mkdir");
+    }
+}
+
+static void write_hough_metrics_json(const char *json_path, const HoughMetrics *m) {
+    ensure_directory("results");
+    ensure_directory("results/logs");
+
+    FILE *f = fopen(json_path, "w");
+    if (!f) {
+        perror("[bench_hough] fopen metrics json");
+        return;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"variant\": \"hough_private_accumulators\",\n");
+    fprintf(f, "  \"metrics\": {\n");
+    fprintf(f, "    \"width\": %d,\n", m->width);
+    fprintf(f, "    \"height\": %d,\n", m->height);
+    fprintf(f, "    \"lines\": %d,\n", m->lines);
+    fprintf(f, "    \"threads\": %d,\n", m->threads);
+    fprintf(f, "    \"edge_pixels\": %lld,\n", m->edge_pixels);
+    fprintf(f, "    \"runs\": [\n");
+    for (int i = 0; i < 4; ++i) {
+        const HoughRun *r = &m->runs[i];
+        fprintf(f, "      {\"name\": \"%s\", \"votes\": %lld, \"sec\": %.9f, "
+                   "\"votes_per_sec\": %.1f, \"lines_found\": %d}%s\n",
+                r->name, r->votes, r->sec, r->votes_per_sec, r->found,
+                (i < 3) ? "," : "");
+    }
+    fprintf(f, "    ]\n");
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+    printf("[bench_hough] Metrics written to %s\n", json_path);
+}
+
+static int record(HoughRun *run, const char *name, HoughResult *r,
+                  double (*truth)[2], int n) {
+    if (!r) {
+        fprintf(stderr, "[bench_hough] %s failed\n", name);
+        return -1;
+    }
+    run->name          = name;
+    run->votes         = r->votes;
+    run->sec           = r->vote_sec + r->merge_sec;
+    run->votes_per_sec = r->votes_per_sec;
+    run->found         = count_found(r, truth, n);
+    printf("[bench_hough] %-10s %12lld votes  %.4f s  %7.1f Mvotes/s  %d/%d lines\n",
+           name, run->votes, run->sec, run->votes_per_sec / 1e6, run->found, n);
+    free_hough(r);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    HoughMetrics m;
+    memset(&m, 0, sizeof(m));
+    m.width   = 4096;
+    m.height  = 4096;
+    m.lines   = 12;
+    m.threads = omp_get_max_threads();
+
+    if (argc >= 2) m.width   = atoi(argv[1]);
+    if (argc >= 3) m.height  = atoi(argv[2]);
+    if (argc >= 4) m.lines   = atoi(argv[3]);
+    if (argc >= 5) m.threads = atoi(argv[4]);
+    if (m.width < 16 || m.height < 16 || m.lines <= 0 || m.threads <= 0) {
+        fprintf(stderr, "usage: %s [width] [height] [lines] [threads]\n", argv[0]);
+        return 1;
+    }
+
+    HoughParams p;
+    hough_default_params(&p);
+    p.max_lines = 4 * m.lines;
+    p.min_votes = m.width / 8;
+    double level = 0.5;
+
+    double (*truth)[2] = malloc(sizeof(double[2]) * m.lines);
+    Image *img = truth ? make_lines(m.width, m.height, m.lines, p.n_theta, truth) : NULL;
+    if (!img) {
+        fprintf(stderr, "[bench_hough] Out of memory.\n");
+        return 1;
+    }
+
+    Image *edge_img = clone_image(img);
+    if (edge_img) apply_sobel_edge(edge_img);
+    EdgeList *edges = edge_img ? edge_list_from_image(edge_img, level) : NULL;
+    free_image(edge_img);
+    if (!edges) {
+        fprintf(stderr, "[bench_hough] Edge extraction failed.\n");
+        return 1;
+    }
+    m.edge_pixels = (long long)edges->count;
+
+    int rc = 0;
+    omp_set_num_threads(1);
+    rc |= record(&m.runs[0], "private-1", hough_from_edges(edges, &p), truth, m.lines);
+    omp_set_num_threads(m.threads);
+    rc |= record(&m.runs[1], "private-N", hough_from_edges(edges, &p), truth, m.lines);
+    p.atomic_votes = 1;
+    rc |= record(&m.runs[2], "atomic-N", hough_from_edges(edges, &p), truth, m.lines);
+    p.atomic_votes = 0;
+    rc |= record(&m.runs[3], "gradient-N", hough_from_gray(img, level, &p), truth, m.lines);
+    edge_list_free(edges);
+
+    printf("[bench_hough] %dx%d, %d lines, %d threads, %lld edge pixels\n",
+           m.width, m.height, m.lines, m.threads, m.edge_pixels);
+    write_hough_metrics_json("results/logs/hough_metrics.json", &m);
+
+    free_image(img);
+    free(truth);
+    return rc == 0 ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include "filters.h"
+#include "pngdec.h"
+#include "stb_image.h"
+#include "timer.h"
+
+/*
+ * Benchmark: PNG decoding, stb_image vs pngdec.
+ *
+ *   bench_png [input_dir] [repeats]   (default data/input 5)
+ *
+ * Every .png in input_dir is read into memory once, then decoded to RGB
+ * `repeats` times by stbi_load_from_memory(.., 3) and by png_decode_rgb8;
+ * the best time of each counts. The two outputs must be identical.
+ * Files pngdec does not handle (16-bit, interlaced, ...) are counted as
+ * fallbacks and left out of the timings. To show what the decode is
+ * worth end to end, grayscale + 3x3 blur + Sobel is also timed on each
+ * image. Metrics go to results/logs/png_metrics.json.
+ */
+
+typedef struct {
+    int       images;
+    int       fallbacks;
+    int       repeats;
+    long long pixels;
+    long long file_bytes;
+
+    double    stb_sec;
+    double    pngdec_sec;
+    double    filter_sec;       // gray + blur + Sobel
+    double    speedup;          // stb / pngdec
+    double    stb_mpix_per_sec;
+    double    pngdec_mpix_per_sec;
+    double    stb_decode_share;     // of decode + filters
+    double    pngdec_decode_share;
+    int       mismatched_images;
+} PngMetrics;
+
+static int ends_with(const char *name, const char *ext) {
+    size_t len_name = strlen(name);
+    size_t len_ext  = strlen(ext);
+    if (len_name < len_ext) return 0;
+    return strcmp(name + len_name - len_ext, ext) == 0;
+}
+
+static unsigned char *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    unsigned char *buf = NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size > 0 && fseek(f, 0, SEEK_SET) == 0) {
+        buf = (unsigned char *)malloc((size_t)size);
+        if (buf && fread(buf, 1, (size_t)size, f) != (size_t)size) {
+            free(buf);
+            buf = NULL;
+        }
+    }
+    fclose(f);
+    *len = (size_t)size;
+    return buf;
+}
+
+static void ensure_directory(const char *path) {
+    if (!path) return;
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return;
+        fprintf(stderr, "[bench_png] %s exists but is not a directory!\n", path);
+        return;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror("[bench_png] mkdir");
+    }
+}
+
+static void write_png_metrics_json(const char *json_path, const PngMetrics *m) {
+    ensure_directory("results");
+    ensure_directory("results/logs");
+
+    FILE *f = fopen(json_path, "w");
+    if (!f) {
+        perror("[bench_png] fopen metrics json");
+        return;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"variant\": \"png_decode\",\n");
+    fprintf(f, "  \"metrics\": {\n");
+    fprintf(f, "    \"unfilter_backend\": \"%s\",\n", png_unfilter_backend());
+    fprintf(f, "    \"images\": %d,\n", m->images);
+    fprintf(f, "    \"fallbacks\": %d,\n", m->fallbacks);
+    fprintf(f, "    \"repeats\": %d,\n", m->repeats);
+    fprintf(f, "    \"pixels\": %lld,\n", m->pixels);
+    fprintf(f, "    \"file_bytes\": %lld,\n", m->file_bytes);
+    fprintf(f, "    \"stb_sec\": %.9f,\n", m->stb_sec);
+    fprintf(f, "    \"pngdec_sec\": %.9f,\n", m->pngdec_sec);
+    fprintf(f, "    \"filter_sec\": %.9f,\n", m->filter_sec);
+    fprintf(f, "    \"speedup\": %.6f,\n", m->speedup);
+    fprintf(f, "    \"stb_mpix_per_sec\": %.3f,\n", m->stb_mpix_per_sec);
+    fprintf(f, "    \"pngdec_mpix_per_sec\": %.3f,\n", m->pngdec_mpix_per_sec);
+    fprintf(f, "    \"stb_decode_share\": %.6f,\n", m->stb_decode_share);
+    fprintf(f, "    \"pngdec_decode_share\": %.6f,\n", m->pngdec_decode_share);
+    fprintf(f, "    \"mismatched_images\": %d\n", m->mismatched_images);
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+    printf("[bench_png] Metrics written to %s\n", json_path);
+}
+
+int main(int argc, char **argv) {
+    const char *input_dir = "data/input";
+    PngMetrics m;
+    memset(&m, 0, sizeof(m));
+    m.repeats = 5;
+
+    if (argc >= 2) input_dir = argv[1];
+    if (argc >= 3) m.repeats = atoi(argv[2]);
+    if (m.repeats <= 0) {
+        fprintf(stderr, "usage: %s [input_dir] [repeats]\n", argv[0]);
+        return 1;
+    }
+
+    DIR *dir = opendir(input_dir);
+    if (!dir) {
+        fprintf(stderr, "[bench_png] Cannot open %s\n", input_dir);
+        return 1;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (!ends_with(ent->d_name, ".png")) continue;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", input_dir, ent->d_name);
+        size_t len = 0;
+        unsigned char *buf = read_file(path, &len);
+        if (!buf) {
+            fprintf(stderr, "[bench_png] Failed to read %s\n", path);
+            continue;
+        }
+
+        int w = 0, h = 0;
+        unsigned char *probe = png_decode_rgb8(buf, len, &w, &h);
+        if (!probe) {
+            printf("[bench_png] %-24s not handled, stb_image fallback\n", ent->d_name);
+            m.fallbacks++;
+            free(buf);
+            continue;
+        }
+        free(probe);
+
+        double best_stb = -1.0, best_fast = -1.0;
+        unsigned char *ref = NULL, *out = NULL;
+        for (int r = 0; r < m.repeats; ++r) {
+            int sw, sh, sc;
+            double t0 = wall_time();
+            unsigned char *a = stbi_load_from_memory(buf, (int)len, &sw, &sh, &sc, 3);
+            double t1 = wall_time();
+            unsigned char *b = png_decode_rgb8(buf, len, &w, &h);
+            double t2 = wall_time();
+            if (!a || !b || sw != w || sh != h) {
+                stbi_image_free(a);
+                free(b);
+                break;
+            }
+            if (best_stb < 0.0 || t1 - t0 < best_stb) best_stb = t1 - t0;
+            if (best_fast < 0.0 || t2 - t1 < best_fast) best_fast = t2 - t1;
+            stbi_image_free(ref);
+            free(out);
+            ref = a;
+            out = b;
+        }
+        free(buf);
+
+        int same = ref && out && memcmp(ref, out, (size_t)w * h * 3) == 0;
+        if (!same) {
+            fprintf(stderr, "[bench_png] %s: pngdec output differs from stb_image\n",
+                    ent->d_name);
+            m.mismatched_images++;
+            stbi_image_free(ref);
+            free(out);
+            continue;
+        }
+
+        Image img = { w, h, 3, SAMPLE_U8, out };
+        double t0 = wall_time();
+        apply_grayscale(&img);
+        apply_box_blur(&img, 1);
+        apply_sobel_edge(&img);
+        double filter_sec = wall_time() - t0;
+
+        printf("[bench_png] %-24s %5dx%-5d stb %8.2f ms  pngdec %8.2f ms  (%.2fx)\n",
+               ent->d_name, w, h, best_stb * 1e3, best_fast * 1e3,
+               best_fast > 0.0 ? best_stb / best_fast : 0.0);
+
+        m.images++;
+        m.pixels     += (long long)w * h;
+        m.file_bytes += (long long)len;
+        m.stb_sec    += best_stb;
+        m.pngdec_sec += best_fast;
+        m.filter_sec += filter_sec;
+        stbi_image_free(ref);
+        free(img.data);
+    }
+    closedir(dir);
+
+    if (m.images == 0) {
+        fprintf(stderr, "[bench_png] No decodable PNGs in %s\n", input_dir);
+        write_png_metrics_json("results/logs/png_metrics.json", &m);
+        return m.mismatched_images == 0 ? 1 : 2;
+    }
+
+    m.speedup             = m.stb_sec / m.pngdec_sec;
+    m.stb_mpix_per_sec    = m.pixels / 1e6 / m.stb_sec;
+    m.pngdec_mpix_per_sec = m.pixels / 1e6 / m.pngdec_sec;
+    m.stb_decode_share    = m.stb_sec / (m.stb_sec + m.filter_sec);
+    m.pngdec_decode_share = m.pngdec_sec / (m.pngdec_sec + m.filter_sec);
+
+    printf("[bench_png] %d PNGs (%.1f MP, %.1f MB), %d fallbacks, unfilter: %s\n",
+           m.images, m.pixels / 1e6, m.file_bytes / 1e6, m.fallbacks,
+           png_unfilter_backend());
+    printf("[bench_png] stb_image : %.4f s (%.0f MP/s)\n", m.stb_sec, m.stb_mpix_per_sec);
+    printf("[bench_png] pngdec    : %.4f s (%.0f MP/s, %.2fx)\n",
+           m.pngdec_sec, m.pngdec_mpix_per_sec, m.speedup);
+    printf("[bench_png] Decode share of decode + gray/blur/Sobel: %.0f%% -> %.0f%%\n",
+           100.0 * m.stb_decode_share, 100.0 * m.pngdec_decode_share);
+    printf("[bench_png] Mismatched images: %d\n", m.mismatched_images);
+
+    write_png_metrics_json("results/logs/png_metrics.json", &m);
+    return m.mismatched_images == 0 ? 0 : 2;
+}
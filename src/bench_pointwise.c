@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include "filters.h"
+#include "timer.h"
+
+/*
+ * Benchmark: a 5-stage pointwise chain
+ *
+ *   grayscale -> gamma -> clamp -> invert -> threshold
+ *
+ * as five apply_* calls (five sweeps) vs apply_tone_fused() (one sweep)
+ * on a synthetic random image.
+ *
+ *   bench_pointwise [width] [height] [iterations] [u8|u16|f32]
+ *                   (default 4096 4096 5 u8)
+ *
+ * Both paths start from identical copies each iteration; only the
+ * filter calls are timed (best of `iterations`), and the outputs are
+ * compared byte for byte. Results go to
+ * results/logs/pointwise_metrics.json.
+ */
+
+typedef struct {
+    int        width;
+    int        height;
+    int        iterations;
+    SampleType type;
+
+    double     unfused_sec;       // best iteration
+    double     fused_sec;
+    double     unfused_mpix_per_sec;
+    double     fused_mpix_per_sec;
+    double     speedup;
+    long long  mismatched_bytes;
+} PointwiseMetrics;
+
+static const ToneParams chain = { 0.8, 0.1, 0.9, 0.5 };
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t xorshift32(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+static Image *make_image(int width, int height, SampleType type) {
+    Image *img = (Image *)malloc(sizeof(Image));
+    if (!img) return NULL;
+    img->width    = width;
+    img->height   = height;
+    img->channels = 3;
+    img->type     = type;
+
+    size_t n = (size_t)width * height * 3;
+    img->data = (unsigned char *)malloc(n * sample_size(type));
+    if (!img->data) {
+        free(img);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t r = xorshift32();
+        switch (type) {
+        case SAMPLE_U16: ((uint16_t *)img->data)[i] = (uint16_t)r;              break;
+        case SAMPLE_F32: ((float *)img->data)[i] = (float)(r & 0xFFFF) / 65535.0f; break;
+        default:         img->data[i] = (unsigned char)r;                       break;
+        }
+    }
+    return img;
+}
+
+static void ensure_directory(const char *path) {
+    if (!path) return;
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return;
+        fprintf(stderr, "[bench_pointwise] %s exists but is not a directory!\n", path);
+        return;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror("[bench_pointwise] mkdir");
+    }
+}
+
+static void write_pointwise_metrics_json(const char *json_path,
+                                         const PointwiseMetrics *m) {
+    ensure_directory("results");
+    ensure_directory("results/logs");
+
+    FILE *f = fopen(json_path, "w");
+    if (!f) {
+        perror("[bench_pointwise] fopen metrics json");
+        return;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"variant\": \"pointwise_fusion\",\n");
+    fprintf(f, "  \"metrics\": {\n");
+    fprintf(f, "    \"chain\": \"grayscale,gamma,clamp,invert,threshold\",\n");
+    fprintf(f, "    \"width\": %d,\n", m->width);
+    fprintf(f, "    \"height\": %d,\n", m->height);
+    fprintf(f, "    \"sample_type\": \"%s\",\n", sample_type_name(m->type));
+    fprintf(f, "    \"iterations\": %d,\n", m->iterations);
+    fprintf(f, "    \"unfused_sec\": %.9f,\n", m->unfused_sec);
+    fprintf(f, "    \"fused_sec\": %.9f,\n", m->fused_sec);
+    fprintf(f, "    \"unfused_mpix_per_sec\": %.3f,\n", m->unfused_mpix_per_sec);
+    fprintf(f, "    \"fused_mpix_per_sec\": %.3f,\n", m->fused_mpix_per_sec);
+    fprintf(f, "    \"speedup\": %.6f,\n", m->speedup);
+    fprintf(f, "    \"mismatched_bytes\": %lld\n", m->mismatched_bytes);
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+    printf("[bench_pointwise] Metrics written to %s\n", json_path);
+}
+
+int main(int argc, char **argv) {
+    PointwiseMetrics m;
+    memset(&m, 0, sizeof(m));
+    m.width      = 4096;
+    m.height     = 4096;
+    m.iterations = 5;
+    m.type       = SAMPLE_U8;
+
+    if (argc >= 2) m.width      = atoi(argv[1]);
+    if (argc >= 3) m.height     = atoi(argv[2]);
+    if (argc >= 4) m.iterations = atoi(argv[3]);
+    if ((argc >= 5 && parse_sample_type(argv[4], &m.type) != 0) ||
+        m.width <= 0 || m.height <= 0 || m.iterations <= 0) {
+        fprintf(stderr, "usage: %s [width] [height] [iterations] [u8|u16|f32]\n",
+                argv[0]);
+        return 1;
+    }
+
+    Image *src = make_image(m.width, m.height, m.type);
+    Image *a   = src ? clone_image(src) : NULL;
+    Image *b   = src ? clone_image(src) : NULL;
+    if (!src || !a || !b) {
+        fprintf(stderr, "[bench_pointwise] Out of memory.\n");
+        return 1;
+    }
+    size_t bytes = image_bytes(src);
+
+    for (int it = 0; it < m.iterations; ++it) {
+        memcpy(a->data, src->data, bytes);
+        memcpy(b->data, src->data, bytes);
+
+        double t0 = wall_time();
+        apply_grayscale(a);
+        apply_gamma(a, chain.gamma);
+        apply_clamp(a, chain.clamp_lo, chain.clamp_hi);
+        apply_invert(a);
+        apply_threshold(a, chain.threshold);
+        double t1 = wall_time();
+        apply_tone_fused(b, &chain);
+        double t2 = wall_time();
+
+        if (it == 0 || t1 - t0 < m.unfused_sec) m.unfused_sec = t1 - t0;
+        if (it == 0 || t2 - t1 < m.fused_sec)   m.fused_sec   = t2 - t1;
+    }
+
+    for (size_t i = 0; i < bytes; ++i)
+        if (a->data[i] != b->data[i]) m.mismatched_bytes++;
+
+    double mpix = (double)m.width * m.height / 1e6;
+    if (m.unfused_sec > 0.0) m.unfused_mpix_per_sec = mpix / m.unfused_sec;
+    if (m.fused_sec > 0.0) {
+        m.fused_mpix_per_sec = mpix / m.fused_sec;
+        m.speedup = m.unfused_sec / m.fused_sec;
+    }
+
+    printf("[bench_pointwise] %dx%d %s, best of %d\n", m.width, m.height,
+           sample_type_name(m.type), m.iterations);
+    printf("[bench_pointwise] Unfused (5 sweeps) : %.6f s (%.1f MP/s)\n",
+           m.unfused_sec, m.unfused_mpix_per_sec);
+    printf("[bench_pointwise] Fused (1 sweep)    : %.6f s (%.1f MP/s)\n",
+           m.fused_sec, m.fused_mpix_per_sec);
+    printf("[bench_pointwise] Speedup            : %.2fx, %lld mismatched bytes\n",
+           m.speedup, m.mismatched_bytes);
+
+    write_pointwise_metrics_json("results/logs/pointwise_metrics.json", &m);
+
+    free_image(src);
+    free_image(a);
+    free_image(b);
+    return m.mismatched_bytes == 0 ? 0 : 1;
+}
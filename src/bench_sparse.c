@@ -0,0 +1,246 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include "filters.h"
+#include "edgelist.h"
+#include "timer.h"
+
+/*
+ * Benchmark: dense edge PNG vs sparse edge list (.sedg) for thresholded
+ * Sobel output.
+ *
+ *   bench_sparse [input_dir] [threshold 0..255]   (default data/input 64)
+ *
+ * Every image is decoded, converted to gray and Sobel-filtered (not
+ * timed), then
+ *
+ *   write  dense: save_image_png      sparse: edge_list_from_image + write
+ *   scan   dense: decode the PNG and  sparse: edge_list_read and walk
+ *          walk every pixel                  the entries
+ *
+ * Both scans count the pixels >= threshold and sum their magnitudes, and
+ * the results must agree. Files go to data/output_sparse/{dense,sparse};
+ * metrics to results/logs/sparse_metrics.json.
+ */
+
+typedef struct {
+    int       images;
+    int       threshold;
+    long long pixels;
+    long long edge_pixels;
+
+    long long dense_bytes;
+    long long sparse_bytes;
+    double    dense_write_sec;
+    double    sparse_write_sec;
+    double    dense_scan_sec;
+    double    sparse_scan_sec;
+    double    bytes_ratio;      // dense / sparse
+    double    scan_speedup;     // dense / sparse
+    int       mismatched_images;
+} SparseMetrics;
+
+static int ends_with(const char *name, const char *ext) {
+    size_t len_name = strlen(name);
+    size_t len_ext  = strlen(ext);
+    if (len_name < len_ext) return 0;
+    return strcmp(name + len_name - len_ext, ext) == 0;
+}
+
+static int is_image_file(const char *name) {
+    return ends_with(name, ".png")  ||
+           ends_with(name, ".jpg")  ||
+           ends_with(name, ".jpeg") ||
+           ends_with(name, ".bmp");
+}
+
+static void ensure_directory(const char *path) {
+    if (!path) return;
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return;
+        fprintf(stderr, "[bench_sparse] %s exists but is not a directory!\n", path);
+        return;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror("[bench_sparse] mkdir");
+    }
+}
+
+static long long file_bytes(const char *path) {
+    struct stat st;
+    return (stat(path, &st) == 0) ? (long long)st.st_size : 0;
+}
+
+static void write_sparse_metrics_json(const char *json_path,
+                                      const SparseMetrics *m) {
+    ensure_directory("results");
+    ensure_directory("results/logs");
+
+    FILE *f = fopen(json_path, "w");
+    if (!f) {
+        perror("[bench_sparse] fopen metrics json");
+        return;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"variant\": \"sparse_edges\",\n");
+    fprintf(f, "  \"metrics\": {\n");
+    fprintf(f, "    \"images\": %d,\n", m->images);
+    fprintf(f, "    \"threshold\": %d,\n", m->threshold);
+    fprintf(f, "    \"pixels\": %lld,\n", m->pixels);
+    fprintf(f, "    \"edge_pixels\": %lld,\n", m->edge_pixels);
+    fprintf(f, "    \"dense_bytes\": %lld,\n", m->dense_bytes);
+    fprintf(f, "    \"sparse_bytes\": %lld,\n", m->sparse_bytes);
+    fprintf(f, "    \"bytes_ratio\": %.6f,\n", m->bytes_ratio);
+    fprintf(f, "    \"dense_write_sec\": %.9f,\n", m->dense_write_sec);
+    fprintf(f, "    \"sparse_write_sec\": %.9f,\n", m->sparse_write_sec);
+    fprintf(f, "    \"dense_scan_sec\": %.9f,\n", m->dense_scan_sec);
+    fprintf(f, "    \"sparse_scan_sec\": %.9f,\n", m->sparse_scan_sec);
+    fprintf(f, "    \"scan_speedup\": %.6f,\n", m->scan_speedup);
+    fprintf(f, "    \"mismatched_images\": %d\n", m->mismatched_images);
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+    printf("[bench_sparse] Metrics written to %s\n", json_path);
+}
+
+/* Downstream consumer of the dense file: decode and scan every pixel. */
+static int scan_dense(const char *path, int threshold,
+                      long long *count, long long *sum) {
+    Image *img = load_image(path);
+    if (!img) return -1;
+    size_t pixels = (size_t)img->width * img->height;
+    for (size_t i = 0; i < pixels; ++i) {
+        unsigned char v = img->data[i * img->channels];
+        if (v >= threshold) {
+            (*count)++;
+            *sum += v;
+        }
+    }
+    free_image(img);
+    return 0;
+}
+
+/* Downstream consumer of the sparse file: read and walk the entries. */
+static int scan_sparse(const char *path, long long *count, long long *sum) {
+    EdgeList *e = edge_list_read(path);
+    if (!e) return -1;
+    for (int y = 0; y < e->height; ++y) {
+        for (uint32_t i = e->row_ptr[y]; i < e->row_ptr[y + 1]; ++i) {
+            (*count)++;
+            *sum += e->mag[i];
+        }
+    }
+    edge_list_free(e);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *input_dir = "data/input";
+    SparseMetrics m;
+    memset(&m, 0, sizeof(m));
+    m.threshold = 64;
+
+    if (argc >= 2) input_dir   = argv[1];
+    if (argc >= 3) m.threshold = atoi(argv[2]);
+    if (m.threshold < 0 || m.threshold > 255) {
+        fprintf(stderr, "usage: %s [input_dir] [threshold 0..255]\n", argv[0]);
+        return 1;
+    }
+
+    DIR *dir = opendir(input_dir);
+    if (!dir) {
+        fprintf(stderr, "[bench_sparse] Cannot open %s\n", input_dir);
+        return 1;
+    }
+    ensure_directory("data");
+    ensure_directory("data/output_sparse");
+    ensure_directory("data/output_sparse/dense");
+    ensure_directory("data/output_sparse/sparse");
+
+    double level = m.threshold / 255.0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (!is_image_file(ent->d_name)) continue;
+
+        char in_path[512], dense_path[512], sparse_path[512];
+        snprintf(in_path, sizeof(in_path), "%s/%s", input_dir, ent->d_name);
+        snprintf(dense_path, sizeof(dense_path),
+                 "data/output_sparse/dense/%s.png", ent->d_name);
+        snprintf(sparse_path, sizeof(sparse_path),
+                 "data/output_sparse/sparse/%s.sedg", ent->d_name);
+
+        Image *img = load_image(in_path);
+        if (!img) {
+            fprintf(stderr, "[bench_sparse] Failed to load %s\n", in_path);
+            continue;
+        }
+        apply_grayscale(img);
+        apply_sobel_edge(img);
+
+        double t0 = wall_time();
+        int dense_ok = save_image_png(dense_path, img) == 0;
+        double t1 = wall_time();
+        EdgeList *e = edge_list_from_image(img, level);
+        int sparse_ok = e && edge_list_write(sparse_path, e) == 0;
+        double t2 = wall_time();
+        m.dense_write_sec  += t1 - t0;
+        m.sparse_write_sec += t2 - t1;
+        m.pixels += (long long)img->width * img->height;
+        edge_list_free(e);
+        free_image(img);
+        if (!dense_ok || !sparse_ok) {
+            m.mismatched_images++;
+            continue;
+        }
+
+        long long dense_count = 0, dense_sum = 0;
+        long long sparse_count = 0, sparse_sum = 0;
+        t0 = wall_time();
+        int rc_dense = scan_dense(dense_path, m.threshold, &dense_count, &dense_sum);
+        t1 = wall_time();
+        int rc_sparse = scan_sparse(sparse_path, &sparse_count, &sparse_sum);
+        t2 = wall_time();
+        m.dense_scan_sec  += t1 - t0;
+        m.sparse_scan_sec += t2 - t1;
+
+        if (rc_dense != 0 || rc_sparse != 0 ||
+            dense_count != sparse_count || dense_sum != sparse_sum)
+            m.mismatched_images++;
+        m.edge_pixels  += sparse_count;
+        m.dense_bytes  += file_bytes(dense_path);
+        m.sparse_bytes += file_bytes(sparse_path);
+        m.images++;
+    }
+    closedir(dir);
+
+    if (m.images == 0) {
+        fprintf(stderr, "[bench_sparse] No images in %s\n", input_dir);
+        return 1;
+    }
+    if (m.sparse_bytes > 0) m.bytes_ratio = (double)m.dense_bytes / m.sparse_bytes;
+    if (m.sparse_scan_sec > 0.0) m.scan_speedup = m.dense_scan_sec / m.sparse_scan_sec;
+
+    printf("[bench_sparse] %d images, threshold %d, %.2f%% edge pixels\n",
+           m.images, m.threshold,
+           m.pixels ? 100.0 * m.edge_pixels / m.pixels : 0.0);
+    printf("[bench_sparse] Bytes   dense %lld  sparse %lld  (%.1fx smaller)\n",
+           m.dense_bytes, m.sparse_bytes, m.bytes_ratio);
+    printf("[bench_sparse] Write   dense %.4f s  sparse %.4f s\n",
+           m.dense_write_sec, m.sparse_write_sec);
+    printf("[bench_sparse] Scan    dense %.4f s  sparse %.4f s  (%.1fx faster)\n",
+           m.dense_scan_sec, m.sparse_scan_sec, m.scan_speedup);
+    printf("[bench_sparse] Mismatched images : %d\n", m.mismatched_images);
+
+    write_sparse_metrics_json("results/logs/sparse_metrics.json", &m);
+    return m.mismatched_images == 0 ? 0 : 2;
+}
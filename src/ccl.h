@@ -0,0 +1,46 @@
+#ifndef CCL_H
+#define CCL_H
+
+#include "filters.h"
+
+/**
+ * One connected component of a mask: pixel count and inclusive
+ * bounding box.
+ */
+typedef struct {
+    long long area;
+    int       x0, y0;
+    int       x1, y1;
+} Component;
+
+/**
+ * All components of a mask, ordered by their first pixel in raster
+ * order (so the result does not depend on the thread count).
+ */
+typedef struct {
+    int        width;
+    int        height;
+    int        connectivity;   // 4 or 8
+    int        strips;         // row strips labelled in parallel
+    long long  runs;           // horizontal runs of set pixels
+    int        n;
+    Component *items;
+} ComponentSet;
+
+/**
+ * Label the set pixels of mask with 4- or 8-connectivity. Rows are
+ * split into one strip per OpenMP thread, each strip is labelled with
+ * its own union-find over runs, then the strip seams are merged.
+ * Returns NULL on failure.
+ */
+ComponentSet *label_components(const BitMask *mask, int connectivity);
+
+/**
+ * Write the component list as JSON (area and bbox per component).
+ * Returns 0 on success.
+ */
+int write_components_json(const char *path, const ComponentSet *set);
+
+void free_components(ComponentSet *set);
+
+#endif // CCL_H
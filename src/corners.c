@@ -0,0 +1,240 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "corners.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#define CORNER_PARALLEL_FOR _Pragma("omp parallel for schedule(static)")
+#define CORNER_RESPONSE_FOR _Pragma("omp parallel for schedule(static) reduction(max:best)")
+#else
+#define CORNER_PARALLEL_FOR
+#define CORNER_RESPONSE_FOR
+#endif
+
+/*
+ * HARRIS / SHI-TOMASI CORNERS
+ * ---------------------------
+ *
+ * Input is the Sobel gradient field that apply_sobel_edge_gradients
+ * keeps, so a branch that writes edges and corners runs Sobel once.
+ *
+ *   1. tensor    gx^2, gx gy, gy^2 per pixel, stored as the three
+ *                channels of an f32 Image                   (parallel)
+ *   2. window    apply_box_blur on that image: the same separable
+ *                box filter as the blur stage
+ *   3. response  Harris det - k trace^2, or Shi-Tomasi min eigenvalue;
+ *                the strongest response sets the threshold  (parallel)
+ *   4. suppress  a pixel above the threshold is kept if it is the
+ *                maximum of its (2r + 1)^2 neighbourhood; rows are
+ *                counted, prefix-summed and emitted, like edgelist.c,
+ *                so the list comes out in raster order      (parallel)
+ *   5. select    sort by response, keep max_corners
+ *
+ * Ties in step 4 go to the first pixel in raster order, so plateaus
+ * give one corner and the output does not depend on the thread count.
+ */
+
+void corner_default_params(CornerParams *p) {
+    p->method      = CORNER_HARRIS;
+    p->k           = 0.04;
+    p->window      = 2;
+    p->quality     = 0.01;
+    p->nms_radius  = 3;
+    p->max_corners = 500;
+}
+
+static Image *tensor_image(const SobelGradients *g) {
+    Image *t = (Image *)malloc(sizeof(Image));
+    if (!t) return NULL;
+    size_t pixels = (size_t)g->width * g->height;
+    t->width    = g->width;
+    t->height   = g->height;
+    t->channels = 3;
+    t->type     = SAMPLE_F32;
+    t->data     = (unsigned char *)malloc(pixels * 3 * sizeof(float));
+    if (!t->data) {
+        free(t);
+        return NULL;
+    }
+
+    float *m = (float *)t->data;
+    const float *gx = g->gx;
+    const float *gy = g->gy;
+    CORNER_PARALLEL_FOR
+    for (size_t i = 0; i < pixels; ++i) {
+        m[3 * i + 0] = gx[i] * gx[i];
+        m[3 * i + 1] = gx[i] * gy[i];
+        m[3 * i + 2] = gy[i] * gy[i];
+    }
+    return t;
+}
+
+/* Keep (x, y) if r[y][x] beats every earlier and ties no later neighbour. */
+static int is_local_max(const float *r, int w, int h, int x, int y, int radius) {
+    float v = r[(size_t)y * w + x];
+    int y0 = (y - radius < 0) ? 0 : y - radius;
+    int y1 = (y + radius >= h) ? h - 1 : y + radius;
+    int x0 = (x - radius < 0) ? 0 : x - radius;
+    int x1 = (x + radius >= w) ? w - 1 : x + radius;
+    for (int yy = y0; yy <= y1; ++yy) {
+        const float *row = r + (size_t)yy * w;
+        for (int xx = x0; xx <= x1; ++xx) {
+            float u = row[xx];
+            if (u > v) return 0;
+            if (u == v && (yy < y || (yy == y && xx < x))) return 0;
+        }
+    }
+    return 1;
+}
+
+static int compare_keypoints(const void *pa, const void *pb) {
+    const Keypoint *a = (const Keypoint *)pa;
+    const Keypoint *b = (const Keypoint *)pb;
+    if (a->response != b->response) return (a->response < b->response) ? 1 : -1;
+    if (a->y != b->y) return (a->y > b->y) ? 1 : -1;
+    return (a->x > b->x) - (a->x < b->x);
+}
+
+KeypointList *detect_corners(const SobelGradients *g, const CornerParams *p) {
+    if (!g || !g->gx || !g->gy || !p || g->width <= 0 || g->height <= 0) return NULL;
+    int w = g->width;
+    int h = g->height;
+    size_t pixels = (size_t)w * h;
+
+    // 1-2. windowed structure tensor
+    Image *t = tensor_image(g);
+    float *resp = (float *)malloc(pixels * sizeof(float));
+    uint32_t *row_n = (uint32_t *)malloc(((size_t)h + 1) * sizeof(uint32_t));
+    KeypointList *kp = (KeypointList *)calloc(1, sizeof(KeypointList));
+    if (!t || !resp || !row_n || !kp) {
+        fprintf(stderr, "[corners] Out of memory.\n");
+        free_image(t);
+        free(resp);
+        free(row_n);
+        free(kp);
+        return NULL;
+    }
+    if (p->window > 0) apply_box_blur(t, p->window);
+    if (filter_budget_exceeded()) {
+        free_image(t);
+        free(resp);
+        free(row_n);
+        free(kp);
+        return NULL;
+    }
+
+    // 3. response
+    const float *m = (const float *)t->data;
+    float k = (float)p->k;
+    int shi_tomasi = (p->method == CORNER_SHI_TOMASI);
+    float best = 0.0f;
+    CORNER_RESPONSE_FOR
+    for (size_t i = 0; i < pixels; ++i) {
+        float a = m[3 * i + 0], b = m[3 * i + 1], c = m[3 * i + 2];
+        float r;
+        if (shi_tomasi) {
+            float half = 0.5f * (a - c);
+            r = 0.5f * (a + c) - sqrtf(half * half + b * b);
+        } else {
+            float tr = a + c;
+            r = a * c - b * b - k * tr * tr;
+        }
+        resp[i] = r;
+        if (r > best) best = r;
+    }
+    free_image(t);
+
+    float threshold = (float)(p->quality * best);
+    if (best <= 0.0f) threshold = INFINITY;   // flat image: no corners
+    int radius = (p->nms_radius > 0) ? p->nms_radius : 0;
+
+    // 4. suppress: count, scan, emit
+    CORNER_PARALLEL_FOR
+    for (int y = 0; y < h; ++y) {
+        const float *row = resp + (size_t)y * w;
+        uint32_t n = 0;
+        for (int x = 0; x < w; ++x)
+            if (row[x] >= threshold && is_local_max(resp, w, h, x, y, radius)) n++;
+        row_n[y + 1] = n;
+    }
+    row_n[0] = 0;
+    for (int y = 0; y < h; ++y) row_n[y + 1] += row_n[y];
+
+    int total = (int)row_n[h];
+    kp->width     = w;
+    kp->height    = h;
+    kp->method    = p->method;
+    kp->threshold = threshold;
+    kp->items     = (Keypoint *)malloc((size_t)(total ? total : 1) * sizeof(Keypoint));
+    if (!kp->items) {
+        fprintf(stderr, "[corners] Out of memory.\n");
+        free(resp);
+        free(row_n);
+        free(kp);
+        return NULL;
+    }
+    Keypoint *items = kp->items;
+
+    CORNER_PARALLEL_FOR
+    for (int y = 0; y < h; ++y) {
+        const float *row = resp + (size_t)y * w;
+        uint32_t o = row_n[y];
+        for (int x = 0; x < w; ++x) {
+            if (row[x] < threshold || !is_local_max(resp, w, h, x, y, radius)) continue;
+            items[o].x        = x;
+            items[o].y        = y;
+            items[o].response = row[x];
+            o++;
+        }
+    }
+    free(resp);
+    free(row_n);
+
+    // 5. select
+    qsort(items, (size_t)total, sizeof(Keypoint), compare_keypoints);
+    kp->n = (p->max_corners > 0 && total > p->max_corners) ? p->max_corners : total;
+    return kp;
+}
+
+int write_keypoints_json(const char *path, const KeypointList *k) {
+    if (!path || !k) return -1;
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "[corners] Failed to open %s\n", path);
+        return -1;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"width\": %d,\n", k->width);
+    fprintf(f, "  \"height\": %d,\n", k->height);
+    fprintf(f, "  \"method\": \"%s\",\n",
+            (k->method == CORNER_SHI_TOMASI) ? "shi_tomasi" : "harris");
+    fprintf(f, "  \"threshold\": %g,\n", isinf(k->threshold) ? 0.0 : k->threshold);
+    fprintf(f, "  \"corners\": %d,\n", k->n);
+    fprintf(f, "  \"keypoints\": [");
+    for (int i = 0; i < k->n; ++i) {
+        const Keypoint *c = &k->items[i];
+        fprintf(f, "%s\n    {\"x\": %d, \"y\": %d, \"response\": %g}",
+                i ? "," : "", c->x, c->y, c->response);
+    }
+    fprintf(f, "%s]\n", k->n ? "\n  " : "");
+    fprintf(f, "}\n");
+
+    if (fclose(f) != 0) {
+        fprintf(stderr, "[corners] Failed to write %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+void free_keypoints(KeypointList *k) {
+    if (!k) return;
+    free(k->items);
+    free(k);
+}
@@ -0,0 +1,58 @@
+#ifndef CORNERS_H
+#define CORNERS_H
+
+#include "filters.h"
+
+typedef enum {
+    CORNER_HARRIS = 0,     // det(M) - k trace(M)^2
+    CORNER_SHI_TOMASI      // smaller eigenvalue of M
+} CornerMethod;
+
+/**
+ * Corner settings. M is the structure tensor [gx^2 gxgy; gxgy gy^2]
+ * box-averaged over a (2 window + 1)^2 neighbourhood.
+ */
+typedef struct {
+    CornerMethod method;
+    double       k;            // Harris sensitivity
+    int          window;       // box radius for the tensor products
+    double       quality;      // keep responses >= quality * strongest
+    int          nms_radius;   // non-maximum suppression radius
+    int          max_corners;  // strongest to keep, <= 0 = all
+} CornerParams;
+
+typedef struct {
+    int   x;
+    int   y;
+    float response;
+} Keypoint;
+
+typedef struct {
+    int           width;
+    int           height;
+    CornerMethod  method;
+    double        threshold;    // absolute response cut-off used
+    int           n;
+    Keypoint     *items;        // strongest first
+} KeypointList;
+
+/**
+ * Harris, k = 0.04, window 2, quality 0.01, suppression radius 3,
+ * 500 corners.
+ */
+void corner_default_params(CornerParams *p);
+
+/**
+ * Detect corners from Sobel gradients (apply_sobel_edge_gradients or
+ * sobel_gradients). Returns NULL on failure.
+ */
+KeypointList *detect_corners(const SobelGradients *g, const CornerParams *p);
+
+/**
+ * Write keypoints as JSON. Returns 0 on success.
+ */
+int write_keypoints_json(const char *path, const KeypointList *k);
+
+void free_keypoints(KeypointList *k);
+
+#endif // CORNERS_H
@@ -0,0 +1,218 @@
+#define _GNU_SOURCE
+
+#include "cpubudget.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+ * CONTAINER-AWARE CPU BUDGET
+ * --------------------------
+ *
+ * omp_get_max_threads() defaults to the number of online CPUs, which in
+ * a container is the host's count. Two kernel mechanisms cap what we
+ * can really use:
+ *
+ *   - cpuset / affinity: the set of CPUs we may run on at all
+ *     (sched_getaffinity)
+ *   - CFS bandwidth quota: quota microseconds of CPU per period across
+ *     all threads, e.g. "800000 100000" in cpu.max = 8 CPUs' worth
+ *
+ * Running 128 threads under an 8-CPU quota burns the quota in the first
+ * ~6 ms of each 100 ms period and then every thread is throttled until
+ * the next one. We therefore size the pool to min(affinity, ceil(quota)).
+ *
+ * cgroup v2 (unified) is read from /sys/fs/cgroup/<path>/cpu.max, with
+ * cgroup v1 cpu.cfs_quota_us / cpu.cfs_period_us as fallback. Parent
+ * cgroups can hold a tighter limit, so we walk up to the root and keep
+ * the smallest quota.
+ */
+
+#define CGROUP_ROOT "/sys/fs/cgroup"
+
+static int is_directory(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+/*
+ * Find our cgroup path from /proc/self/cgroup. For v2 the line is
+ * "0::/path"; for v1 we want the hierarchy whose controllers include
+ * "cpu". Returns 0 on success.
+ */
+static int own_cgroup_path(int version, char *out, size_t out_size) {
+    FILE *f = fopen("/proc/self/cgroup", "r");
+    if (!f) return -1;
+
+    char line[1024];
+    int found = -1;
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        char *c1 = strchr(line, ':');
+        if (!c1) continue;
+        char *c2 = strchr(c1 + 1, ':');
+        if (!c2) continue;
+        *c2 = '\0';
+        const char *controllers = c1 + 1;
+        const char *path = c2 + 1;
+
+        int match = 0;
+        if (version == 2) {
+            match = (strncmp(line, "0:", 2) == 0 && controllers[0] == '\0');
+        } else {
+            char list[256];
+            snprintf(list, sizeof(list), "%s", controllers);
+            for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ","))
+                if (strcmp(tok, "cpu") == 0) match = 1;
+        }
+        if (match) {
+            snprintf(out, out_size, "%s", path);
+            found = 0;
+            break;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+/* Join mount root and cgroup path; fall back to the root when the path
+ * is not visible (cgroup namespaces show "/" or a host path). */
+static void cgroup_dir(const char *root, const char *path, char *out, size_t size) {
+    snprintf(out, size, "%s%s", root, strcmp(path, "/") == 0 ? "" : path);
+    if (!is_directory(out))
+        snprintf(out, size, "%s", root);
+}
+
+/* Strip the last path component; returns 0 once dir is at the root. */
+static int parent_dir(char *dir, const char *root) {
+    if (strcmp(dir, root) == 0) return 0;
+    char *slash = strrchr(dir, '/');
+    if (!slash || slash == dir) return 0;
+    *slash = '\0';
+    return strlen(dir) >= strlen(root);
+}
+
+/* Smallest quota (in CPUs) from dir up to root, 0 if unlimited. */
+static double walk_quota(char *dir, const char *root, int version) {
+    double best = 0.0;
+    do {
+        char path[600];
+        double quota = 0.0;
+
+        if (version == 2) {
+            snprintf(path, sizeof(path), "%s/cpu.max", dir);
+            FILE *f = fopen(path, "r");
+            if (f) {
+                char max[32];
+                long long period = 0;
+                if (fscanf(f, "%31s %lld", max, &period) == 2 &&
+                    strcmp(max, "max") != 0 && period > 0)
+                    quota = atof(max) / (double)period;
+                fclose(f);
+            }
+        } else {
+            long long q = -1, period = 0;
+            snprintf(path, sizeof(path), "%s/cpu.cfs_quota_us", dir);
+            FILE *f = fopen(path, "r");
+            if (f) {
+                if (fscanf(f, "%lld", &q) != 1) q = -1;
+                fclose(f);
+            }
+            snprintf(path, sizeof(path), "%s/cpu.cfs_period_us", dir);
+            f = fopen(path, "r");
+            if (f) {
+                if (fscanf(f, "%lld", &period) != 1) period = 0;
+                fclose(f);
+            }
+            if (q > 0 && period > 0)
+                quota = (double)q / (double)period;
+        }
+
+        if (quota > 0.0 && (best == 0.0 || quota < best))
+            best = quota;
+    } while (parent_dir(dir, root));
+    return best;
+}
+
+void cpu_budget_detect(CpuBudget *b) {
+    if (!b) return;
+    memset(b, 0, sizeof(*b));
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    b->online_cpus = (online > 0) ? (int)online : 1;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        b->affinity_cpus = CPU_COUNT(&set);
+    if (b->affinity_cpus <= 0)
+        b->affinity_cpus = b->online_cpus;
+
+    char path[256];
+    char dir[512];
+    const char *v1_roots[] = { CGROUP_ROOT "/cpu,cpuacct", CGROUP_ROOT "/cpu" };
+
+    if (access(CGROUP_ROOT "/cgroup.controllers", F_OK) == 0 &&
+        own_cgroup_path(2, path, sizeof(path)) == 0) {
+        cgroup_dir(CGROUP_ROOT, path, b->cgroup_dir, sizeof(b->cgroup_dir));
+        b->cgroup_version = 2;
+        snprintf(dir, sizeof(dir), "%s", b->cgroup_dir);
+        b->quota_cpus = walk_quota(dir, CGROUP_ROOT, 2);
+    } else if (own_cgroup_path(1, path, sizeof(path)) == 0) {
+        for (int i = 0; i < 2; ++i) {
+            if (!is_directory(v1_roots[i])) continue;
+            cgroup_dir(v1_roots[i], path, b->cgroup_dir, sizeof(b->cgroup_dir));
+            b->cgroup_version = 1;
+            snprintf(dir, sizeof(dir), "%s", b->cgroup_dir);
+            b->quota_cpus = walk_quota(dir, v1_roots[i], 1);
+            break;
+        }
+    }
+
+    b->effective_cpus = b->online_cpus;
+    b->source = "online";
+    if (b->affinity_cpus < b->effective_cpus) {
+        b->effective_cpus = b->affinity_cpus;
+        b->source = "affinity";
+    }
+    if (b->quota_cpus > 0.0) {
+        int q = (int)ceil(b->quota_cpus - 1e-9);
+        if (q < 1) q = 1;
+        if (q < b->effective_cpus) {
+            b->effective_cpus = q;
+            b->source = (b->cgroup_version == 2) ? "cgroup_v2" : "cgroup_v1";
+        }
+    }
+}
+
+int cpu_throttle_read(const CpuBudget *b, CpuThrottleStats *out) {
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
+    if (!b || b->cgroup_version == 0) return -1;
+
+    char path[600];
+    snprintf(path, sizeof(path), "%s/cpu.stat", b->cgroup_dir);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    char key[64];
+    long long value;
+    while (fscanf(f, "%63s %lld", key, &value) == 2) {
+        if (strcmp(key, "nr_periods") == 0)
+            out->nr_periods = value;
+        else if (strcmp(key, "nr_throttled") == 0)
+            out->nr_throttled = value;
+        else if (strcmp(key, "throttled_usec") == 0)      // v2
+            out->throttled_sec = (double)value * 1e-6;
+        else if (strcmp(key, "throttled_time") == 0)      // v1, ns
+            out->throttled_sec = (double)value * 1e-9;
+    }
+    fclose(f);
+    out->available = 1;
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef CPUBUDGET_H
+#define CPUBUDGET_H
+
+/**
+ * CPUs this process may actually use, combining the online count, the
+ * scheduler affinity mask (cpuset) and the cgroup CPU bandwidth quota.
+ */
+typedef struct {
+    int    online_cpus;     // sysconf(_SC_NPROCESSORS_ONLN)
+    int    affinity_cpus;   // CPUs in sched_getaffinity() mask
+    double quota_cpus;      // cgroup quota / period, 0 = unlimited
+    int    effective_cpus;  // min(affinity, ceil(quota)), at least 1
+    const char *source;     // what limited it: "online", "affinity",
+                            // "cgroup_v2" or "cgroup_v1"
+    int    cgroup_version;  // 0 = no cpu controller found
+    char   cgroup_dir[512]; // directory holding cpu.max / cpu.stat
+} CpuBudget;
+
+/**
+ * Throttling counters from the cgroup's cpu.stat.
+ */
+typedef struct {
+    int       available;
+    long long nr_periods;
+    long long nr_throttled;
+    double    throttled_sec;
+} CpuThrottleStats;
+
+/**
+ * Detect the CPU budget of the calling process. Never fails: missing
+ * cgroup files just leave the quota unlimited.
+ */
+void cpu_budget_detect(CpuBudget *b);
+
+/**
+ * Read the current throttling counters for b's cgroup.
+ * Returns 0 on success, -1 if cpu.stat is unavailable.
+ */
+int cpu_throttle_read(const CpuBudget *b, CpuThrottleStats *out);
+
+#endif // CPUBUDGET_H
@@ -0,0 +1,446 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "dedup.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <omp.h>
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+/*
+ * DUPLICATE INPUTS
+ * ----------------
+ *
+ * Burst shots and re-uploads would otherwise each pay the full
+ * decode -> filters -> encode cost. Two tiers, both claimed from the
+ * worker threads while the list is processed:
+ *
+ *   exact   before decode: size + 64-bit hash of the file bytes, looked
+ *           up in a sharded table (one omp_lock_t per shard, as in
+ *           image_cache.c). A hit is confirmed byte for byte, so a hash
+ *           collision can never link the wrong output.
+ *   near    after decode (DEDUP_NEAR): dHash of the decoded image, which
+ *           samples 9 x 8 x 64 pixels instead of reducing the image.
+ *           Lookup is multi-index hashing: the 64 bits are cut into 8
+ *           bytes, and two hashes within distance 7 share at least one
+ *           byte, so only owners filed under one of the 8 byte values
+ *           are compared.
+ *
+ * The first input of a group to claim it owns it; the rest get copies
+ * of its outputs once the pass is done (dedup_link_file: a reflink
+ * where the filesystem has them, else a byte copy). Which near
+ * duplicate becomes the owner depends on thread timing; exact groups
+ * always have identical outputs anyway.
+ */
+
+#define DEDUP_SHARDS     16
+#define DEDUP_BUCKETS    256
+#define DEDUP_BANDS      8
+#define DEDUP_READ_CHUNK (64 * 1024)
+
+typedef struct FileEntry {
+    uint64_t          hash;
+    long long         size;
+    int               owner;
+    struct FileEntry *next;
+} FileEntry;
+
+typedef struct {
+    omp_lock_t  lock;
+    FileEntry  *buckets[DEDUP_BUCKETS];
+} FileShard;
+
+typedef struct {
+    int *items;
+    int  n, cap;
+} OwnerList;
+
+struct DedupIndex {
+    const char  *input_dir;
+    char *const *names;
+    int          n;
+    DedupMode    mode;
+    int          max_distance;
+
+    FileShard    shards[DEDUP_SHARDS];
+
+    omp_lock_t   near_lock;
+    OwnerList    bands[DEDUP_BANDS][256];
+    uint64_t    *dhash;          // per input, valid once claimed by image
+    int         *width;
+    int         *height;
+
+    int         *owner;          // per input: owner index or -1
+    double      *cost;           // per input: seconds (dedup_set_cost)
+    int          exact;
+    int          near;
+    int          fallbacks;
+    double       hash_sec;
+};
+
+const char *dedup_mode_name(DedupMode mode) {
+    switch (mode) {
+    case DEDUP_EXACT: return "exact";
+    case DEDUP_NEAR:  return "near";
+    default:          return "off";
+    }
+}
+
+DedupIndex *dedup_create(const char *input_dir, char *const *names, int n,
+                         DedupMode mode, int max_distance) {
+    if (!input_dir || !names || n <= 0 || mode == DEDUP_OFF) return NULL;
+
+    DedupIndex *d = (DedupIndex *)calloc(1, sizeof(DedupIndex));
+    if (!d) return NULL;
+    d->input_dir    = input_dir;
+    d->names        = names;
+    d->n            = n;
+    d->mode         = mode;
+    d->max_distance = (max_distance < 0) ? 0 : (max_distance > 7) ? 7 : max_distance;
+    d->dhash  = (uint64_t *)calloc(n, sizeof(uint64_t));
+    d->width  = (int *)calloc(n, sizeof(int));
+    d->height = (int *)calloc(n, sizeof(int));
+    d->owner  = (int *)malloc(n * sizeof(int));
+    d->cost   = (double *)calloc(n, sizeof(double));
+    if (!d->dhash || !d->width || !d->height || !d->owner || !d->cost) {
+        free(d->dhash);
+        free(d->width);
+        free(d->height);
+        free(d->owner);
+        free(d->cost);
+        free(d);
+        return NULL;
+    }
+    for (int s = 0; s < DEDUP_SHARDS; ++s) omp_init_lock(&d->shards[s].lock);
+    omp_init_lock(&d->near_lock);
+    dedup_reset(d);
+    return d;
+}
+
+void dedup_reset(DedupIndex *d) {
+    if (!d) return;
+    for (int s = 0; s < DEDUP_SHARDS; ++s) {
+        for (int b = 0; b < DEDUP_BUCKETS; ++b) {
+            FileEntry *e = d->shards[s].buckets[b];
+            while (e) {
+                FileEntry *next = e->next;
+                free(e);
+                e = next;
+            }
+            d->shards[s].buckets[b] = NULL;
+        }
+    }
+    for (int b = 0; b < DEDUP_BANDS; ++b)
+        for (int v = 0; v < 256; ++v) d->bands[b][v].n = 0;
+    for (int i = 0; i < d->n; ++i) {
+        d->owner[i] = -1;
+        d->cost[i]  = 0.0;
+    }
+    d->exact = d->near = d->fallbacks = 0;
+    d->hash_sec = 0.0;
+}
+
+static void input_path(const DedupIndex *d, int index, char *buf, size_t len) {
+    snprintf(buf, len, "%s/%s", d->input_dir, d->names[index]);
+}
+
+/* Size and 64-bit hash of a file's bytes. Returns 0 on success. */
+static int hash_file(const char *path, uint64_t *hash, long long *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    unsigned char *buf = (unsigned char *)malloc(DEDUP_READ_CHUNK);
+    if (!buf) {
+        fclose(f);
+        return -1;
+    }
+
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    long long total = 0;
+    size_t got;
+    while ((got = fread(buf, 1, DEDUP_READ_CHUNK, f)) > 0) {
+        size_t i = 0;
+        for (; i + 8 <= got; i += 8) {
+            uint64_t w;
+            memcpy(&w, buf + i, 8);
+            h = (h ^ w) * 0xBF58476D1CE4E5B9ULL;
+            h ^= h >> 31;
+        }
+        for (; i < got; ++i) {
+            h = (h ^ buf[i]) * 0x94D049BB133111EBULL;
+            h ^= h >> 29;
+        }
+        total += (long long)got;
+    }
+    int err = ferror(f);
+    free(buf);
+    fclose(f);
+    if (err) return -1;
+    *hash = h ^ (uint64_t)total;
+    *size = total;
+    return 0;
+}
+
+static int files_equal(const char *a, const char *b) {
+    FILE *fa = fopen(a, "rb");
+    FILE *fb = fopen(b, "rb");
+    unsigned char *ba = (unsigned char *)malloc(DEDUP_READ_CHUNK);
+    unsigned char *bb = (unsigned char *)malloc(DEDUP_READ_CHUNK);
+    int equal = (fa && fb && ba && bb);
+    while (equal) {
+        size_t na = fread(ba, 1, DEDUP_READ_CHUNK, fa);
+        size_t nb = fread(bb, 1, DEDUP_READ_CHUNK, fb);
+        if (na != nb || memcmp(ba, bb, na) != 0) equal = 0;
+        if (na == 0) break;
+    }
+    if (equal && (ferror(fa) || ferror(fb))) equal = 0;
+    free(ba);
+    free(bb);
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return equal;
+}
+
+int dedup_claim_file(DedupIndex *d, int index) {
+    if (!d || index < 0 || index >= d->n) return -1;
+
+    char path[512];
+    input_path(d, index, path, sizeof(path));
+    double t0 = wall_time();
+    uint64_t hash;
+    long long size;
+    int rc = hash_file(path, &hash, &size);
+    double t1 = wall_time();
+#pragma omp atomic
+    d->hash_sec += t1 - t0;
+    if (rc != 0) return -1;   // the decoder reports the error
+
+    FileShard *s = &d->shards[hash % DEDUP_SHARDS];
+    size_t bucket = (hash / DEDUP_SHARDS) % DEDUP_BUCKETS;
+    int owner = -1;
+    omp_set_lock(&s->lock);
+    FileEntry *e = s->buckets[bucket];
+    while (e && !(e->hash == hash && e->size == size)) e = e->next;
+    if (e) {
+        owner = e->owner;
+    } else {
+        e = (FileEntry *)malloc(sizeof(FileEntry));
+        if (e) {
+            e->hash  = hash;
+            e->size  = size;
+            e->owner = index;
+            e->next  = s->buckets[bucket];
+            s->buckets[bucket] = e;
+        }
+    }
+    omp_unset_lock(&s->lock);
+    if (owner < 0 || owner == index) return -1;
+
+    char owner_path[512];
+    input_path(d, owner, owner_path, sizeof(owner_path));
+    if (!files_equal(owner_path, path)) return -1;   // hash collision
+
+    d->owner[index] = owner;
+#pragma omp atomic
+    d->exact++;
+    return owner;
+}
+
+static inline double luma_at(const Image *img, int x, int y) {
+    size_t i = ((size_t)y * img->width + x) * img->channels;
+    double r, g, b;
+    switch (img->type) {
+    case SAMPLE_U16: {
+        const uint16_t *p = (const uint16_t *)img->data + i;
+        r = p[0] / 65535.0; g = p[1] / 65535.0; b = p[2] / 65535.0;
+        break;
+    }
+    case SAMPLE_F32: {
+        const float *p = (const float *)img->data + i;
+        r = p[0]; g = p[1]; b = p[2];
+        break;
+    }
+    default: {
+        const unsigned char *p = img->data + i;
+        r = p[0] / 255.0; g = p[1] / 255.0; b = p[2] / 255.0;
+        break;
+    }
+    }
+    return 0.299 * r + 0.587 * g + 0.114 * b;
+}
+
+uint64_t dhash_image(const Image *img) {
+    if (!img || !img->data || img->channels < 3 || img->width <= 0 || img->height <= 0)
+        return 0;
+
+    // mean luminance of 9 x 8 cells, from up to 8 x 8 samples per cell
+    double cell[8][9];
+    for (int cy = 0; cy < 8; ++cy) {
+        for (int cx = 0; cx < 9; ++cx) {
+            double sum = 0.0;
+            for (int sy = 0; sy < 8; ++sy) {
+                int y = (int)(((cy * 8 + sy) * 2 + 1) * (long long)img->height / 128);
+                for (int sx = 0; sx < 8; ++sx) {
+                    int x = (int)(((cx * 8 + sx) * 2 + 1) * (long long)img->width / 144);
+                    sum += luma_at(img, x, y);
+                }
+            }
+            cell[cy][cx] = sum;
+        }
+    }
+
+    uint64_t h = 0;
+    for (int cy = 0; cy < 8; ++cy)
+        for (int cx = 0; cx < 8; ++cx)
+            h = (h << 1) | (cell[cy][cx] > cell[cy][cx + 1]);
+    return h;
+}
+
+static int owner_list_push(OwnerList *l, int index) {
+    if (l->n == l->cap) {
+        int cap = l->cap ? l->cap * 2 : 4;
+        int *grown = (int *)realloc(l->items, cap * sizeof(int));
+        if (!grown) return -1;
+        l->items = grown;
+        l->cap   = cap;
+    }
+    l->items[l->n++] = index;
+    return 0;
+}
+
+int dedup_claim_image(DedupIndex *d, int index, const Image *img) {
+    if (!d || d->mode != DEDUP_NEAR || !img || index < 0 || index >= d->n) return -1;
+
+    double t0 = wall_time();
+    uint64_t h = dhash_image(img);
+    double t1 = wall_time();
+#pragma omp atomic
+    d->hash_sec += t1 - t0;
+
+    int owner = -1;
+    omp_set_lock(&d->near_lock);
+    for (int b = 0; b < DEDUP_BANDS; ++b) {
+        const OwnerList *l = &d->bands[b][(h >> (8 * b)) & 0xFF];
+        for (int k = 0; k < l->n; ++k) {
+            int o = l->items[k];
+            if (o == index) {              // claimed before (deferred retry)
+                omp_unset_lock(&d->near_lock);
+                return -1;
+            }
+            if (d->width[o] != img->width || d->height[o] != img->height) continue;
+            if (__builtin_popcountll(d->dhash[o] ^ h) > d->max_distance) continue;
+            if (owner < 0 || o < owner) owner = o;
+        }
+    }
+    if (owner < 0) {
+        d->dhash[index]  = h;
+        d->width[index]  = img->width;
+        d->height[index] = img->height;
+        for (int b = 0; b < DEDUP_BANDS; ++b)
+            owner_list_push(&d->bands[b][(h >> (8 * b)) & 0xFF], index);
+    }
+    omp_unset_lock(&d->near_lock);
+    if (owner < 0) return -1;
+
+    d->owner[index] = owner;
+#pragma omp atomic
+    d->near++;
+    return owner;
+}
+
+void dedup_set_cost(DedupIndex *d, int index, double sec) {
+    if (!d || index < 0 || index >= d->n) return;
+    d->cost[index] = sec;
+}
+
+/* An exact owner can itself be a near duplicate: follow to the root. */
+static int root_owner(const DedupIndex *d, int index) {
+    int o = d->owner[index];
+    while (o >= 0 && d->owner[o] >= 0) o = d->owner[o];
+    return o;
+}
+
+int dedup_owner(const DedupIndex *d, int index) {
+    if (!d || index < 0 || index >= d->n) return -1;
+    return root_owner(d, index);
+}
+
+void dedup_unlink(DedupIndex *d, int index) {
+    if (!d || index < 0 || index >= d->n || d->owner[index] < 0) return;
+    d->owner[index] = -1;
+#pragma omp atomic
+    d->fallbacks++;
+}
+
+static int copy_file(const char *src, const char *dst) {
+    FILE *in = fopen(src, "rb");
+    if (!in) return -1;
+    FILE *out = fopen(dst, "wb");
+    unsigned char *buf = (unsigned char *)malloc(DEDUP_READ_CHUNK);
+    int rc = (out && buf) ? 0 : -1;
+    size_t got;
+    while (rc == 0 && (got = fread(buf, 1, DEDUP_READ_CHUNK, in)) > 0)
+        if (fwrite(buf, 1, got, out) != got) rc = -1;
+    if (ferror(in)) rc = -1;
+    free(buf);
+    fclose(in);
+    if (out && fclose(out) != 0) rc = -1;
+    return rc;
+}
+
+/*
+ * Not link(2): the writers reopen outputs with "wb", so a later run
+ * without --dedup would write one input's result into both names.
+ */
+int dedup_link_file(const char *src, const char *dst) {
+    if (!src || !dst) return -1;
+    if (unlink(dst) != 0 && errno != ENOENT) return -1;
+#ifdef FICLONE
+    int in = open(src, O_RDONLY);
+    if (in >= 0) {
+        int out = open(dst, O_WRONLY | O_CREAT | O_EXCL, 0644);
+        int rc = (out >= 0) ? ioctl(out, FICLONE, in) : -1;
+        if (out >= 0) close(out);
+        close(in);
+        if (rc == 0) return 0;
+        if (out >= 0) unlink(dst);   // no reflinks here: copy instead
+    }
+#endif
+    return copy_file(src, dst);
+}
+
+void dedup_stats(const DedupIndex *d, DedupStats *out) {
+    memset(out, 0, sizeof(*out));
+    if (!d) return;
+    out->exact     = d->exact;
+    out->near      = d->near;
+    out->fallbacks = d->fallbacks;
+    out->hash_sec  = d->hash_sec;
+    for (int i = 0; i < d->n; ++i) {
+        int o = root_owner(d, i);
+        if (o >= 0) out->saved_sec += d->cost[o] - d->cost[i];
+    }
+}
+
+void dedup_destroy(DedupIndex *d) {
+    if (!d) return;
+    dedup_reset(d);
+    for (int s = 0; s < DEDUP_SHARDS; ++s) omp_destroy_lock(&d->shards[s].lock);
+    omp_destroy_lock(&d->near_lock);
+    for (int b = 0; b < DEDUP_BANDS; ++b)
+        for (int v = 0; v < 256; ++v) free(d->bands[b][v].items);
+    free(d->dhash);
+    free(d->width);
+    free(d->height);
+    free(d->owner);
+    free(d->cost);
+    free(d);
+}
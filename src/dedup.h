@@ -0,0 +1,96 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stdint.h>
+#include "filters.h"
+
+/**
+ * Duplicate-input index for one pass over a file list. Inputs are
+ * identified by their position in the list. The first input of a group
+ * to claim it becomes the owner; later ones are linked to its outputs
+ * instead of being processed. Thread-safe.
+ */
+typedef struct DedupIndex DedupIndex;
+
+typedef enum {
+    DEDUP_OFF = 0,
+    DEDUP_EXACT,      // byte-identical files
+    DEDUP_NEAR        // also dHash within max_distance, same dimensions
+} DedupMode;
+
+typedef struct {
+    int    exact;          // byte-identical inputs, linked before decode
+    int    near;           // near duplicates, linked after decode
+    int    fallbacks;      // owner failed: duplicate processed after all
+    double hash_sec;       // content hashing and dHash, all threads
+    double saved_sec;      // owner time not repeated, minus duplicate time
+} DedupStats;
+
+/**
+ * Index for the n inputs names[] under input_dir (the array must
+ * outlive the index). max_distance (0..7) is the largest dHash Hamming
+ * distance counted as a near duplicate. Returns NULL on failure.
+ */
+DedupIndex *dedup_create(const char *input_dir, char *const *names, int n,
+                         DedupMode mode, int max_distance);
+
+/**
+ * Forget all claims, links and timings (start of a repetition).
+ */
+void dedup_reset(DedupIndex *d);
+
+/**
+ * Claim input `index` by file content, before decoding it. Returns the
+ * owner's index if the file is byte-identical to an input claimed
+ * earlier (and records the link), otherwise -1: the caller processes it.
+ */
+int dedup_claim_file(DedupIndex *d, int index);
+
+/**
+ * Claim input `index` by the dHash of its decoded image. Returns the
+ * owner's index if a claimed image of the same size is within
+ * max_distance (and records the link), otherwise -1. Always -1 unless
+ * the mode is DEDUP_NEAR.
+ */
+int dedup_claim_image(DedupIndex *d, int index, const Image *img);
+
+/**
+ * Seconds spent on input `index`: the processing time of an owner, or
+ * the time it took to recognise a duplicate. Feeds saved_sec.
+ */
+void dedup_set_cost(DedupIndex *d, int index, double sec);
+
+/**
+ * Input whose outputs `index` takes (the owner, or the owner's own owner
+ * for an exact copy of a near duplicate), or -1 if it was not linked.
+ */
+int dedup_owner(const DedupIndex *d, int index);
+
+/**
+ * Drop the link of input `index` because its owner produced no output;
+ * the caller processes it instead. Counted as a fallback.
+ */
+void dedup_unlink(DedupIndex *d, int index);
+
+/**
+ * 64-bit difference hash: luminance sampled on a 9 x 8 grid of cells,
+ * bit set where a cell is brighter than its right neighbour.
+ */
+uint64_t dhash_image(const Image *img);
+
+/**
+ * Replace dst with a copy of src: a copy-on-write clone (FICLONE) where
+ * the filesystem supports it, else a byte copy. Returns 0 on success.
+ */
+int dedup_link_file(const char *src, const char *dst);
+
+/**
+ * Totals since the last reset.
+ */
+void dedup_stats(const DedupIndex *d, DedupStats *out);
+
+const char *dedup_mode_name(DedupMode mode);
+
+void dedup_destroy(DedupIndex *d);
+
+#endif // DEDUP_H
@@ -0,0 +1,62 @@
+#ifndef DISKORDER_H
+#define DISKORDER_H
+
+/**
+ * Order in which the input list is processed.
+ */
+typedef enum {
+    ORDER_READDIR = 0,   // as returned by readdir (default)
+    ORDER_NAME,          // lexicographic file name
+    ORDER_INODE,         // inode number (approximates allocation order)
+    ORDER_EXTENT         // physical offset of the first extent (FIEMAP)
+} FileOrder;
+
+/**
+ * Parse "readdir", "name", "inode" or "extent". Returns 0 on success.
+ */
+int parse_file_order(const char *s, FileOrder *out);
+
+const char *file_order_name(FileOrder order);
+
+/**
+ * Sort files[] (names relative to dir) in place by the given order.
+ * For ORDER_EXTENT, files whose extent map is unavailable (FIEMAP not
+ * supported, inline or empty files) fall back to their inode number.
+ * Returns the number of such fallbacks.
+ */
+int order_files(const char *dir, char **files, int count, FileOrder order);
+
+/**
+ * Sliding readahead window: keeps up to `window` files ahead of the
+ * consumers advised with posix_fadvise(POSIX_FADV_WILLNEED), issued in
+ * list order so the kernel reads the disk in that order.
+ */
+typedef struct {
+    const char *dir;
+    char      **files;
+    int         count;
+    int         window;
+    int         consumed;   // updated atomically
+    long long   advised;    // number of WILLNEED calls issued (atomic)
+} Prefetcher;
+
+/**
+ * Initialise p and advise the first `window` files. window <= 0
+ * disables prefetching.
+ */
+void prefetch_start(Prefetcher *p, const char *dir, char **files, int count,
+                    int window);
+
+/**
+ * Start over from the head of the list and advise the first window
+ * again, e.g. after the page cache was dropped between repetitions.
+ */
+void prefetch_rewind(Prefetcher *p);
+
+/**
+ * Note that one file was taken from the list and advise the next one
+ * past the window. Thread-safe.
+ */
+void prefetch_advance(Prefetcher *p);
+
+#endif // DISKORDER_H
@@ -0,0 +1,348 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "edgelist.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * SPARSE EDGE OUTPUT
+ * ------------------
+ *
+ * A thresholded Sobel map is mostly zeros, yet the dense PNG costs a
+ * full decode to scan again downstream. The sparse form keeps only the
+ * pixels at or above the threshold, as (x, magnitude) pairs grouped by
+ * row, built by a two-pass parallel compaction:
+ *
+ *   1. count   every row counts its survivors       (parallel over rows)
+ *   2. scan    exclusive prefix sum of the counts   -> row_ptr
+ *   3. emit    every row writes its survivors from row_ptr[y] on
+ *                                                   (parallel over rows)
+ *
+ * The scan runs over `height` numbers and costs nothing next to the two
+ * pixel passes. Each row writes only its own range, so the emit pass
+ * needs no synchronisation.
+ *
+ * File format (.sedg, all integers little-endian):
+ *
+ *   offset  size            field
+ *   0       4               magic "SEDG"
+ *   4       1               version (1)
+ *   5       1               x_bytes: 2 if width <= 65536, else 4
+ *   6       1               mag_bytes: 1 or 2
+ *   7       1               reserved (0)
+ *   8       4               width
+ *   12      4               height
+ *   16      8               count
+ *   24      4 * height      entries per row
+ *   ...     x_bytes * count      x of every entry, row by row
+ *   ...     mag_bytes * count    magnitude of every entry, same order
+ *
+ * x and magnitude are stored as separate arrays so a reader that only
+ * needs coordinates touches only those bytes.
+ */
+
+#if defined(_OPENMP)
+#define EDGE_PARALLEL_FOR _Pragma("omp parallel for schedule(static)")
+#else
+#define EDGE_PARALLEL_FOR
+#endif
+
+#define SEDG_HEADER_BYTES 24
+
+/* Per-sample-type count and emit loops over one row. */
+#define EDGE_ROW_OPS(SUFFIX, T, ENCODE)                                      \
+static uint32_t count_row_##SUFFIX(const T *row, int w, int c, double limit) { \
+    uint32_t n = 0;                                                          \
+    for (int x = 0; x < w; ++x)                                              \
+        n += ((double)row[(size_t)x * c] >= limit);                          \
+    return n;                                                                \
+}                                                                            \
+                                                                             \
+static void emit_row_##SUFFIX(const T *row, int w, int c, double limit,      \
+                              uint32_t *xs, uint16_t *mag) {                 \
+    size_t k = 0;                                                            \
+    for (int x = 0; x < w; ++x) {                                            \
+        T v = row[(size_t)x * c];                                            \
+        if ((double)v >= limit) {                                            \
+            xs[k]  = (uint32_t)x;                                            \
+            mag[k] = ENCODE(v);                                              \
+            k++;                                                             \
+        }                                                                    \
+    }                                                                        \
+}
+
+#define ENCODE_INT(v) ((uint16_t)(v))
+#define ENCODE_F32(v) \
+    ((uint16_t)((v) >= 1.0f ? 65535 : (uint16_t)((v) * 65535.0f + 0.5f)))
+
+EDGE_ROW_OPS(u8, unsigned char, ENCODE_INT)
+EDGE_ROW_OPS(u16, uint16_t, ENCODE_INT)
+EDGE_ROW_OPS(f32, float, ENCODE_F32)
+
+#undef EDGE_ROW_OPS
+#undef ENCODE_INT
+#undef ENCODE_F32
+
+static EdgeList *edge_list_alloc(int width, int height, int mag_bytes,
+                                 size_t count) {
+    EdgeList *e = (EdgeList *)calloc(1, sizeof(EdgeList));
+    if (!e) return NULL;
+    e->width     = width;
+    e->height    = height;
+    e->mag_bytes = mag_bytes;
+    e->count     = count;
+    e->row_ptr   = (uint32_t *)malloc(((size_t)height + 1) * sizeof(uint32_t));
+    e->x         = (uint32_t *)malloc((count ? count : 1) * sizeof(uint32_t));
+    e->mag       = (uint16_t *)malloc((count ? count : 1) * sizeof(uint16_t));
+    if (!e->row_ptr || !e->x || !e->mag) {
+        edge_list_free(e);
+        return NULL;
+    }
+    return e;
+}
+
+void edge_list_free(EdgeList *e) {
+    if (!e) return;
+    free(e->row_ptr);
+    free(e->x);
+    free(e->mag);
+    free(e);
+}
+
+EdgeList *edge_list_from_image(const Image *img, double level) {
+    if (!img || !img->data || img->width <= 0 || img->height <= 0) return NULL;
+
+    int w = img->width;
+    int h = img->height;
+    int c = img->channels;
+    size_t row_samples = (size_t)w * c;
+
+    uint32_t *counts = (uint32_t *)malloc(((size_t)h + 1) * sizeof(uint32_t));
+    if (!counts) {
+        fprintf(stderr, "[edgelist] Out of memory.\n");
+        return NULL;
+    }
+
+    // 1. count
+    double limit;
+    switch (img->type) {
+    case SAMPLE_U16: {
+        const uint16_t *d = (const uint16_t *)img->data;
+        limit = level * 65535.0;
+        EDGE_PARALLEL_FOR
+        for (int y = 0; y < h; ++y)
+            counts[y + 1] = count_row_u16(d + (size_t)y * row_samples, w, c, limit);
+        break;
+    }
+    case SAMPLE_F32: {
+        const float *d = (const float *)img->data;
+        limit = level;
+        EDGE_PARALLEL_FOR
+        for (int y = 0; y < h; ++y)
+            counts[y + 1] = count_row_f32(d + (size_t)y * row_samples, w, c, limit);
+        break;
+    }
+    default: {
+        const unsigned char *d = img->data;
+        limit = level * 255.0;
+        EDGE_PARALLEL_FOR
+        for (int y = 0; y < h; ++y)
+            counts[y + 1] = count_row_u8(d + (size_t)y * row_samples, w, c, limit);
+        break;
+    }
+    }
+
+    // 2. exclusive scan
+    counts[0] = 0;
+    size_t total = 0;
+    for (int y = 0; y < h; ++y) {
+        total += counts[y + 1];
+        if (total > UINT32_MAX) {
+            fprintf(stderr, "[edgelist] Too many edge pixels.\n");
+            free(counts);
+            return NULL;
+        }
+        counts[y + 1] = (uint32_t)total;
+    }
+
+    EdgeList *e = edge_list_alloc(w, h, (img->type == SAMPLE_U8) ? 1 : 2, total);
+    if (!e) {
+        fprintf(stderr, "[edgelist] Out of memory.\n");
+        free(counts);
+        return NULL;
+    }
+    free(e->row_ptr);
+    e->row_ptr = counts;
+
+    // 3. emit
+    uint32_t *xs  = e->x;
+    uint16_t *mag = e->mag;
+    switch (img->type) {
+    case SAMPLE_U16: {
+        const uint16_t *d = (const uint16_t *)img->data;
+        EDGE_PARALLEL_FOR
+        for (int y = 0; y < h; ++y)
+            emit_row_u16(d + (size_t)y * row_samples, w, c, limit,
+                         xs + counts[y], mag + counts[y]);
+        break;
+    }
+    case SAMPLE_F32: {
+        const float *d = (const float *)img->data;
+        EDGE_PARALLEL_FOR
+        for (int y = 0; y < h; ++y)
+            emit_row_f32(d + (size_t)y * row_samples, w, c, limit,
+                         xs + counts[y], mag + counts[y]);
+        break;
+    }
+    default: {
+        const unsigned char *d = img->data;
+        EDGE_PARALLEL_FOR
+        for (int y = 0; y < h; ++y)
+            emit_row_u8(d + (size_t)y * row_samples, w, c, limit,
+                        xs + counts[y], mag + counts[y]);
+        break;
+    }
+    }
+    return e;
+}
+
+static int x_bytes_for(int width) {
+    return (width <= 65536) ? 2 : 4;
+}
+
+size_t edge_list_file_bytes(const EdgeList *e) {
+    if (!e) return 0;
+    return SEDG_HEADER_BYTES + 4 * (size_t)e->height +
+           e->count * (size_t)(x_bytes_for(e->width) + e->mag_bytes);
+}
+
+static void put_le(unsigned char *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint64_t get_le(const unsigned char *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+int edge_list_write(const char *path, const EdgeList *e) {
+    if (!path || !e) return -1;
+
+    size_t bytes = edge_list_file_bytes(e);
+    unsigned char *buf = (unsigned char *)malloc(bytes);
+    if (!buf) {
+        fprintf(stderr, "[edgelist] Out of memory writing %s\n", path);
+        return -1;
+    }
+
+    int xb = x_bytes_for(e->width);
+    memcpy(buf, "SEDG", 4);
+    buf[4] = 1;
+    buf[5] = (unsigned char)xb;
+    buf[6] = (unsigned char)e->mag_bytes;
+    buf[7] = 0;
+    put_le(buf + 8, (uint32_t)e->width, 4);
+    put_le(buf + 12, (uint32_t)e->height, 4);
+    put_le(buf + 16, e->count, 8);
+
+    unsigned char *p = buf + SEDG_HEADER_BYTES;
+    for (int y = 0; y < e->height; ++y, p += 4)
+        put_le(p, e->row_ptr[y + 1] - e->row_ptr[y], 4);
+    for (size_t i = 0; i < e->count; ++i, p += xb)
+        put_le(p, e->x[i], xb);
+    for (size_t i = 0; i < e->count; ++i, p += e->mag_bytes)
+        put_le(p, e->mag[i], e->mag_bytes);
+
+    int rc = -1;
+    FILE *f = fopen(path, "wb");
+    if (f) {
+        rc = (fwrite(buf, 1, bytes, f) == bytes) ? 0 : -1;
+        if (fclose(f) != 0) rc = -1;
+    }
+    if (rc != 0) fprintf(stderr, "[edgelist] Failed to write %s\n", path);
+    free(buf);
+    return rc;
+}
+
+static unsigned char *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    unsigned char *buf = NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size >= 0 && fseek(f, 0, SEEK_SET) == 0) {
+        buf = (unsigned char *)malloc(size ? (size_t)size : 1);
+        if (buf && fread(buf, 1, (size_t)size, f) != (size_t)size) {
+            free(buf);
+            buf = NULL;
+        }
+    }
+    fclose(f);
+    if (buf) *len = (size_t)size;
+    return buf;
+}
+
+EdgeList *edge_list_read(const char *path) {
+    if (!path) return NULL;
+    size_t len = 0;
+    unsigned char *buf = read_file(path, &len);
+    if (!buf) {
+        fprintf(stderr, "[edgelist] Cannot read %s\n", path);
+        return NULL;
+    }
+
+    EdgeList *e = NULL;
+    if (len < SEDG_HEADER_BYTES || memcmp(buf, "SEDG", 4) != 0 || buf[4] != 1)
+        goto malformed;
+
+    int xb = buf[5];
+    int mb = buf[6];
+    uint64_t width  = get_le(buf + 8, 4);
+    uint64_t height = get_le(buf + 12, 4);
+    uint64_t count  = get_le(buf + 16, 8);
+    if ((xb != 2 && xb != 4) || (mb != 1 && mb != 2) ||
+        width == 0 || width > 0x7fffffff || height == 0 || height > 0x7fffffff ||
+        xb != x_bytes_for((int)width) || count > UINT32_MAX)
+        goto malformed;
+
+    // Check the exact size before allocating anything count-sized.
+    if ((len - SEDG_HEADER_BYTES) / 4 < height) goto malformed;
+    size_t rest = len - SEDG_HEADER_BYTES - 4 * (size_t)height;
+    if (rest != count * (uint64_t)(xb + mb)) goto malformed;
+
+    e = edge_list_alloc((int)width, (int)height, mb, (size_t)count);
+    if (!e) {
+        fprintf(stderr, "[edgelist] Out of memory reading %s\n", path);
+        free(buf);
+        return NULL;
+    }
+
+    const unsigned char *p = buf + SEDG_HEADER_BYTES;
+    uint64_t total = 0;
+    e->row_ptr[0] = 0;
+    for (uint64_t y = 0; y < height; ++y, p += 4) {
+        total += get_le(p, 4);
+        if (total > count) goto malformed;
+        e->row_ptr[y + 1] = (uint32_t)total;
+    }
+    if (total != count) goto malformed;
+
+    for (size_t i = 0; i < e->count; ++i, p += xb) {
+        e->x[i] = (uint32_t)get_le(p, xb);
+        if (e->x[i] >= width) goto malformed;
+    }
+    for (size_t i = 0; i < e->count; ++i, p += mb)
+        e->mag[i] = (uint16_t)get_le(p, mb);
+
+    free(buf);
+    return e;
+
+malformed:
+    fprintf(stderr, "[edgelist] Malformed edge list: %s\n", path);
+    edge_list_free(e);
+    free(buf);
+    return NULL;
+}
@@ -0,0 +1,47 @@
+#ifndef EDGELIST_H
+#define EDGELIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "filters.h"
+
+/**
+ * Sparse edge map: the pixels of a gray image at or above a threshold,
+ * as a coordinate list with magnitudes grouped by row (CSR layout).
+ * Row y holds entries [row_ptr[y], row_ptr[y + 1]) of x[] and mag[],
+ * in increasing x.
+ */
+typedef struct {
+    int       width;
+    int       height;
+    int       mag_bytes;   // 1 (u8 source) or 2 (u16; f32 scaled to 0..65535)
+    size_t    count;
+    uint32_t *row_ptr;     // height + 1 entries
+    uint32_t *x;           // count column indices
+    uint16_t *mag;         // count magnitudes
+} EdgeList;
+
+/**
+ * Compact the channel-0 samples of img that are >= level * full scale
+ * (the apply_threshold test) into an EdgeList. Meant for Sobel output.
+ * Rows are counted and filled in parallel when compiled with OpenMP.
+ * Returns NULL on failure.
+ */
+EdgeList *edge_list_from_image(const Image *img, double level);
+
+/**
+ * Size in bytes of the file edge_list_write() produces for e.
+ */
+size_t edge_list_file_bytes(const EdgeList *e);
+
+/**
+ * Write / read the binary .sedg format (see edgelist.c). write returns
+ * 0 on success; read returns NULL on I/O error or a malformed file.
+ */
+int edge_list_write(const char *path, const EdgeList *e);
+EdgeList *edge_list_read(const char *path);
+
+void edge_list_free(EdgeList *e);
+
+#endif // EDGELIST_H
@@ -0,0 +1,193 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "energy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <time.h>
+
+/*
+ * RAPL ENERGY ACCOUNTING
+ * ----------------------
+ *
+ * Intel (and recent AMD) CPUs expose cumulative energy counters through
+ * the powercap sysfs tree:
+ *
+ *   /sys/class/powercap/intel-rapl:0/       name = package-0
+ *       energy_uj, max_energy_range_uj
+ *   /sys/class/powercap/intel-rapl:0:2/     name = dram
+ *
+ * energy_uj is a free-running microjoule counter that wraps to 0 after
+ * max_energy_range_uj. A delta is therefore
+ *
+ *   now >= last ? now - last : now + (max_range - last)
+ *
+ * which is only correct if at most one wrap happened in between. At
+ * ~200 W a 2^38 uJ range wraps in roughly 20 minutes. The sampler
+ * thread folds the counters into the running total every
+ * ENERGY_SAMPLE_SEC, well inside that bound.
+ *
+ * core/uncore subzones are part of the package figure and are skipped;
+ * psys (whole-platform) is skipped too, since it overlaps both.
+ */
+
+#ifndef POWERCAP_ROOT
+#define POWERCAP_ROOT "/sys/class/powercap"
+#endif
+
+#define ENERGY_SAMPLE_SEC 5
+
+static int read_ull(const char *path, unsigned long long *out) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int ok = fscanf(f, "%llu", out) == 1;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+static int read_name(const char *dir, char *out, size_t size) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/name", dir);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int ok = fgets(out, (int)size, f) != NULL;
+    fclose(f);
+    if (!ok) return -1;
+    out[strcspn(out, "\n")] = '\0';
+    return 0;
+}
+
+void energy_open(EnergyMeter *m) {
+    if (!m) return;
+    memset(m, 0, sizeof(*m));
+    pthread_mutex_init(&m->lock, NULL);
+
+    DIR *dir = opendir(POWERCAP_ROOT);
+    if (!dir) {
+        m->reason = "no powercap interface";
+        return;
+    }
+
+    int unreadable = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL && m->n_domains < ENERGY_MAX_DOMAINS) {
+        if (strncmp(ent->d_name, "intel-rapl:", 11) != 0)
+            continue;
+
+        char zone[300];
+        char name[32];
+        snprintf(zone, sizeof(zone), "%s/%s", POWERCAP_ROOT, ent->d_name);
+        if (read_name(zone, name, sizeof(name)) != 0)
+            continue;
+
+        int is_package = strncmp(name, "package", 7) == 0;
+        int is_dram    = strcmp(name, "dram") == 0;
+        if (!is_package && !is_dram)
+            continue;
+
+        EnergyDomain *d = &m->domains[m->n_domains];
+        snprintf(d->name, sizeof(d->name), "%s", name);
+        snprintf(d->energy_path, sizeof(d->energy_path), "%s/energy_uj", zone);
+        d->is_dram = is_dram;
+
+        char range_path[320];
+        snprintf(range_path, sizeof(range_path), "%s/max_energy_range_uj", zone);
+        unsigned long long probe;
+        if (read_ull(range_path, &d->max_range_uj) != 0 ||
+            read_ull(d->energy_path, &probe) != 0) {
+            unreadable++;    // energy_uj is root-only on recent kernels
+            continue;
+        }
+        m->n_domains++;
+    }
+    closedir(dir);
+
+    if (m->n_domains > 0) {
+        m->available = 1;
+    } else {
+        m->reason = unreadable ? "RAPL counters not readable (permissions)"
+                               : "no RAPL package/dram zones";
+    }
+}
+
+/* Fold the counters into the totals. Caller holds m->lock. */
+static void sample_locked(EnergyMeter *m) {
+    for (int i = 0; i < m->n_domains; ++i) {
+        EnergyDomain *d = &m->domains[i];
+        unsigned long long now;
+        if (read_ull(d->energy_path, &now) != 0) continue;
+
+        unsigned long long delta = (now >= d->last_uj)
+            ? now - d->last_uj
+            : now + (d->max_range_uj - d->last_uj);   // wrapped once
+        d->joules += (double)delta * 1e-6;
+        d->last_uj = now;
+    }
+}
+
+static void *sampler_main(void *arg) {
+    EnergyMeter *m = (EnergyMeter *)arg;
+    for (;;) {
+        // Sleep in short steps so energy_end() does not wait long
+        for (int t = 0; t < ENERGY_SAMPLE_SEC * 10; ++t) {
+            struct timespec ts = { 0, 100 * 1000 * 1000 };
+            nanosleep(&ts, NULL);
+            pthread_mutex_lock(&m->lock);
+            int running = m->running;
+            pthread_mutex_unlock(&m->lock);
+            if (!running) return NULL;
+        }
+        pthread_mutex_lock(&m->lock);
+        sample_locked(m);
+        pthread_mutex_unlock(&m->lock);
+    }
+}
+
+void energy_begin(EnergyMeter *m) {
+    if (!m || !m->available) return;
+
+    pthread_mutex_lock(&m->lock);
+    for (int i = 0; i < m->n_domains; ++i) {
+        EnergyDomain *d = &m->domains[i];
+        d->joules = 0.0;
+        if (read_ull(d->energy_path, &d->last_uj) != 0) d->last_uj = 0;
+    }
+    m->running = 1;
+    pthread_mutex_unlock(&m->lock);
+
+    if (pthread_create(&m->sampler, NULL, sampler_main, m) != 0) {
+        pthread_mutex_lock(&m->lock);
+        m->running = 0;          // short regions still work without it
+        pthread_mutex_unlock(&m->lock);
+    }
+}
+
+void energy_end(EnergyMeter *m, EnergyReading *acc) {
+    if (!m || !acc) return;
+    if (!m->available) return;
+
+    pthread_mutex_lock(&m->lock);
+    int was_running = m->running;
+    m->running = 0;
+    pthread_mutex_unlock(&m->lock);
+    if (was_running)
+        pthread_join(m->sampler, NULL);
+
+    pthread_mutex_lock(&m->lock);
+    sample_locked(m);
+    acc->available = 1;
+    for (int i = 0; i < m->n_domains; ++i) {
+        const EnergyDomain *d = &m->domains[i];
+        if (d->is_dram) acc->dram_j    += d->joules;
+        else            acc->package_j += d->joules;
+        acc->total_j += d->joules;
+    }
+    pthread_mutex_unlock(&m->lock);
+}
+
+void energy_close(EnergyMeter *m) {
+    if (!m) return;
+    pthread_mutex_destroy(&m->lock);
+}
@@ -0,0 +1,61 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <pthread.h>
+
+#define ENERGY_MAX_DOMAINS 16
+
+/**
+ * One RAPL powercap zone (package-N, dram, ...).
+ */
+typedef struct {
+    char               name[32];
+    char               energy_path[320];
+    int                is_dram;
+    unsigned long long max_range_uj;   // counter wraps at this value
+    unsigned long long last_uj;
+    double             joules;         // accumulated since energy_begin
+} EnergyDomain;
+
+/**
+ * Energy counters read from /sys/class/powercap/intel-rapl*. A
+ * background thread samples them while a region is measured, so a
+ * counter wrapping more than once per region is still accounted for.
+ */
+typedef struct {
+    int             available;
+    const char     *reason;        // why not available
+    int             n_domains;
+    EnergyDomain    domains[ENERGY_MAX_DOMAINS];
+
+    pthread_t       sampler;
+    pthread_mutex_t lock;
+    int             running;
+} EnergyMeter;
+
+typedef struct {
+    int    available;
+    double package_j;   // sum over package-N zones (cores + uncore)
+    double dram_j;      // sum over dram zones
+    double total_j;     // package + dram
+} EnergyReading;
+
+/**
+ * Discover RAPL package and DRAM zones. Never fails: without readable
+ * counters m->available is 0 and m->reason says why.
+ */
+void energy_open(EnergyMeter *m);
+
+/**
+ * Start measuring a region (baseline read + sampler thread).
+ */
+void energy_begin(EnergyMeter *m);
+
+/**
+ * Stop measuring and add the region's energy to *acc.
+ */
+void energy_end(EnergyMeter *m, EnergyReading *acc);
+
+void energy_close(EnergyMeter *m);
+
+#endif // ENERGY_H
@@ -1,9 +1,15 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "filters.h"
+#include "pngdec.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
 /* stb single-header libs */
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -11,11 +17,82 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-Image *load_image(const char *path) {
+#if defined(_OPENMP)
+#define FILTER_SIMD _Pragma("omp simd")
+// per-thread copies of a local `bins` array, summed at the end
+#define FILTER_HISTOGRAM_FOR \
+    _Pragma("omp parallel for schedule(static) reduction(+:bins[:256])")
+#else
+#define FILTER_SIMD
+#define FILTER_HISTOGRAM_FOR
+#endif
+
+size_t sample_size(SampleType type) {
+    switch (type) {
+    case SAMPLE_U16: return sizeof(uint16_t);
+    case SAMPLE_F32: return sizeof(float);
+    default:         return sizeof(unsigned char);
+    }
+}
+
+size_t image_bytes(const Image *img) {
+    if (!img) return 0;
+    return (size_t)img->width * img->height * img->channels *
+           sample_size(img->type);
+}
+
+const char *sample_type_name(SampleType type) {
+    switch (type) {
+    case SAMPLE_U16: return "u16";
+    case SAMPLE_F32: return "f32";
+    default:         return "u8";
+    }
+}
+
+int parse_sample_type(const char *name, SampleType *out) {
+    if (!name || !out) return -1;
+    if (strcmp(name, "u8") == 0)  { *out = SAMPLE_U8;  return 0; }
+    if (strcmp(name, "u16") == 0) { *out = SAMPLE_U16; return 0; }
+    if (strcmp(name, "f32") == 0) { *out = SAMPLE_F32; return 0; }
+    return -1;
+}
+
+/*
+ * f32 loading: true HDR files come straight from stbi_loadf. LDR files
+ * go through stbi_load_16 and are normalized to [0, 1] here, which keeps
+ * full 16-bit precision and avoids stbi's global LDR->HDR gamma setting.
+ */
+static float *load_f32(const char *path, int *w, int *h, int *c) {
+    if (stbi_is_hdr(path))
+        return stbi_loadf(path, w, h, c, 3);
+
+    uint16_t *src = stbi_load_16(path, w, h, c, 3);
+    if (!src) return NULL;
+
+    size_t n = (size_t)(*w) * (*h) * 3;
+    float *dst = (float *)malloc(n * sizeof(float));
+    if (dst) {
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = (float)src[i] * (1.0f / 65535.0f);
+    }
+    stbi_image_free(src);
+    return dst;
+}
+
+Image *load_image_typed(const char *path, SampleType type) {
     if (!path) return NULL;
 
     int w, h, c;
-    unsigned char *data = stbi_load(path, &w, &h, &c, 3); // force RGB
+    void *data = NULL;
+    switch (type) {
+    case SAMPLE_U16: data = stbi_load_16(path, &w, &h, &c, 3); break; // force RGB
+    case SAMPLE_F32: data = load_f32(path, &w, &h, &c);        break;
+    default:
+        // common 8-bit PNGs take the fast decoder, everything else stb
+        data = png_load_rgb8(path, &w, &h);
+        if (!data) data = stbi_load(path, &w, &h, &c, 3);
+        break;
+    }
     if (!data) {
         fprintf(stderr, "[load_image] Failed to load: %s\n", path);
         return NULL;
@@ -31,17 +108,191 @@ Image *load_image(const char *path) {
     img->width = w;
     img->height = h;
     img->channels = 3;
-    img->data = data;
+    img->type = type;
+    img->data = (unsigned char *)data;
 
     return img;
 }
 
+Image *load_image(const char *path) {
+    return load_image_typed(path, SAMPLE_U8);
+}
+
+int image_info(const char *path, int *width, int *height) {
+    if (!path || !width || !height) return -1;
+    int c;
+    return stbi_info(path, width, height, &c) ? 0 : -1;
+}
+
+/*
+ * DECODE LIMITS AND PER-IMAGE TIME BUDGET
+ * ---------------------------------------
+ *
+ * A 60000x60000 PNG compresses to a few MB but decodes to 10 GB. The
+ * header says so before anything is allocated, so check_decode_limits()
+ * compares it against the caller's limits first.
+ *
+ * A large but legal image can still hold one thread far longer than the
+ * rest of the batch. The filters cannot be interrupted, so they poll a
+ * per-thread deadline every FILTER_BAND_ROWS rows and return early once
+ * it has passed. The image is then partially filtered, and the caller
+ * must drop it, or retry it later without a budget.
+ */
+int check_decode_limits(const char *path, SampleType type,
+                        const DecodeLimits *limits, int *width, int *height) {
+    int w, h;
+    if (image_info(path, &w, &h) != 0) return -1;
+    if (width)  *width  = w;
+    if (height) *height = h;
+    if (!limits) return 0;
+
+    long long pixels = (long long)w * h;
+    long long bytes  = pixels * 3 * (long long)sample_size(type);
+    if (limits->max_pixels > 0 && pixels > limits->max_pixels) return 1;
+    if (limits->max_bytes  > 0 && bytes  > limits->max_bytes)  return 1;
+    return 0;
+}
+
+static _Thread_local double budget_deadline;   // 0 = no budget armed
+static _Thread_local int    budget_hit;
+
+static double monotonic_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void filter_budget_arm(double seconds) {
+    budget_hit      = 0;
+    budget_deadline = (seconds > 0.0) ? monotonic_sec() + seconds : 0.0;
+}
+
+void filter_budget_disarm(void) {
+    budget_deadline = 0.0;
+    budget_hit      = 0;
+}
+
+int filter_budget_exceeded(void) {
+    return budget_hit;
+}
+
+/* Polled by the kernels at the start of each band of rows. */
+static int budget_expired(void) {
+    if (budget_hit) return 1;
+    if (budget_deadline == 0.0) return 0;
+    if (monotonic_sec() < budget_deadline) return 0;
+    budget_hit = 1;
+    return 1;
+}
+
+/*
+ * Minimal PNG writer for what stb_image_write cannot produce
+ * (16-bit samples and 1-bit masks). raw holds `height` rows of
+ * 1 filter byte + row_bytes of big-endian sample data.
+ */
+static void put_be32(unsigned char *p, unsigned int v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static int write_png_chunk(FILE *f, const char *tag,
+                           const unsigned char *data, int len) {
+    unsigned char *buf = (unsigned char *)malloc((size_t)len + 4);
+    if (!buf) return -1;
+    memcpy(buf, tag, 4);
+    if (len > 0) memcpy(buf + 4, data, (size_t)len);
+
+    unsigned char be[4];
+    put_be32(be, (unsigned int)len);
+    int ok = fwrite(be, 1, 4, f) == 4 &&
+             fwrite(buf, 1, (size_t)len + 4, f) == (size_t)len + 4;
+    put_be32(be, stbiw__crc32(buf, len + 4));   // same TU as stb_image_write
+    ok = ok && fwrite(be, 1, 4, f) == 4;
+
+    free(buf);
+    return ok ? 0 : -1;
+}
+
+static int write_png_raw(const char *path, int w, int h, int bit_depth,
+                         int color_type, unsigned char *raw, int raw_len) {
+    int zlen = 0;
+    unsigned char *z = stbi_zlib_compress(raw, raw_len, &zlen,
+                                          stbi_write_png_compression_level);
+    if (!z) return -1;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        STBIW_FREE(z);
+        return -1;
+    }
+
+    static const unsigned char sig[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    unsigned char ihdr[13];
+    put_be32(ihdr, (unsigned int)w);
+    put_be32(ihdr + 4, (unsigned int)h);
+    ihdr[8]  = (unsigned char)bit_depth;
+    ihdr[9]  = (unsigned char)color_type;
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;   // deflate, no filter, no interlace
+
+    int rc = (fwrite(sig, 1, 8, f) == 8) ? 0 : -1;
+    if (rc == 0) rc = write_png_chunk(f, "IHDR", ihdr, 13);
+    if (rc == 0) rc = write_png_chunk(f, "IDAT", z, zlen);
+    if (rc == 0) rc = write_png_chunk(f, "IEND", NULL, 0);
+
+    if (fclose(f) != 0) rc = -1;
+    STBIW_FREE(z);
+    return rc;
+}
+
+/* 16-bit RGB PNG from u16 or f32 (clamped to [0, 1]) samples. */
+static int save_image_png16(const char *path, const Image *img) {
+    int c = img->channels;
+    size_t row_bytes = (size_t)img->width * c * 2;
+    size_t raw_len = (row_bytes + 1) * img->height;
+    if (raw_len > 0x7fffffff) return -1;
+
+    unsigned char *raw = (unsigned char *)malloc(raw_len);
+    if (!raw) return -1;
+
+    size_t samples_per_row = (size_t)img->width * c;
+    for (int y = 0; y < img->height; ++y) {
+        unsigned char *dst = raw + y * (row_bytes + 1);
+        *dst++ = 0;   // filter: none
+        for (size_t i = 0; i < samples_per_row; ++i) {
+            size_t idx = (size_t)y * samples_per_row + i;
+            unsigned int v;
+            if (img->type == SAMPLE_F32) {
+                float f = ((const float *)img->data)[idx];
+                if (f < 0.0f) f = 0.0f;
+                if (f > 1.0f) f = 1.0f;
+                v = (unsigned int)(f * 65535.0f + 0.5f);
+            } else {
+                v = ((const uint16_t *)img->data)[idx];
+            }
+            dst[2 * i]     = (unsigned char)(v >> 8);
+            dst[2 * i + 1] = (unsigned char)v;
+        }
+    }
+
+    int rc = write_png_raw(path, img->width, img->height, 16,
+                           (c == 3) ? 2 : 0, raw, (int)raw_len);
+    free(raw);
+    return rc;
+}
+
 int save_image_png(const char *path, const Image *img) {
     if (!path || !img || !img->data) return -1;
 
-    int stride = img->width * img->channels;
-    int ok = stbi_write_png(path, img->width, img->height,
+    int ok;
+    if (img->type == SAMPLE_U8) {
+        int stride = img->width * img->channels;
+        ok = stbi_write_png(path, img->width, img->height,
                             img->channels, img->data, stride);
+    } else {
+        ok = save_image_png16(path, img) == 0;
+    }
     if (!ok) {
         fprintf(stderr, "[save_image_png] Failed to save: %s\n", path);
         return -1;
@@ -49,6 +300,25 @@ int save_image_png(const char *path, const Image *img) {
     return 0;
 }
 
+Image *clone_image(const Image *img) {
+    if (!img || !img->data) return NULL;
+
+    size_t size = image_bytes(img);
+    Image *copy = (Image *)malloc(sizeof(Image));
+    unsigned char *data = (unsigned char *)malloc(size);
+    if (!copy || !data) {
+        fprintf(stderr, "[clone_image] Out of memory.\n");
+        free(copy);
+        free(data);
+        return NULL;
+    }
+
+    memcpy(data, img->data, size);
+    *copy = *img;
+    copy->data = data;
+    return copy;
+}
+
 void free_image(Image *img) {
     if (!img) return;
     if (img->data) {
@@ -57,163 +327,693 @@ void free_image(Image *img) {
     free(img);
 }
 
+/* --- per-type kernel instantiations (see filters_kernels.h) --- */
+
+#define FILTER_BAND_ROWS 16
+
+/*
+ * Parameters of every pointwise stage: the public tone chain plus the
+ * stretch and posterize stages, which apply_tone_fused does not take.
+ */
+typedef struct {
+    ToneParams tone;
+    double     stretch_lo;
+    double     stretch_hi;
+    int        levels;
+} PointwiseParams;
+
+#define SAMPLE_T      unsigned char
+#define SAMPLE_ACC    int
+#define SAMPLE_MAX    255
+#define SAMPLE_SUFFIX u8
+#define SOBEL_T       int16_t
+#define SOBEL_SEPARABLE 1
+#include "filters_kernels.h"
+#undef SAMPLE_T
+#undef SAMPLE_ACC
+#undef SAMPLE_MAX
+#undef SAMPLE_SUFFIX
+#undef SOBEL_T
+#undef SOBEL_SEPARABLE
+
+#define SAMPLE_T      uint16_t
+#define SAMPLE_ACC    long long
+#define SAMPLE_MAX    65535
+#define SAMPLE_SUFFIX u16
+#define SOBEL_T       int32_t
+#define SOBEL_SEPARABLE 1
+#include "filters_kernels.h"
+#undef SAMPLE_T
+#undef SAMPLE_ACC
+#undef SAMPLE_MAX
+#undef SAMPLE_SUFFIX
+#undef SOBEL_T
+#undef SOBEL_SEPARABLE
+
+#define SAMPLE_T      float
+#define SAMPLE_ACC    float
+#define SAMPLE_MAX    1.0f
+#define SAMPLE_SUFFIX f32
+#define SOBEL_T       float
+#define SOBEL_SEPARABLE 0
+#include "filters_kernels.h"
+#undef SAMPLE_T
+#undef SAMPLE_ACC
+#undef SAMPLE_MAX
+#undef SAMPLE_SUFFIX
+#undef SOBEL_T
+#undef SOBEL_SEPARABLE
+
+/* Run pointwise kernel `name` with params converted for img->type. */
+#define DISPATCH_POINTWISE(img, name, params)                     \
+    switch ((img)->type) {                                        \
+    case SAMPLE_U16: {                                            \
+        pw_const_u16 k; pw_setup_u16(&k, params); name##_u16(img, &k); \
+        break;                                                    \
+    }                                                             \
+    case SAMPLE_F32: {                                            \
+        pw_const_f32 k; pw_setup_f32(&k, params); name##_f32(img, &k); \
+        break;                                                    \
+    }                                                             \
+    default: {                                                    \
+        pw_const_u8 k; pw_setup_u8(&k, params); name##_u8(img, &k);    \
+        break;                                                    \
+    }                                                             \
+    }
+
+static const PointwiseParams tone_identity = {
+    .tone       = { .gamma = 1.0, .clamp_lo = 0.0, .clamp_hi = 1.0, .threshold = 0.5 },
+    .stretch_lo = 0.0,
+    .stretch_hi = 1.0,
+    .levels     = 256,
+};
+
 void apply_grayscale(Image *img) {
     if (!img || !img->data || img->channels < 3) return;
+    DISPATCH_POINTWISE(img, grayscale, &tone_identity);
+}
+
+void apply_gamma(Image *img, double gamma) {
+    if (!img || !img->data || gamma <= 0.0) return;
+    PointwiseParams p = tone_identity;
+    p.tone.gamma = gamma;
+    DISPATCH_POINTWISE(img, gamma, &p);
+}
+
+void apply_invert(Image *img) {
+    if (!img || !img->data) return;
+    DISPATCH_POINTWISE(img, invert, &tone_identity);
+}
 
-    int pixels = img->width * img->height;
-    for (int i = 0; i < pixels; ++i) {
-        unsigned char *p = &img->data[i * img->channels];
-        unsigned char r = p[0];
-        unsigned char g = p[1];
-        unsigned char b = p[2];
+void apply_threshold(Image *img, double level) {
+    if (!img || !img->data) return;
+    PointwiseParams p = tone_identity;
+    p.tone.threshold = level;
+    DISPATCH_POINTWISE(img, threshold, &p);
+}
+
+void apply_clamp(Image *img, double lo, double hi) {
+    if (!img || !img->data || lo > hi) return;
+    PointwiseParams p = tone_identity;
+    p.tone.clamp_lo = lo;
+    p.tone.clamp_hi = hi;
+    DISPATCH_POINTWISE(img, clamp, &p);
+}
+
+void apply_contrast_stretch(Image *img, double lo, double hi) {
+    if (!img || !img->data || lo >= hi) return;
+    PointwiseParams p = tone_identity;
+    p.stretch_lo = lo;
+    p.stretch_hi = hi;
+    DISPATCH_POINTWISE(img, stretch, &p);
+}
+
+void apply_posterize(Image *img, int levels) {
+    if (!img || !img->data || levels < 2) return;
+    PointwiseParams p = tone_identity;
+    p.levels = levels;
+    DISPATCH_POINTWISE(img, posterize, &p);
+}
+
+void apply_tone_fused(Image *img, const ToneParams *params) {
+    if (!img || !img->data || img->channels < 3 || !params) return;
+    if (params->gamma <= 0.0 || params->clamp_lo > params->clamp_hi) return;
+    PointwiseParams p = tone_identity;
+    p.tone = *params;
+    DISPATCH_POINTWISE(img, tone_fused, &p);
+}
+
+/*
+ * 8-BIT LOOKUP TABLES
+ * -------------------
+ *
+ * Any chain of single-input 8-bit pointwise stages is a function
+ * {0..255} -> {0..255}, so the pipeline planner folds it into one
+ * 256-entry table and applies that in a single sweep. The sweep picks
+ * the widest table lookup the CPU has at runtime:
+ *
+ *   vbmi    vpermi2b: two 128-entry lookups per 64 bytes, picked by bit 7
+ *   avx2    pshufb: 16 lookups of 16 entries, one per high nibble
+ *   scalar  plain indexed load
+ *
+ * All three produce identical bytes; only the throughput differs.
+ */
+typedef void (*LutSpanFn)(unsigned char *p, size_t n, const unsigned char *lut);
+
+static void lut_span_scalar(unsigned char *p, size_t n, const unsigned char *lut) {
+    for (size_t i = 0; i < n; ++i) p[i] = lut[p[i]];
+}
 
-        // simple luminance
-        unsigned char gray = (unsigned char)(
-            0.299 * r + 0.587 * g + 0.114 * b
-        );
-        p[0] = p[1] = p[2] = gray;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FILTER_X86 1
+
+__attribute__((target("avx2")))
+static void lut_span_avx2(unsigned char *p, size_t n, const unsigned char *lut) {
+    __m256i tbl[16];
+    for (int j = 0; j < 16; ++j)
+        tbl[j] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)(lut + 16 * j)));
+    const __m256i bias = _mm256_set1_epi8(0x70);
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i r = _mm256_setzero_si256();
+        for (int j = 0; j < 16; ++j) {
+            // Bytes whose high nibble is j keep bit 7 clear; all others
+            // saturate to >= 0x80 and make pshufb write zero.
+            __m256i idx = _mm256_xor_si256(x, _mm256_set1_epi8((char)(j << 4)));
+            idx = _mm256_adds_epu8(idx, bias);
+            r = _mm256_or_si256(r, _mm256_shuffle_epi8(tbl[j], idx));
+        }
+        _mm256_storeu_si256((__m256i *)(p + i), r);
     }
+    lut_span_scalar(p + i, n - i, lut);
 }
 
-void apply_box_blur(Image *img, int radius) {
-    if (!img || !img->data || img->channels < 3 || radius <= 0) return;
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static void lut_span_vbmi(unsigned char *p, size_t n, const unsigned char *lut) {
+    __m512i t0 = _mm512_loadu_si512((const void *)lut);
+    __m512i t1 = _mm512_loadu_si512((const void *)(lut + 64));
+    __m512i t2 = _mm512_loadu_si512((const void *)(lut + 128));
+    __m512i t3 = _mm512_loadu_si512((const void *)(lut + 192));
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i x  = _mm512_loadu_si512((const void *)(p + i));
+        __m512i lo = _mm512_permutex2var_epi8(t0, x, t1);   // uses bits 0..6
+        __m512i hi = _mm512_permutex2var_epi8(t2, x, t3);
+        __mmask64 upper = _mm512_movepi8_mask(x);           // bit 7
+        _mm512_storeu_si512((void *)(p + i), _mm512_mask_blend_epi8(upper, lo, hi));
+    }
+    lut_span_scalar(p + i, n - i, lut);
+}
+#endif
 
-    int w = img->width;
-    int h = img->height;
-    int c = img->channels;
-    int size = w * h * c;
+static LutSpanFn lut_span_select(const char **name) {
+#ifdef FILTER_X86
+    if (__builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw")) {
+        *name = "vbmi";
+        return lut_span_vbmi;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return lut_span_avx2;
+    }
+#endif
+    *name = "scalar";
+    return lut_span_scalar;
+}
 
-    unsigned char *src = img->data;
-    unsigned char *tmp = (unsigned char *)malloc(size);
-    if (!tmp) {
-        fprintf(stderr, "[apply_box_blur] Out of memory.\n");
-        return;
+const char *lut_backend_name(void) {
+    const char *name;
+    lut_span_select(&name);
+    return name;
+}
+
+void apply_lut_u8(Image *img, const unsigned char lut[256]) {
+    if (!img || !img->data || !lut || img->type != SAMPLE_U8) return;
+
+    const char *name;
+    LutSpanFn span = lut_span_select(&name);
+    size_t samples = (size_t)img->width * img->height * img->channels;
+    size_t band = (size_t)img->width * img->channels * FILTER_BAND_ROWS;
+
+    for (size_t start = 0; start < samples; start += band) {
+        if (budget_expired()) return;
+        size_t n = (samples - start < band) ? samples - start : band;
+        span(img->data + start, n, lut);
     }
+}
 
-    // Horizontal pass
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            int rsum[3] = {0, 0, 0};
-            int count = 0;
+/*
+ * BINARY MASKS
+ * ------------
+ *
+ * Most consumers of the Sobel output threshold it straight away, and a
+ * binary edge map needs one bit per pixel instead of three samples
+ * (24x less for u8 RGB). BitMask rows are packed MSB first, which is
+ * the row layout of both PBM (P4) and 1-bit PNG, so the writers emit
+ * the bits unchanged.
+ *
+ * For 3-channel u8 input the SSSE3 path handles 16 pixels per step:
+ * three pshufb pick channel 0 out of 48 interleaved bytes (and reverse
+ * each group of 8, so that pmovmskb yields MSB-first bytes), max/cmpeq
+ * tests v >= t unsigned, and pmovmskb packs the 16 results into two
+ * mask bytes.
+ *
+ * otsu_level() maximises the between-class variance over a 256-bin
+ * histogram of channel 0 (u16 bins by v >> 8, f32 by v * 256).
+ */
+static BitMask *alloc_mask(int width, int height) {
+    BitMask *m = (BitMask *)malloc(sizeof(BitMask));
+    if (!m) return NULL;
+    m->width  = width;
+    m->height = height;
+    m->stride = ((size_t)width + 7) / 8;
+    m->bits   = (unsigned char *)calloc(m->stride * height, 1);
+    if (!m->bits) {
+        free(m);
+        return NULL;
+    }
+    return m;
+}
 
-            int xmin = (x - radius < 0) ? 0 : x - radius;
-            int xmax = (x + radius >= w) ? w - 1 : x + radius;
+void free_mask(BitMask *mask) {
+    if (!mask) return;
+    free(mask->bits);
+    free(mask);
+}
 
-            for (int xx = xmin; xx <= xmax; ++xx) {
-                int idx = (y * w + xx) * c;
-                rsum[0] += src[idx + 0];
-                rsum[1] += src[idx + 1];
-                rsum[2] += src[idx + 2];
-                count++;
-            }
+#ifdef FILTER_X86
+/* 3-channel u8 only; same result as mask_rows_u8. */
+__attribute__((target("ssse3")))
+static int mask_rows_ssse3_u8(const Image *img, double level, BitMask *m) {
+    // v >= level * 255 for integer v  <=>  v >= ceil(level * 255)
+    double limit = ceil(level * 255.0);
+    if (limit > 255.0) return 0;   // nothing set
+    int t = (limit < 0.0) ? 0 : (int)limit;
+
+    const __m128i pick0 = _mm_setr_epi8(-128, -128, 15, 12, 9, 6, 3, 0,
+                                        -128, -128, -128, -128, -128, -128, -128, -128);
+    const __m128i pick1 = _mm_setr_epi8(5, 2, -128, -128, -128, -128, -128, -128,
+                                        -128, -128, -128, -128, -128, 14, 11, 8);
+    const __m128i pick2 = _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128,
+                                        13, 10, 7, 4, 1, -128, -128, -128);
+    const __m128i thr = _mm_set1_epi8((char)t);
+    int w = img->width;
 
-            int out_idx = (y * w + x) * c;
-            tmp[out_idx + 0] = (unsigned char)(rsum[0] / count);
-            tmp[out_idx + 1] = (unsigned char)(rsum[1] / count);
-            tmp[out_idx + 2] = (unsigned char)(rsum[2] / count);
+    for (int y = 0; y < img->height; ++y) {
+        if (y % FILTER_BAND_ROWS == 0 && budget_expired()) return -1;
+        const unsigned char *row = img->data + (size_t)y * w * 3;
+        unsigned char *bits = m->bits + (size_t)y * m->stride;
+
+        int x = 0;
+        for (; x + 16 <= w; x += 16) {
+            const unsigned char *p = row + (size_t)x * 3;
+            __m128i a = _mm_loadu_si128((const __m128i *)p);
+            __m128i b = _mm_loadu_si128((const __m128i *)(p + 16));
+            __m128i c = _mm_loadu_si128((const __m128i *)(p + 32));
+            __m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, pick0),
+                                                  _mm_shuffle_epi8(b, pick1)),
+                                     _mm_shuffle_epi8(c, pick2));
+            int set = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, thr), v));
+            bits[x >> 3]       = (unsigned char)set;
+            bits[(x >> 3) + 1] = (unsigned char)(set >> 8);
         }
+        for (; x < w; ++x)
+            if (row[(size_t)x * 3] >= t) bits[x >> 3] |= (unsigned char)(0x80 >> (x & 7));
     }
+    return 0;
+}
+#endif
 
-    // Vertical pass (in-place back into src)
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            int rsum[3] = {0, 0, 0};
-            int count = 0;
+BitMask *threshold_mask(const Image *img, double level) {
+    if (!img || !img->data) return NULL;
+    BitMask *m = alloc_mask(img->width, img->height);
+    if (!m) {
+        fprintf(stderr, "[threshold_mask] Out of memory.\n");
+        return NULL;
+    }
+
+    int rc;
+    switch (img->type) {
+    case SAMPLE_U16: rc = mask_rows_u16(img, level, m); break;
+    case SAMPLE_F32: rc = mask_rows_f32(img, level, m); break;
+    default:
+#ifdef FILTER_X86
+        if (img->channels == 3 && __builtin_cpu_supports("ssse3")) {
+            rc = mask_rows_ssse3_u8(img, level, m);
+            break;
+        }
+#endif
+        rc = mask_rows_u8(img, level, m);
+        break;
+    }
+    if (rc != 0) {
+        free_mask(m);
+        return NULL;
+    }
+    return m;
+}
 
-            int ymin = (y - radius < 0) ? 0 : y - radius;
-            int ymax = (y + radius >= h) ? h - 1 : y + radius;
+double otsu_level(const Image *img) {
+    if (!img || !img->data) return 0.5;
 
-            for (int yy = ymin; yy <= ymax; ++yy) {
-                int idx = (yy * w + x) * c;
-                rsum[0] += tmp[idx + 0];
-                rsum[1] += tmp[idx + 1];
-                rsum[2] += tmp[idx + 2];
-                count++;
-            }
+    long long hist[256];
+    switch (img->type) {
+    case SAMPLE_U16: histogram_u16(img, 1.0 / 256.0, hist); break;
+    case SAMPLE_F32: histogram_f32(img, 256.0, hist);       break;
+    default:         histogram_u8(img, 1.0, hist);          break;
+    }
+
+    long long total = 0;
+    double sum_all = 0.0;
+    for (int b = 0; b < 256; ++b) {
+        total   += hist[b];
+        sum_all += (double)b * hist[b];
+    }
 
-            int out_idx = (y * w + x) * c;
-            src[out_idx + 0] = (unsigned char)(rsum[0] / count);
-            src[out_idx + 1] = (unsigned char)(rsum[1] / count);
-            src[out_idx + 2] = (unsigned char)(rsum[2] / count);
+    // class 0 = bins [0, t], class 1 = bins [t + 1, 255]
+    long long n0 = 0;
+    double sum0 = 0.0, best = -1.0;
+    int best_t = -1;
+    for (int t = 0; t < 255; ++t) {
+        n0   += hist[t];
+        sum0 += (double)t * hist[t];
+        long long n1 = total - n0;
+        if (n0 == 0 || n1 == 0) continue;
+        double diff = sum0 / n0 - (sum_all - sum0) / n1;
+        double between = (double)n0 * (double)n1 * diff * diff;
+        if (between > best) {
+            best   = between;
+            best_t = t;
         }
     }
+    // bin >= t + 1  <=>  sample >= (t + 1) / 256 of full scale
+    return (best_t < 0) ? 0.5 : (best_t + 1) / 256.0;
+}
 
-    free(tmp);
+int save_mask_pbm(const char *path, const BitMask *mask) {
+    if (!path || !mask || !mask->bits) return -1;
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "[save_mask_pbm] Failed to open: %s\n", path);
+        return -1;
+    }
+    size_t bytes = mask->stride * mask->height;
+    int rc = (fprintf(f, "P4\n%d %d\n", mask->width, mask->height) > 0 &&
+              fwrite(mask->bits, 1, bytes, f) == bytes) ? 0 : -1;
+    if (fclose(f) != 0) rc = -1;
+    if (rc != 0) fprintf(stderr, "[save_mask_pbm] Failed to save: %s\n", path);
+    return rc;
+}
+
+int save_mask_png(const char *path, const BitMask *mask) {
+    if (!path || !mask || !mask->bits) return -1;
+    size_t raw_len = (mask->stride + 1) * mask->height;
+    if (raw_len > 0x7fffffff) return -1;
+
+    unsigned char *raw = (unsigned char *)malloc(raw_len);
+    if (!raw) return -1;
+    for (int y = 0; y < mask->height; ++y) {
+        unsigned char *dst = raw + y * (mask->stride + 1);
+        dst[0] = 0;   // filter: none
+        memcpy(dst + 1, mask->bits + y * mask->stride, mask->stride);
+    }
+
+    int rc = write_png_raw(path, mask->width, mask->height, 1, 0, raw, (int)raw_len);
+    free(raw);
+    if (rc != 0) fprintf(stderr, "[save_mask_png] Failed to save: %s\n", path);
+    return rc;
+}
+
+void apply_box_blur(Image *img, int radius) {
+    if (!img || !img->data || img->channels < 3 || radius <= 0) return;
+
+    switch (img->type) {
+    case SAMPLE_U16: box_blur_u16(img, radius); break;
+    case SAMPLE_F32: box_blur_f32(img, radius); break;
+    default:         box_blur_u8(img, radius);  break;
+    }
+}
+
+static int sobel_dispatch(Image *img, SobelGradients *grad) {
+    switch (img->type) {
+    case SAMPLE_U16: return sobel_edge_u16(img, grad);
+    case SAMPLE_F32: return sobel_edge_f32(img, grad);
+    default:         return sobel_edge_u8(img, grad);
+    }
 }
 
 void apply_sobel_edge(Image *img) {
     if (!img || !img->data || img->channels < 3) return;
+    sobel_dispatch(img, NULL);
+}
 
-    int w = img->width;
-    int h = img->height;
-    int c = img->channels;
+static SobelGradients *alloc_gradients(int width, int height) {
+    SobelGradients *g = (SobelGradients *)malloc(sizeof(SobelGradients));
+    if (!g) return NULL;
+    size_t pixels = (size_t)width * height;
+    g->width  = width;
+    g->height = height;
+    g->gx     = (float *)calloc(pixels, sizeof(float));
+    g->gy     = (float *)calloc(pixels, sizeof(float));
+    if (!g->gx || !g->gy) {
+        free_gradients(g);
+        return NULL;
+    }
+    return g;
+}
 
-    int pixels = w * h;
-    unsigned char *gray = (unsigned char *)malloc(pixels);
-    if (!gray) {
+SobelGradients *apply_sobel_edge_gradients(Image *img) {
+    if (!img || !img->data || img->channels < 3) return NULL;
+    SobelGradients *g = alloc_gradients(img->width, img->height);
+    if (!g) {
         fprintf(stderr, "[apply_sobel_edge] Out of memory.\n");
-        return;
+        return NULL;
     }
+    if (sobel_dispatch(img, g) != 0 || filter_budget_exceeded()) {
+        free_gradients(g);
+        return NULL;
+    }
+    return g;
+}
 
-    // Convert to grayscale buffer for Sobel
-    for (int i = 0; i < pixels; ++i) {
-        unsigned char *p = &img->data[i * c];
-        unsigned char g = (unsigned char)(
-            0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2]
-        );
-        gray[i] = g;
+SobelGradients *sobel_gradients(const Image *img) {
+    Image *tmp = clone_image(img);
+    SobelGradients *g = tmp ? apply_sobel_edge_gradients(tmp) : NULL;
+    free_image(tmp);
+    return g;
+}
+
+void free_gradients(SobelGradients *g) {
+    if (!g) return;
+    free(g->gx);
+    free(g->gy);
+    free(g);
+}
+
+/*
+ * BATCHED SMALL-IMAGE PIPELINE
+ * ----------------------------
+ *
+ * For thumbnails the per-image cost is dominated by call overhead:
+ * argument checks, three mallocs and loop setup in each filter. The
+ * batch path stacks all images vertically into one slab of width
+ * max_w:
+ *
+ *   slab row y  ->  row_w[y]            valid width of that row
+ *                   row_top[y]/row_bot[y]  first/last slab row of its image
+ *
+ * Every stage is a single sweep over the slab that clamps windows to
+ * these per-row bounds, which reproduces the per-image border handling
+ * exactly. Padding columns beyond row_w[y] are never read or written.
+ */
+int apply_pipeline_batch(Image **imgs, int count, int radius) {
+    if (!imgs || count <= 0) return -1;
+
+    int max_w = 0;
+    long long rows = 0;
+    for (int i = 0; i < count; ++i) {
+        if (!imgs[i] || !imgs[i]->data || imgs[i]->channels != 3 ||
+            imgs[i]->type != SAMPLE_U8) return -1;
+        if (imgs[i]->width > max_w) max_w = imgs[i]->width;
+        rows += imgs[i]->height;
+    }
+    if (max_w == 0 || rows == 0) return 0;
+
+    const int c = 3;
+    size_t stride  = (size_t)max_w * c;
+    size_t rgb_sz  = stride * (size_t)rows;
+    size_t gray_sz = (size_t)max_w * (size_t)rows;
+
+    // One allocation per buffer kind for the whole batch
+    unsigned char *slab = (unsigned char *)malloc(rgb_sz);
+    unsigned char *tmp  = (unsigned char *)malloc(rgb_sz);
+    unsigned char *gray = (unsigned char *)malloc(gray_sz);
+    int *meta = (int *)malloc(sizeof(int) * 3 * (size_t)rows);
+    if (!slab || !tmp || !gray || !meta) {
+        fprintf(stderr, "[apply_pipeline_batch] Out of memory.\n");
+        free(slab); free(tmp); free(gray); free(meta);
+        return -1;
+    }
+    int *row_w   = meta;
+    int *row_top = meta + rows;
+    int *row_bot = meta + 2 * rows;
+
+    // Pack
+    long long y0 = 0;
+    for (int i = 0; i < count; ++i) {
+        const Image *im = imgs[i];
+        size_t src_stride = (size_t)im->width * c;
+        for (int y = 0; y < im->height; ++y) {
+            long long sy = y0 + y;
+            memcpy(slab + sy * stride, im->data + y * src_stride, src_stride);
+            row_w[sy]   = im->width;
+            row_top[sy] = (int)y0;
+            row_bot[sy] = (int)(y0 + im->height - 1);
+        }
+        y0 += im->height;
     }
 
-    unsigned char *out = (unsigned char *)malloc(pixels);
-    if (!out) {
-        fprintf(stderr, "[apply_sobel_edge] Out of memory.\n");
-        free(gray);
-        return;
-    }
-
-    int gx[3][3] = {
-        {-1, 0, 1},
-        {-2, 0, 2},
-        {-1, 0, 1}
-    };
-    int gy[3][3] = {
-        {-1, -2, -1},
-        { 0,  0,  0},
-        { 1,  2,  1}
-    };
-
-    for (int y = 1; y < h - 1; ++y) {
-        for (int x = 1; x < w - 1; ++x) {
-            int sumx = 0;
-            int sumy = 0;
-
-            for (int ky = -1; ky <= 1; ++ky) {
-                for (int kx = -1; kx <= 1; ++kx) {
-                    int px = x + kx;
-                    int py = y + ky;
-                    int idx = py * w + px;
-                    int val = gray[idx];
-
-                    sumx += gx[ky + 1][kx + 1] * val;
-                    sumy += gy[ky + 1][kx + 1] * val;
+    // Grayscale
+    for (long long y = 0; y < rows; ++y) {
+        unsigned char *row = slab + y * stride;
+        for (int x = 0; x < row_w[y]; ++x) {
+            unsigned char *p = &row[x * c];
+            unsigned char g = (unsigned char)(
+                0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2]
+            );
+            p[0] = p[1] = p[2] = g;
+        }
+    }
+
+    if (radius > 0) {
+        // Horizontal pass: running window sums (exact integer arithmetic)
+        for (long long y = 0; y < rows; ++y) {
+            const unsigned char *src = slab + y * stride;
+            unsigned char *dst = tmp + y * stride;
+            int w = row_w[y];
+            int rsum[3] = {0, 0, 0};
+            int hi0 = (radius >= w) ? w - 1 : radius;
+            for (int xx = 0; xx <= hi0; ++xx) {
+                rsum[0] += src[xx * c + 0];
+                rsum[1] += src[xx * c + 1];
+                rsum[2] += src[xx * c + 2];
+            }
+            for (int x = 0; x < w; ++x) {
+                int xmin = (x - radius < 0) ? 0 : x - radius;
+                int xmax = (x + radius >= w) ? w - 1 : x + radius;
+                int count_x = xmax - xmin + 1;
+                dst[x * c + 0] = (unsigned char)(rsum[0] / count_x);
+                dst[x * c + 1] = (unsigned char)(rsum[1] / count_x);
+                dst[x * c + 2] = (unsigned char)(rsum[2] / count_x);
+
+                int add = x + radius + 1;
+                int sub = x - radius;
+                if (add < w) {
+                    rsum[0] += src[add * c + 0];
+                    rsum[1] += src[add * c + 1];
+                    rsum[2] += src[add * c + 2];
                 }
+                if (sub >= 0) {
+                    rsum[0] -= src[sub * c + 0];
+                    rsum[1] -= src[sub * c + 1];
+                    rsum[2] -= src[sub * c + 2];
+                }
+            }
+        }
+
+        // Vertical pass: running column sums, reset at each image start
+        int *colsum = (int *)malloc(sizeof(int) * stride);
+        if (!colsum) {
+            fprintf(stderr, "[apply_pipeline_batch] Out of memory.\n");
+            free(slab); free(tmp); free(gray); free(meta);
+            return -1;
+        }
+        for (long long y = 0; y < rows; ++y) {
+            int top = row_top[y];
+            int bot = row_bot[y];
+            size_t n = (size_t)row_w[y] * c;
+
+            if (y == top) {
+                memset(colsum, 0, sizeof(int) * n);
+                long long hi0 = (top + radius > bot) ? bot : top + radius;
+                for (long long yy = top; yy <= hi0; ++yy) {
+                    const unsigned char *p = tmp + yy * stride;
+                    for (size_t k = 0; k < n; ++k) colsum[k] += p[k];
+                }
+            }
+
+            long long ymin = (y - radius < top) ? top : y - radius;
+            long long ymax = (y + radius > bot) ? bot : y + radius;
+            int count_y = (int)(ymax - ymin + 1);
+            unsigned char *dst = slab + y * stride;
+            for (size_t k = 0; k < n; ++k)
+                dst[k] = (unsigned char)(colsum[k] / count_y);
+
+            long long add = y + radius + 1;
+            long long sub = y - radius;
+            if (add <= bot) {
+                const unsigned char *p = tmp + add * stride;
+                for (size_t k = 0; k < n; ++k) colsum[k] += p[k];
             }
+            if (sub >= top) {
+                const unsigned char *p = tmp + sub * stride;
+                for (size_t k = 0; k < n; ++k) colsum[k] -= p[k];
+            }
+        }
+        free(colsum);
+    }
 
-            int mag = (int)sqrt((double)(sumx * sumx + sumy * sumy));
-            if (mag > 255) mag = 255;
-            if (mag < 0) mag = 0;
-            out[y * w + x] = (unsigned char)mag;
+    // Sobel: gray plane, then 3x3 stencil on each image's interior
+    for (long long y = 0; y < rows; ++y) {
+        const unsigned char *row = slab + y * stride;
+        unsigned char *g = gray + y * (size_t)max_w;
+        for (int x = 0; x < row_w[y]; ++x) {
+            const unsigned char *p = &row[x * c];
+            g[x] = (unsigned char)(0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2]);
         }
     }
 
-    // copy edges back into RGB image (grayscale)
-    for (int i = 0; i < pixels; ++i) {
-        unsigned char e = out[i];
-        img->data[i * c + 0] = e;
-        img->data[i * c + 1] = e;
-        img->data[i * c + 2] = e;
+    for (long long y = 0; y < rows; ++y) {
+        unsigned char *dst = slab + y * stride;
+        int w = row_w[y];
+        int interior = (y > row_top[y] && y < row_bot[y]);
+        const unsigned char *up = gray + (y - 1) * (size_t)max_w;
+        const unsigned char *md = gray + y * (size_t)max_w;
+        const unsigned char *dn = gray + (y + 1) * (size_t)max_w;
+
+        for (int x = 0; x < w; ++x) {
+            int mag = 0;
+            if (interior && x > 0 && x < w - 1) {
+                int sumx = -up[x - 1] + up[x + 1]
+                           - 2 * md[x - 1] + 2 * md[x + 1]
+                           - dn[x - 1] + dn[x + 1];
+                int sumy = -up[x - 1] - 2 * up[x] - up[x + 1]
+                           + dn[x - 1] + 2 * dn[x] + dn[x + 1];
+                mag = (int)sqrt((double)(sumx * sumx + sumy * sumy));
+                if (mag > 255) mag = 255;
+            }
+            dst[x * c + 0] = dst[x * c + 1] = dst[x * c + 2] = (unsigned char)mag;
+        }
+    }
+
+    // Unpack
+    y0 = 0;
+    for (int i = 0; i < count; ++i) {
+        Image *im = imgs[i];
+        size_t dst_stride = (size_t)im->width * c;
+        for (int y = 0; y < im->height; ++y)
+            memcpy(im->data + y * dst_stride, slab + (y0 + y) * stride, dst_stride);
+        y0 += im->height;
     }
 
+    free(slab);
+    free(tmp);
     free(gray);
-    free(out);
+    free(meta);
+    return 0;
 }
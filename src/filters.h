@@ -4,37 +4,229 @@
 #include <stddef.h>
 
 /**
- * Simple image representation: interleaved unsigned char RGB.
+ * Sample type of an image buffer.
+ */
+typedef enum {
+    SAMPLE_U8 = 0,     // unsigned char, 0..255 (default pipeline)
+    SAMPLE_U16,        // uint16_t, 0..65535
+    SAMPLE_F32         // float, nominally 0..1
+} SampleType;
+
+/**
+ * Simple image representation: interleaved RGB samples of `type`.
+ * data points to width * height * channels samples.
  */
 typedef struct {
     int width;
     int height;
     int channels;      // always 3 (RGB) for our pipeline
+    SampleType type;
     unsigned char *data;
 } Image;
 
 /**
- * Load image from disk as 3-channel RGB.
+ * Bytes per sample, and total pixel-buffer bytes of an image.
+ */
+size_t sample_size(SampleType type);
+size_t image_bytes(const Image *img);
+
+/**
+ * "u8" / "u16" / "f32" <-> SampleType. parse returns 0 on success.
+ */
+const char *sample_type_name(SampleType type);
+int parse_sample_type(const char *name, SampleType *out);
+
+/**
+ * Load image from disk as 3-channel 8-bit RGB.
  * Returns NULL on failure.
  */
 Image *load_image(const char *path);
 
 /**
- * Save image as PNG to disk.
+ * Load image from disk as 3-channel RGB with the given sample type:
+ * u8 via stbi_load, u16 via stbi_load_16, f32 via stbi_loadf for HDR
+ * files or 16-bit decode normalized to [0, 1] otherwise.
+ * Returns NULL on failure.
+ */
+Image *load_image_typed(const char *path, SampleType type);
+
+/**
+ * Read only the header of an image file (no decode).
+ * Returns 0 and fills width/height on success, -1 otherwise.
+ */
+int image_info(const char *path, int *width, int *height);
+
+/**
+ * Pre-decode size limits (0 = unlimited). max_bytes bounds the decoded
+ * pixel buffer: width * height * 3 * sample size.
+ */
+typedef struct {
+    long long max_pixels;
+    long long max_bytes;
+} DecodeLimits;
+
+/**
+ * Read only the header of path and check it against limits before any
+ * pixel memory is allocated. width/height (may be NULL) receive the
+ * header dimensions. Returns 0 if the image may be decoded, 1 if it
+ * exceeds a limit, -1 if the header cannot be read.
+ */
+int check_decode_limits(const char *path, SampleType type,
+                        const DecodeLimits *limits, int *width, int *height);
+
+/**
+ * Cooperative time budget for the filters run by the calling thread.
+ * After filter_budget_arm(seconds), apply_grayscale/box_blur/sobel_edge
+ * check the clock between bands of rows and return early once the
+ * budget is spent, leaving the image partially filtered;
+ * filter_budget_exceeded() then returns 1 until the next arm/disarm.
+ * seconds <= 0 arms no limit. The batched pipeline is not budgeted.
+ */
+void filter_budget_arm(double seconds);
+void filter_budget_disarm(void);
+int  filter_budget_exceeded(void);
+
+/**
+ * Save image as PNG to disk: 8-bit for u8, 16-bit for u16 and f32
+ * (f32 clamped to [0, 1]).
  * Returns 0 on success, non-zero on failure.
  */
 int save_image_png(const char *path, const Image *img);
 
+/**
+ * Deep copy of an image (header and pixel buffer).
+ * Returns NULL on failure.
+ */
+Image *clone_image(const Image *img);
+
 /**
  * Free image memory.
  */
 void free_image(Image *img);
 
 /**
- * In-place filters.
+ * In-place filters. Each one dispatches on img->type.
  */
 void apply_grayscale(Image *img);
 void apply_box_blur(Image *img, int radius);
 void apply_sobel_edge(Image *img);
 
+/**
+ * Raw Sobel gradients of the luminance, one float per pixel, 1-pixel
+ * border 0. Corner detection (corners.c) needs gx/gy, which
+ * apply_sobel_edge computes and throws away.
+ */
+typedef struct {
+    int    width;
+    int    height;
+    float *gx;
+    float *gy;
+} SobelGradients;
+
+/**
+ * apply_sobel_edge that also returns the gradients, so edges and
+ * corners share one Sobel pass. The edge output is identical.
+ * Returns NULL (image unfiltered or partially filtered) on failure or
+ * when the time budget ran out.
+ */
+SobelGradients *apply_sobel_edge_gradients(Image *img);
+
+/**
+ * Gradients only; img is left unchanged.
+ */
+SobelGradients *sobel_gradients(const Image *img);
+void free_gradients(SobelGradients *g);
+
+/**
+ * Pointwise tone stages, applied to every sample in place. Levels are
+ * fractions of full scale (255, 65535 or 1.0). Each call is one sweep.
+ *   gamma:     v' = v^gamma on [0, 1]
+ *   invert:    v' = full scale - v
+ *   threshold: v' = full scale if v >= level, else 0
+ *   clamp:     v' = v limited to [lo, hi]
+ *   stretch:   v' = (v - lo) / (hi - lo) * full scale, clamped
+ *   posterize: v' = v quantized to `levels` evenly spaced values
+ */
+void apply_gamma(Image *img, double gamma);
+void apply_invert(Image *img);
+void apply_threshold(Image *img, double level);
+void apply_clamp(Image *img, double lo, double hi);
+void apply_contrast_stretch(Image *img, double lo, double hi);
+void apply_posterize(Image *img, int levels);
+
+typedef struct {
+    double gamma;
+    double clamp_lo;
+    double clamp_hi;
+    double threshold;
+} ToneParams;
+
+/**
+ * grayscale -> gamma -> clamp -> invert -> threshold composed at
+ * compile time into one sweep (see filters_kernels.h). Bit-exact with
+ * the five calls above made in that order.
+ */
+void apply_tone_fused(Image *img, const ToneParams *params);
+
+/**
+ * Replace every 8-bit sample v with lut[v] in one sweep (all channels).
+ * Uses AVX-512 VBMI or AVX2 table lookups when the CPU has them; the
+ * result is identical on every path. No-op for u16/f32 images.
+ */
+void apply_lut_u8(Image *img, const unsigned char lut[256]);
+
+/**
+ * "vbmi", "avx2" or "scalar": the path apply_lut_u8() takes on this CPU.
+ */
+const char *lut_backend_name(void);
+
+/**
+ * Bit-packed 1-bit-per-pixel mask. Rows are `stride` = (width + 7) / 8
+ * bytes, most significant bit first, padding bits zero: the row layout
+ * of PBM (P4) and 1-bit PNG.
+ */
+typedef struct {
+    int            width;
+    int            height;
+    size_t         stride;
+    unsigned char *bits;
+} BitMask;
+
+/**
+ * Otsu's threshold for channel 0 of img, as a level in [0, 1] for
+ * threshold_mask(). The 256-bin histogram is built in parallel when
+ * compiled with OpenMP. Returns 0.5 for an empty or constant image.
+ */
+double otsu_level(const Image *img);
+
+/**
+ * Mask of the pixels whose channel-0 sample is >= level * full scale
+ * (the test apply_threshold uses). Meant for gray images, e.g. after
+ * grayscale or Sobel. 3-channel u8 input uses SSSE3 shuffles + movemask
+ * when available. Returns NULL on failure or if the filter time budget
+ * ran out.
+ */
+BitMask *threshold_mask(const Image *img, double level);
+
+/**
+ * Write a mask as binary PBM (P4) or as 1-bit grayscale PNG. The bits
+ * are written unchanged, so set pixels are black in PBM and white in
+ * PNG (each format's convention). Return 0 on success.
+ */
+int save_mask_pbm(const char *path, const BitMask *mask);
+int save_mask_png(const char *path, const BitMask *mask);
+
+void free_mask(BitMask *mask);
+
+/**
+ * Run grayscale -> box blur(radius) -> Sobel on many small images at
+ * once. The images are packed into one slab and each filter runs once
+ * over it, with per-row bounds masking the image borders, so per-call
+ * setup and allocations are paid once per batch instead of per image.
+ * Results are bit-exact with the per-image filters above.
+ * All images must be 3-channel u8. Returns 0 on success, -1 on failure
+ * (images are left untouched).
+ */
+int apply_pipeline_batch(Image **imgs, int count, int radius);
+
 #endif // FILTERS_H
@@ -0,0 +1,445 @@
+/*
+ * Per-sample-type filter kernels.
+ *
+ * NOT a normal header: filters.c includes it once per sample type, C's
+ * stand-in for a function template. Before each inclusion define:
+ *
+ *   SAMPLE_T       sample type               (unsigned char, uint16_t, float)
+ *   SAMPLE_ACC     accumulator type          (int, long long, float)
+ *   SAMPLE_MAX     clamp for Sobel magnitude (255, 65535, 1.0f)
+ *   SAMPLE_SUFFIX  name suffix               (u8, u16, f32)
+ *   SOBEL_T        Sobel partial-sum lane    (int16_t, int32_t, float)
+ *   SOBEL_SEPARABLE 1 = separable Sobel sums (exact for integer samples)
+ *
+ * The u8 instantiation is exactly the original 8-bit code path.
+ * FILTER_SIMD marks loops whose iterations are independent so the
+ * compiler may vectorize them (omp simd when built with OpenMP).
+ * Row loops call budget_expired() once per FILTER_BAND_ROWS rows and
+ * return early when the per-image time budget has run out.
+ */
+
+#define KERNEL_NAME2(name, suffix) name##_##suffix
+#define KERNEL_NAME1(name, suffix) KERNEL_NAME2(name, suffix)
+#define KERNEL(name) KERNEL_NAME1(name, SAMPLE_SUFFIX)
+
+/*
+ * FUSED POINTWISE STAGES
+ * ----------------------
+ *
+ * A pointwise stage is a static inline SAMPLE_T -> SAMPLE_T function.
+ * A chain is a macro CHAIN(v, k) nesting stage calls, and the kernel
+ * macros below expand a chain into a single loop body:
+ *
+ *   POINTWISE_LUMA_KERNEL    luminance once per pixel, chain, store to
+ *                            all three channels
+ *   POINTWISE_SAMPLE_KERNEL  chain on every sample independently
+ *
+ * All stages inline into that body, so N chained stages cost one
+ * memory sweep instead of N and the compiler vectorizes the composed
+ * expression. Each stage truncates to SAMPLE_T exactly as its
+ * standalone apply_* call does, so a fused chain is bit-exact with the
+ * unfused sequence. grayscale is the luma kernel with an empty chain.
+ */
+
+typedef struct {
+    double   gamma;
+    double   inv_max;     // 1 / SAMPLE_MAX
+    SAMPLE_T lo;          // clamp bounds in sample units
+    SAMPLE_T hi;
+    double   level;       // threshold in sample units
+    double   s_lo;        // contrast stretch: input black point
+    double   s_scale;     //   SAMPLE_MAX / (white point - black point)
+    int      levels;      // posterize
+    double   post_step;   //   SAMPLE_MAX / (levels - 1)
+} KERNEL(pw_const);
+
+static void KERNEL(pw_setup)(KERNEL(pw_const) *k, const PointwiseParams *p) {
+    k->gamma   = p->tone.gamma;
+    k->inv_max = 1.0 / (double)SAMPLE_MAX;
+    k->lo      = (SAMPLE_T)(p->tone.clamp_lo * SAMPLE_MAX);
+    k->hi      = (SAMPLE_T)(p->tone.clamp_hi * SAMPLE_MAX);
+    k->level   = p->tone.threshold * SAMPLE_MAX;
+
+    double span = (p->stretch_hi - p->stretch_lo) * SAMPLE_MAX;
+    k->s_lo      = p->stretch_lo * SAMPLE_MAX;
+    k->s_scale   = (span > 0.0) ? SAMPLE_MAX / span : 0.0;
+    k->levels    = (p->levels >= 2) ? p->levels : 2;
+    k->post_step = (double)SAMPLE_MAX / (k->levels - 1);
+}
+
+static inline SAMPLE_T KERNEL(pw_gamma)(SAMPLE_T v, const KERNEL(pw_const) *k) {
+    double x = (double)v * k->inv_max;
+    if (x <= 0.0) return (SAMPLE_T)0;
+    return (SAMPLE_T)(SAMPLE_MAX * pow(x, k->gamma));
+}
+
+static inline SAMPLE_T KERNEL(pw_invert)(SAMPLE_T v, const KERNEL(pw_const) *k) {
+    (void)k;
+    return (SAMPLE_T)(SAMPLE_MAX - v);
+}
+
+static inline SAMPLE_T KERNEL(pw_threshold)(SAMPLE_T v, const KERNEL(pw_const) *k) {
+    return ((double)v >= k->level) ? (SAMPLE_T)SAMPLE_MAX : (SAMPLE_T)0;
+}
+
+static inline SAMPLE_T KERNEL(pw_clamp)(SAMPLE_T v, const KERNEL(pw_const) *k) {
+    return (v < k->lo) ? k->lo : (v > k->hi) ? k->hi : v;
+}
+
+static inline SAMPLE_T KERNEL(pw_stretch)(SAMPLE_T v, const KERNEL(pw_const) *k) {
+    double x = ((double)v - k->s_lo) * k->s_scale;
+    if (x <= 0.0) return (SAMPLE_T)0;
+    if (x >= SAMPLE_MAX) return (SAMPLE_T)SAMPLE_MAX;
+    return (SAMPLE_T)x;
+}
+
+static inline SAMPLE_T KERNEL(pw_posterize)(SAMPLE_T v, const KERNEL(pw_const) *k) {
+    int q = (int)((double)v * k->inv_max * k->levels);
+    if (q >= k->levels) q = k->levels - 1;
+    if (q < 0) q = 0;
+    return (SAMPLE_T)(q * k->post_step);
+}
+
+#define PW_IDENTITY(v, k)  (v)
+#define PW_GAMMA(v, k)     KERNEL(pw_gamma)(v, k)
+#define PW_INVERT(v, k)    KERNEL(pw_invert)(v, k)
+#define PW_THRESHOLD(v, k) KERNEL(pw_threshold)(v, k)
+#define PW_CLAMP(v, k)     KERNEL(pw_clamp)(v, k)
+#define PW_STRETCH(v, k)   KERNEL(pw_stretch)(v, k)
+#define PW_POSTERIZE(v, k) KERNEL(pw_posterize)(v, k)
+
+// gamma -> clamp -> invert -> threshold, after luminance
+#define PW_TONE_CHAIN(v, k) \
+    PW_THRESHOLD(PW_INVERT(PW_CLAMP(PW_GAMMA(v, k), k), k), k)
+
+#define POINTWISE_LUMA_KERNEL(name, CHAIN)                                   \
+static void KERNEL(name)(Image *img, const KERNEL(pw_const) *k) {            \
+    SAMPLE_T *data = (SAMPLE_T *)img->data;                                  \
+    int pixels = img->width * img->height;                                   \
+    int band = img->width * FILTER_BAND_ROWS;                                \
+    int c = img->channels;                                                   \
+    (void)k;                                                                 \
+                                                                             \
+    for (int start = 0; start < pixels; start += band) {                     \
+        if (budget_expired()) return;                                        \
+        int end = (pixels - start < band) ? pixels : start + band;           \
+                                                                             \
+        FILTER_SIMD                                                          \
+        for (int i = start; i < end; ++i) {                                  \
+            SAMPLE_T *p = &data[i * c];                                      \
+            /* simple luminance */                                           \
+            SAMPLE_T v = (SAMPLE_T)(                                         \
+                0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2]                   \
+            );                                                               \
+            v = CHAIN(v, k);                                                 \
+            p[0] = p[1] = p[2] = v;                                          \
+        }                                                                    \
+    }                                                                        \
+}
+
+#define POINTWISE_SAMPLE_KERNEL(name, CHAIN)                                 \
+static void KERNEL(name)(Image *img, const KERNEL(pw_const) *k) {            \
+    SAMPLE_T *data = (SAMPLE_T *)img->data;                                  \
+    size_t samples = (size_t)img->width * img->height * img->channels;       \
+    size_t band = (size_t)img->width * img->channels * FILTER_BAND_ROWS;     \
+                                                                             \
+    for (size_t start = 0; start < samples; start += band) {                 \
+        if (budget_expired()) return;                                        \
+        size_t end = (samples - start < band) ? samples : start + band;      \
+                                                                             \
+        FILTER_SIMD                                                          \
+        for (size_t i = start; i < end; ++i)                                 \
+            data[i] = CHAIN(data[i], k);                                     \
+    }                                                                        \
+}
+
+POINTWISE_LUMA_KERNEL(grayscale, PW_IDENTITY)
+POINTWISE_LUMA_KERNEL(tone_fused, PW_TONE_CHAIN)
+POINTWISE_SAMPLE_KERNEL(gamma, PW_GAMMA)
+POINTWISE_SAMPLE_KERNEL(invert, PW_INVERT)
+POINTWISE_SAMPLE_KERNEL(threshold, PW_THRESHOLD)
+POINTWISE_SAMPLE_KERNEL(clamp, PW_CLAMP)
+POINTWISE_SAMPLE_KERNEL(stretch, PW_STRETCH)
+POINTWISE_SAMPLE_KERNEL(posterize, PW_POSTERIZE)
+
+#undef POINTWISE_LUMA_KERNEL
+#undef POINTWISE_SAMPLE_KERNEL
+#undef PW_TONE_CHAIN
+#undef PW_IDENTITY
+#undef PW_GAMMA
+#undef PW_INVERT
+#undef PW_THRESHOLD
+#undef PW_CLAMP
+#undef PW_STRETCH
+#undef PW_POSTERIZE
+
+static void KERNEL(box_blur)(Image *img, int radius) {
+    int w = img->width;
+    int h = img->height;
+    int c = img->channels;
+    size_t size = (size_t)w * h * c;
+
+    SAMPLE_T *src = (SAMPLE_T *)img->data;
+    SAMPLE_T *tmp = (SAMPLE_T *)malloc(size * sizeof(SAMPLE_T));
+    if (!tmp) {
+        fprintf(stderr, "[apply_box_blur] Out of memory.\n");
+        return;
+    }
+
+    // Horizontal pass
+    for (int y = 0; y < h; ++y) {
+        if (y % FILTER_BAND_ROWS == 0 && budget_expired()) {
+            free(tmp);
+            return;
+        }
+
+        FILTER_SIMD
+        for (int x = 0; x < w; ++x) {
+            SAMPLE_ACC rsum[3] = {0, 0, 0};
+            int count = 0;
+
+            int xmin = (x - radius < 0) ? 0 : x - radius;
+            int xmax = (x + radius >= w) ? w - 1 : x + radius;
+
+            for (int xx = xmin; xx <= xmax; ++xx) {
+                int idx = (y * w + xx) * c;
+                rsum[0] += src[idx + 0];
+                rsum[1] += src[idx + 1];
+                rsum[2] += src[idx + 2];
+                count++;
+            }
+
+            int out_idx = (y * w + x) * c;
+            tmp[out_idx + 0] = (SAMPLE_T)(rsum[0] / count);
+            tmp[out_idx + 1] = (SAMPLE_T)(rsum[1] / count);
+            tmp[out_idx + 2] = (SAMPLE_T)(rsum[2] / count);
+        }
+    }
+
+    // Vertical pass (in-place back into src)
+    for (int y = 0; y < h; ++y) {
+        if (y % FILTER_BAND_ROWS == 0 && budget_expired()) {
+            free(tmp);
+            return;
+        }
+
+        int ymin = (y - radius < 0) ? 0 : y - radius;
+        int ymax = (y + radius >= h) ? h - 1 : y + radius;
+
+        FILTER_SIMD
+        for (int x = 0; x < w; ++x) {
+            SAMPLE_ACC rsum[3] = {0, 0, 0};
+            int count = 0;
+
+            for (int yy = ymin; yy <= ymax; ++yy) {
+                int idx = (yy * w + x) * c;
+                rsum[0] += tmp[idx + 0];
+                rsum[1] += tmp[idx + 1];
+                rsum[2] += tmp[idx + 2];
+                count++;
+            }
+
+            int out_idx = (y * w + x) * c;
+            src[out_idx + 0] = (SAMPLE_T)(rsum[0] / count);
+            src[out_idx + 1] = (SAMPLE_T)(rsum[1] / count);
+            src[out_idx + 2] = (SAMPLE_T)(rsum[2] / count);
+        }
+    }
+
+    free(tmp);
+}
+
+/*
+ * ROW-STREAMING SOBEL
+ * -------------------
+ *
+ * Sobel is separable: gx = [1 2 1]^T (x) [-1 0 1], gy = [-1 0 1]^T (x)
+ * [1 2 1]. Per output row y, with luminance rows r0, r1, r2 (y - 1, y,
+ * y + 1) in a ring of three SOBEL_T rows:
+ *
+ *   vs[x] = r0[x] + 2 r1[x] + r2[x]          vertical smoothing
+ *   vd[x] = r2[x] - r0[x]                    vertical difference
+ *   gx[x] = vs[x + 1] - vs[x - 1]
+ *   gy[x] = vd[x - 1] + 2 vd[x] + vd[x + 1]
+ *
+ * so a pixel costs about seven adds, the vertical terms shared with its
+ * neighbours, instead of 9 multiply-adds per gradient through the
+ * kernel tables. Every loop is a straight pass
+ * over SOBEL_T lanes (int16 for u8, whose sums stay within +-1020).
+ * Integer sums are exact, so the result is bit-identical to the 3x3
+ * stencil; f32 (SOBEL_SEPARABLE 0) keeps the stencil's summation order
+ * on the same row ring for the same reason.
+ *
+ * Only the ring is allocated: luminance of row y + 1 is taken when it
+ * is needed, and row y of the image is overwritten once its luminance
+ * is in the ring.
+ */
+
+/* Luminance of one image row into SOBEL_T lanes, as apply_grayscale. */
+static void KERNEL(sobel_luma_row)(const SAMPLE_T *p, int c, int w, SOBEL_T *row) {
+    FILTER_SIMD
+    for (int x = 0; x < w; ++x) {
+        const SAMPLE_T *q = &p[x * c];
+        row[x] = (SOBEL_T)(SAMPLE_T)(0.299 * q[0] + 0.587 * q[1] + 0.114 * q[2]);
+    }
+}
+
+/* Clamped magnitude of one gradient pair. */
+static inline SAMPLE_T KERNEL(sobel_mag)(SAMPLE_ACC sx, SAMPLE_ACC sy) {
+    SAMPLE_ACC mag = (SAMPLE_ACC)sqrt((double)(sx * sx + sy * sy));
+    if (mag > SAMPLE_MAX) mag = SAMPLE_MAX;
+    if (mag < 0) mag = 0;
+    return (SAMPLE_T)mag;
+}
+
+/*
+ * Sobel magnitude of img's luminance, in place into channels 0-2 (the
+ * 1-pixel border becomes 0). When gxo/gyo are non-NULL the raw
+ * gradients are stored there (border left untouched). Returns -1 if the
+ * time budget ran out, leaving the image partly filtered.
+ */
+static int KERNEL(sobel_core)(Image *img, float *gxo, float *gyo) {
+    int w = img->width;
+    int h = img->height;
+    int c = img->channels;
+    SAMPLE_T *data = (SAMPLE_T *)img->data;
+
+    if (w < 3 || h < 3) {
+        memset(data, 0, (size_t)w * h * c * sizeof(SAMPLE_T));
+        return 0;
+    }
+
+    SOBEL_T *buf = (SOBEL_T *)malloc((size_t)w * 7 * sizeof(SOBEL_T));
+    if (!buf) {
+        fprintf(stderr, "[apply_sobel_edge] Out of memory.\n");
+        return -1;
+    }
+    SOBEL_T *ring[3] = { buf, buf + w, buf + 2 * w };
+    SOBEL_T *vs = buf + 3 * w;
+    SOBEL_T *vd = buf + 4 * w;
+    SOBEL_T *gx = buf + 5 * w;
+    SOBEL_T *gy = buf + 6 * w;
+
+    KERNEL(sobel_luma_row)(data, c, w, ring[0]);
+    KERNEL(sobel_luma_row)(data + (size_t)w * c, c, w, ring[1]);
+
+    for (int y = 1; y < h - 1; ++y) {
+        if (y % FILTER_BAND_ROWS == 0 && budget_expired()) {
+            free(buf);
+            return -1;
+        }
+
+        const SOBEL_T *r0 = ring[(y - 1) % 3];
+        const SOBEL_T *r1 = ring[y % 3];
+        SOBEL_T *r2 = ring[(y + 1) % 3];
+        KERNEL(sobel_luma_row)(data + (size_t)(y + 1) * w * c, c, w, r2);
+
+#if SOBEL_SEPARABLE
+        FILTER_SIMD
+        for (int x = 0; x < w; ++x) {
+            vs[x] = r0[x] + 2 * r1[x] + r2[x];
+            vd[x] = r2[x] - r0[x];
+        }
+        FILTER_SIMD
+        for (int x = 1; x < w - 1; ++x) {
+            gx[x] = vs[x + 1] - vs[x - 1];
+            gy[x] = vd[x - 1] + 2 * vd[x] + vd[x + 1];
+        }
+#else
+        (void)vs;
+        (void)vd;
+        FILTER_SIMD
+        for (int x = 1; x < w - 1; ++x) {
+            gx[x] = -r0[x - 1] + r0[x + 1] - 2 * r1[x - 1] + 2 * r1[x + 1]
+                    - r2[x - 1] + r2[x + 1];
+            gy[x] = -r0[x - 1] - 2 * r0[x] - r0[x + 1]
+                    + r2[x - 1] + 2 * r2[x] + r2[x + 1];
+        }
+#endif
+
+        if (gxo) {
+            float *gxr = gxo + (size_t)y * w;
+            float *gyr = gyo + (size_t)y * w;
+            FILTER_SIMD
+            for (int x = 1; x < w - 1; ++x) {
+                gxr[x] = (float)gx[x];
+                gyr[x] = (float)gy[x];
+            }
+        }
+
+        SAMPLE_T *row = data + (size_t)y * w * c;
+        FILTER_SIMD
+        for (int x = 1; x < w - 1; ++x) {
+            SAMPLE_T e = KERNEL(sobel_mag)((SAMPLE_ACC)gx[x], (SAMPLE_ACC)gy[x]);
+            row[x * c + 0] = e;
+            row[x * c + 1] = e;
+            row[x * c + 2] = e;
+        }
+        for (int k = 0; k < 3; ++k) {
+            row[k] = 0;
+            row[(w - 1) * c + k] = 0;
+        }
+    }
+
+    // first and last rows: their luminance was taken above
+    for (int x = 0; x < w; ++x) {
+        for (int k = 0; k < 3; ++k) {
+            data[x * c + k] = 0;
+            data[((size_t)(h - 1) * w + x) * c + k] = 0;
+        }
+    }
+
+    free(buf);
+    return 0;
+}
+
+/*
+ * Sobel magnitude in place; gradients kept in grad when non-NULL.
+ * Returns -1 (image not or only partly filtered) like sobel_core.
+ */
+static int KERNEL(sobel_edge)(Image *img, SobelGradients *grad) {
+    return KERNEL(sobel_core)(img, grad ? grad->gx : NULL, grad ? grad->gy : NULL);
+}
+
+/*
+ * Binary mask of channel 0 >= level * SAMPLE_MAX, bits MSB first (see
+ * BitMask). Returns -1 if the time budget ran out.
+ */
+static int KERNEL(mask_rows)(const Image *img, double level, BitMask *m) {
+    const SAMPLE_T *data = (const SAMPLE_T *)img->data;
+    double limit = level * SAMPLE_MAX;
+    int w = img->width;
+    int c = img->channels;
+
+    for (int y = 0; y < img->height; ++y) {
+        if (y % FILTER_BAND_ROWS == 0 && budget_expired()) return -1;
+        const SAMPLE_T *row = data + (size_t)y * w * c;
+        unsigned char *bits = m->bits + (size_t)y * m->stride;
+        for (int x = 0; x < w; ++x)
+            if ((double)row[(size_t)x * c] >= limit)
+                bits[x >> 3] |= (unsigned char)(0x80 >> (x & 7));
+    }
+    return 0;
+}
+
+/* 256-bin histogram of channel 0; bin = sample * scale, clamped. */
+static void KERNEL(histogram)(const Image *img, double scale, long long *hist) {
+    const SAMPLE_T *data = (const SAMPLE_T *)img->data;
+    long long bins[256] = { 0 };
+    int w = img->width;
+    int c = img->channels;
+
+    FILTER_HISTOGRAM_FOR
+    for (int y = 0; y < img->height; ++y) {
+        const SAMPLE_T *row = data + (size_t)y * w * c;
+        for (int x = 0; x < w; ++x) {
+            double b = (double)row[(size_t)x * c] * scale;
+            bins[!(b > 0.0) ? 0 : (b >= 255.0) ? 255 : (int)b]++;
+        }
+    }
+    memcpy(hist, bins, sizeof(bins));
+}
+
+#undef KERNEL
+#undef KERNEL_NAME1
+#undef KERNEL_NAME2
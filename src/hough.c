@@ -0,0 +1,431 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "hough.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#if defined(_OPENMP)
+#include <omp.h>
+#define HOUGH_PARALLEL _Pragma("omp parallel")
+#define HOUGH_FOR      _Pragma("omp for schedule(static)")
+#define HOUGH_PARALLEL_FOR _Pragma("omp parallel for schedule(static)")
+#else
+#define HOUGH_PARALLEL
+#define HOUGH_FOR
+#define HOUGH_PARALLEL_FOR
+#endif
+
+/*
+ * HOUGH LINE TRANSFORM
+ * --------------------
+ *
+ * Every edge pixel (x, y) votes for the lines through it:
+ *
+ *   rho = x cos(theta) + y sin(theta)     for each theta bin
+ *
+ * into an accumulator of n_theta x n_rho cells. cos and sin come from
+ * per-bin tables pre-scaled by 1 / rho_step, so a vote costs two
+ * multiply-adds, a round and an increment.
+ *
+ * Votes hit cells all over the accumulator, so a shared accumulator
+ * would need an atomic increment per vote and threads would fight over
+ * cache lines. Each thread votes into its own private copy instead:
+ *
+ *   vote    edge pixels split statically over threads   (parallel)
+ *   merge   cell i = sum of the thread copies' cell i   (parallel
+ *           over cells; a reduction with no shared writes)
+ *   peaks   cells >= min_votes that are maximal within peak_radius,
+ *           strongest max_lines kept
+ *
+ * Memory is threads x cells x 4 bytes (180 x 2 x 10000 x 4 = 14 MB per
+ * thread for a 50 MP image). atomic_votes switches to one shared
+ * accumulator for comparison.
+ *
+ * With gradient input (hough_from_gray), the Sobel gradient at an edge
+ * pixel is normal to the line through it, so the pixel only votes for
+ * theta within theta_window bins of the gradient angle. That is about
+ * 17 votes per pixel instead of 180.
+ */
+
+void hough_default_params(HoughParams *p) {
+    p->n_theta      = 180;
+    p->rho_step     = 1.0;
+    p->theta_window = 8;
+    p->max_lines    = 16;
+    p->min_votes    = 50;
+    p->peak_radius  = 4;
+    p->atomic_votes = 0;
+}
+
+typedef struct {
+    int       n_theta;
+    int       n_rho;
+    int       offset;      // rho bin of rho = 0
+    size_t    cells;
+    float    *cos_t;       // cos(theta) / rho_step
+    float    *sin_t;
+    int       threads;     // size of the voting team
+    int       atomic;
+    uint32_t *priv;        // threads * cells, allocated by acc_mine()
+    uint32_t *acc;         // merged accumulator
+} Accumulator;
+
+static void acc_free(Accumulator *a) {
+    free(a->cos_t);
+    free(a->sin_t);
+    free(a->priv);
+    free(a->acc);
+}
+
+static int acc_init(Accumulator *a, int width, int height, const HoughParams *p) {
+    memset(a, 0, sizeof(*a));
+    if (p->n_theta <= 0 || p->rho_step <= 0.0) return -1;
+
+    double diag = sqrt((double)width * width + (double)height * height);
+    a->n_theta = p->n_theta;
+    a->offset  = (int)ceil(diag / p->rho_step) + 1;
+    a->n_rho   = 2 * a->offset + 1;
+    a->cells   = (size_t)a->n_theta * a->n_rho;
+    a->atomic  = p->atomic_votes;
+    a->threads = 1;
+
+    a->cos_t = (float *)malloc((size_t)a->n_theta * sizeof(float));
+    a->sin_t = (float *)malloc((size_t)a->n_theta * sizeof(float));
+    a->acc   = (uint32_t *)calloc(a->cells, sizeof(uint32_t));
+    if (!a->cos_t || !a->sin_t || !a->acc) {
+        acc_free(a);
+        return -1;
+    }
+    for (int t = 0; t < a->n_theta; ++t) {
+        double theta = M_PI * t / a->n_theta;
+        a->cos_t[t] = (float)(cos(theta) / p->rho_step);
+        a->sin_t[t] = (float)(sin(theta) / p->rho_step);
+    }
+    return 0;
+}
+
+/*
+ * Counter array of the calling thread; every thread of the voting team
+ * calls it. The team can be smaller than omp_get_max_threads() (inside
+ * another parallel region it is often 1), so one thread allocates a
+ * copy per actual member and each member clears its own. Returns NULL
+ * for all threads if that allocation fails.
+ */
+static uint32_t *acc_mine(Accumulator *a) {
+#if defined(_OPENMP)
+    #pragma omp single
+#endif
+    {
+#if defined(_OPENMP)
+        a->threads = omp_get_num_threads();
+#endif
+        if (!a->atomic)
+            a->priv = (uint32_t *)malloc((size_t)a->threads * a->cells * sizeof(uint32_t));
+    }
+    if (a->atomic) return a->acc;
+    if (!a->priv) return NULL;
+    int tid = 0;
+#if defined(_OPENMP)
+    tid = omp_get_thread_num();
+#endif
+    uint32_t *mine = a->priv + (size_t)tid * a->cells;
+    memset(mine, 0, a->cells * sizeof(uint32_t));
+    return mine;
+}
+
+/* Vote for theta bins [t0, t1] (wrapping modulo n_theta). */
+static inline long long vote(const Accumulator *a, uint32_t *acc,
+                             int x, int y, int t0, int t1) {
+    float fx = (float)x, fy = (float)y;
+    float bias = (float)a->offset + 0.5f;   // round half up, index >= 0
+    for (int t = t0; t <= t1; ++t) {
+        int tt = (t < 0) ? t + a->n_theta : (t >= a->n_theta) ? t - a->n_theta : t;
+        int r = (int)(fx * a->cos_t[tt] + fy * a->sin_t[tt] + bias);
+        uint32_t *cell = &acc[(size_t)tt * a->n_rho + r];
+        if (a->atomic) {
+#if defined(_OPENMP)
+            #pragma omp atomic
+#endif
+            (*cell)++;
+        } else {
+            (*cell)++;
+        }
+    }
+    return t1 - t0 + 1;
+}
+
+static void acc_merge(Accumulator *a) {
+    if (a->atomic) return;
+    const uint32_t *priv = a->priv;
+    uint32_t *acc = a->acc;
+    size_t cells = a->cells;
+    int threads = a->threads;
+
+    HOUGH_PARALLEL_FOR
+    for (size_t i = 0; i < cells; ++i) {
+        uint32_t sum = 0;
+        for (int t = 0; t < threads; ++t) sum += priv[(size_t)t * cells + i];
+        acc[i] = sum;
+    }
+}
+
+static int compare_lines(const void *pa, const void *pb) {
+    const HoughLine *a = (const HoughLine *)pa;
+    const HoughLine *b = (const HoughLine *)pb;
+    if (a->votes != b->votes) return (a->votes < b->votes) ? 1 : -1;
+    if (a->theta != b->theta) return (a->theta > b->theta) ? 1 : -1;
+    return (a->rho > b->rho) - (a->rho < b->rho);
+}
+
+static int is_peak(const Accumulator *a, int t, int r, int radius) {
+    const uint32_t *acc = a->acc;
+    uint32_t v = acc[(size_t)t * a->n_rho + r];
+    for (int dt = -radius; dt <= radius; ++dt) {
+        int tt = t + dt;
+        if (tt < 0 || tt >= a->n_theta) continue;
+        for (int dr = -radius; dr <= radius; ++dr) {
+            int rr = r + dr;
+            if (rr < 0 || rr >= a->n_rho || (dt == 0 && dr == 0)) continue;
+            uint32_t u = acc[(size_t)tt * a->n_rho + rr];
+            // ties go to the first cell in scan order
+            if (u > v || (u == v && (dt < 0 || (dt == 0 && dr < 0)))) return 0;
+        }
+    }
+    return 1;
+}
+
+static int find_peaks(const Accumulator *a, const HoughParams *p, double rho_step,
+                      HoughResult *res) {
+    int cap = 64, n = 0;
+    HoughLine *lines = (HoughLine *)malloc((size_t)cap * sizeof(HoughLine));
+    if (!lines) return -1;
+    uint32_t min_votes = (p->min_votes > 0) ? (uint32_t)p->min_votes : 1;
+
+    for (int t = 0; t < a->n_theta; ++t) {
+        const uint32_t *row = a->acc + (size_t)t * a->n_rho;
+        for (int r = 0; r < a->n_rho; ++r) {
+            if (row[r] < min_votes || !is_peak(a, t, r, p->peak_radius)) continue;
+            if (n == cap) {
+                cap *= 2;
+                HoughLine *grown = (HoughLine *)realloc(lines, (size_t)cap * sizeof(HoughLine));
+                if (!grown) {
+                    free(lines);
+                    return -1;
+                }
+                lines = grown;
+            }
+            lines[n].rho   = (r - a->offset) * rho_step;
+            lines[n].theta = M_PI * t / a->n_theta;
+            lines[n].votes = (int)row[r];
+            n++;
+        }
+    }
+    qsort(lines, n, sizeof(HoughLine), compare_lines);
+    res->n     = (n < p->max_lines) ? n : p->max_lines;
+    res->lines = lines;
+    return 0;
+}
+
+/* Merge, extract peaks and fill in the timing fields. */
+static HoughResult *finish(Accumulator *a, const HoughParams *p, HoughResult *res,
+                           double t_start) {
+    if (!a->atomic && !a->priv) {
+        fprintf(stderr, "[hough] Out of memory.\n");
+        acc_free(a);
+        free(res);
+        return NULL;
+    }
+    double t_voted = wall_time();
+    acc_merge(a);
+    double t_merged = wall_time();
+    int rc = find_peaks(a, p, p->rho_step, res);
+    double t_done = wall_time();
+
+    res->n_theta   = a->n_theta;
+    res->n_rho     = a->n_rho;
+    res->threads   = a->threads;
+    res->atomic    = a->atomic;
+    res->vote_sec  = t_voted - t_start;
+    res->merge_sec = t_merged - t_voted;
+    res->peak_sec  = t_done - t_merged;
+    if (res->vote_sec + res->merge_sec > 0.0)
+        res->votes_per_sec = res->votes / (res->vote_sec + res->merge_sec);
+    acc_free(a);
+    if (rc != 0) {
+        fprintf(stderr, "[hough] Out of memory.\n");
+        free(res);
+        return NULL;
+    }
+    return res;
+}
+
+HoughResult *hough_from_edges(const EdgeList *edges, const HoughParams *p) {
+    if (!edges || !p) return NULL;
+    Accumulator a;
+    HoughResult *res = (HoughResult *)calloc(1, sizeof(HoughResult));
+    if (!res || acc_init(&a, edges->width, edges->height, p) != 0) {
+        fprintf(stderr, "[hough] Out of memory.\n");
+        free(res);
+        return NULL;
+    }
+    res->width       = edges->width;
+    res->height      = edges->height;
+    res->edge_pixels = (long long)edges->count;
+
+    double t0 = wall_time();
+    long long votes = 0;
+    HOUGH_PARALLEL
+    {
+        uint32_t *mine = acc_mine(&a);
+        long long local = 0;
+
+        if (mine) {
+            HOUGH_FOR
+            for (int y = 0; y < edges->height; ++y)
+                for (uint32_t i = edges->row_ptr[y]; i < edges->row_ptr[y + 1]; ++i)
+                    local += vote(&a, mine, (int)edges->x[i], y, 0, a.n_theta - 1);
+        }
+
+#if defined(_OPENMP)
+        #pragma omp atomic
+#endif
+        votes += local;
+    }
+    res->votes = votes;
+    return finish(&a, p, res, t0);
+}
+
+static inline double channel0(const Image *img, size_t pixel) {
+    size_t i = pixel * img->channels;
+    switch (img->type) {
+    case SAMPLE_U16: return ((const uint16_t *)img->data)[i];
+    case SAMPLE_F32: return ((const float *)img->data)[i];
+    default:         return img->data[i];
+    }
+}
+
+HoughResult *hough_from_gray(const Image *gray, double level, const HoughParams *p) {
+    if (!gray || !gray->data || !p) return NULL;
+    Accumulator a;
+    HoughResult *res = (HoughResult *)calloc(1, sizeof(HoughResult));
+    if (!res || acc_init(&a, gray->width, gray->height, p) != 0) {
+        fprintf(stderr, "[hough] Out of memory.\n");
+        free(res);
+        return NULL;
+    }
+    res->width  = gray->width;
+    res->height = gray->height;
+
+    double full  = (gray->type == SAMPLE_U16) ? 65535.0 :
+                   (gray->type == SAMPLE_F32) ? 1.0 : 255.0;
+    double limit = level * full;
+    double limit2 = limit * limit;
+    int w = gray->width;
+    int h = gray->height;
+    int window = p->theta_window;
+    if (window <= 0 || 2 * window + 1 >= a.n_theta) window = 0;
+
+    double t0 = wall_time();
+    long long votes = 0, edge_pixels = 0;
+    HOUGH_PARALLEL
+    {
+        uint32_t *mine = acc_mine(&a);
+        long long local_votes = 0, local_edges = 0;
+
+        if (mine) {
+            HOUGH_FOR
+            for (int y = 1; y < h - 1; ++y) {
+                for (int x = 1; x < w - 1; ++x) {
+                    size_t up = (size_t)(y - 1) * w + x;
+                    size_t mid = up + w;
+                    size_t dn = mid + w;
+                    double gx = (channel0(gray, up + 1) + 2.0 * channel0(gray, mid + 1) +
+                                 channel0(gray, dn + 1)) -
+                                (channel0(gray, up - 1) + 2.0 * channel0(gray, mid - 1) +
+                                 channel0(gray, dn - 1));
+                    double gy = (channel0(gray, dn - 1) + 2.0 * channel0(gray, dn) +
+                                 channel0(gray, dn + 1)) -
+                                (channel0(gray, up - 1) + 2.0 * channel0(gray, up) +
+                                 channel0(gray, up + 1));
+                    double mag2 = gx * gx + gy * gy;
+                    if (mag2 < limit2 || mag2 == 0.0) continue;
+
+                    local_edges++;
+                    if (window == 0) {
+                        local_votes += vote(&a, mine, x, y, 0, a.n_theta - 1);
+                        continue;
+                    }
+                    double phi = atan2(gy, gx);          // (-pi, pi]
+                    if (phi < 0.0) phi += M_PI;          // normal angle mod pi
+                    int c = (int)(phi / M_PI * a.n_theta);
+                    if (c >= a.n_theta) c -= a.n_theta;
+                    local_votes += vote(&a, mine, x, y, c - window, c + window);
+                }
+            }
+        }
+
+#if defined(_OPENMP)
+        #pragma omp atomic
+#endif
+        votes += local_votes;
+#if defined(_OPENMP)
+        #pragma omp atomic
+#endif
+        edge_pixels += local_edges;
+    }
+    res->votes       = votes;
+    res->edge_pixels = edge_pixels;
+    return finish(&a, p, res, t0);
+}
+
+int write_hough_json(const char *path, const HoughResult *r) {
+    if (!path || !r) return -1;
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "[hough] Failed to open %s\n", path);
+        return -1;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"width\": %d,\n", r->width);
+    fprintf(f, "  \"height\": %d,\n", r->height);
+    fprintf(f, "  \"n_theta\": %d,\n", r->n_theta);
+    fprintf(f, "  \"n_rho\": %d,\n", r->n_rho);
+    fprintf(f, "  \"threads\": %d,\n", r->threads);
+    fprintf(f, "  \"accumulators\": \"%s\",\n", r->atomic ? "atomic" : "private");
+    fprintf(f, "  \"edge_pixels\": %lld,\n", r->edge_pixels);
+    fprintf(f, "  \"votes\": %lld,\n", r->votes);
+    fprintf(f, "  \"vote_sec\": %.9f,\n", r->vote_sec);
+    fprintf(f, "  \"merge_sec\": %.9f,\n", r->merge_sec);
+    fprintf(f, "  \"peak_sec\": %.9f,\n", r->peak_sec);
+    fprintf(f, "  \"votes_per_sec\": %.1f,\n", r->votes_per_sec);
+    fprintf(f, "  \"lines\": [");
+    for (int i = 0; i < r->n; ++i) {
+        const HoughLine *l = &r->lines[i];
+        fprintf(f, "%s\n    {\"rho\": %.2f, \"theta_deg\": %.2f, \"votes\": %d}",
+                i ? "," : "", l->rho, l->theta * 180.0 / M_PI, l->votes);
+    }
+    fprintf(f, "%s]\n", r->n ? "\n  " : "");
+    fprintf(f, "}\n");
+
+    if (fclose(f) != 0) {
+        fprintf(stderr, "[hough] Failed to write %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+void free_hough(HoughResult *r) {
+    if (!r) return;
+    free(r->lines);
+    free(r);
+}
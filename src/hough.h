@@ -0,0 +1,71 @@
+#ifndef HOUGH_H
+#define HOUGH_H
+
+#include "filters.h"
+#include "edgelist.h"
+
+/**
+ * Line-detection settings. Lines are x cos(theta) + y sin(theta) = rho
+ * with theta in [0, pi).
+ */
+typedef struct {
+    int    n_theta;        // angle bins over [0, pi)
+    double rho_step;       // pixels per rho bin
+    int    theta_window;   // gradient input: vote only +/- this many bins
+                           // around the gradient angle; 0 = all angles
+    int    max_lines;      // strongest peaks to report
+    int    min_votes;      // peaks below this are ignored
+    int    peak_radius;    // non-maximum suppression radius in bins
+    int    atomic_votes;   // 1 = one shared accumulator with atomic
+                           // increments (comparison baseline only)
+} HoughParams;
+
+typedef struct {
+    double rho;
+    double theta;          // radians
+    int    votes;
+} HoughLine;
+
+typedef struct {
+    int        width;
+    int        height;
+    int        n_theta;
+    int        n_rho;
+    int        threads;
+    int        atomic;       // votes went to one shared accumulator
+    long long  edge_pixels;
+    long long  votes;        // accumulator increments
+    double     vote_sec;     // voting (and the Sobel pass, from gray)
+    double     merge_sec;    // parallel reduction into one accumulator
+    double     peak_sec;
+    double     votes_per_sec;
+    int        n;
+    HoughLine *lines;        // strongest first
+} HoughResult;
+
+/**
+ * 180 angle bins, 1-pixel rho bins, +/- 8 bins around the gradient,
+ * 16 lines of at least 50 votes, suppression radius 4.
+ */
+void hough_default_params(HoughParams *p);
+
+/**
+ * Vote with every entry of an edge list over all angles.
+ */
+HoughResult *hough_from_edges(const EdgeList *edges, const HoughParams *p);
+
+/**
+ * Compute the Sobel gradient of channel 0 of a gray image and vote with
+ * every pixel whose magnitude is >= level * full scale. The gradient
+ * angle restricts the angles voted for (theta_window).
+ */
+HoughResult *hough_from_gray(const Image *gray, double level, const HoughParams *p);
+
+/**
+ * Write lines and vote statistics as JSON. Returns 0 on success.
+ */
+int write_hough_json(const char *path, const HoughResult *r);
+
+void free_hough(HoughResult *r);
+
+#endif // HOUGH_H
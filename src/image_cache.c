@@ -0,0 +1,308 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "image_cache.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+/*
+ * DECODED-IMAGE LRU CACHE
+ * -----------------------
+ *
+ * Benchmark repetitions and autotune trials process the same inputs
+ * again and again; decoding dominates those runs. The cache keeps the
+ * decoded RGB buffer keyed by (path, mtime, size, sample type), so an
+ * edited file is a different key and never served stale.
+ *
+ * Layout:
+ *   - N shards, each with its own omp_lock_t, hash buckets and LRU list
+ *   - one byte budget for the whole cache, with an atomic byte total;
+ *     any image up to the full budget can be cached
+ *   - entries carry a global use stamp; while the total is over budget,
+ *     the shard whose LRU tail is oldest loses that tail, so eviction
+ *     follows one cache-wide LRU order (locks are taken one at a time)
+ *   - a hit returns a copy (memcpy is far cheaper than decoding), so the
+ *     caller can filter in place without touching the cached buffer
+ *
+ * Two threads missing on the same key may both decode; the second
+ * insert simply finds the entry present and drops its copy.
+ */
+
+#define BUCKETS_PER_SHARD 64
+
+typedef struct CacheEntry {
+    char      *path;
+    long long  mtime_ns;
+    long long  size;
+    SampleType type;
+    uint64_t   hash;
+
+    Image     *img;
+    size_t     bytes;
+    double     decode_sec;
+    unsigned long long last_use;   // cache-wide use stamp
+
+    struct CacheEntry *bucket_next;
+    struct CacheEntry *lru_prev;   // towards most recently used
+    struct CacheEntry *lru_next;   // towards least recently used
+} CacheEntry;
+
+typedef struct {
+    omp_lock_t  lock;
+    CacheEntry *buckets[BUCKETS_PER_SHARD];
+    CacheEntry *lru_head;
+    CacheEntry *lru_tail;
+    size_t      bytes;
+
+    long long   hits;
+    long long   misses;
+    long long   evictions;
+    double      decode_sec;
+    double      saved_decode_sec;
+} CacheShard;
+
+struct ImageCache {
+    CacheShard *shards;
+    int         n_shards;    // power of two
+    size_t      budget;
+    size_t      bytes;       // all shards (atomic)
+    unsigned long long clock;   // last use stamp handed out (atomic)
+};
+
+static uint64_t key_hash(const char *path, long long mtime_ns, long long size,
+                         SampleType type) {
+    uint64_t h = 1469598103934665603ULL;   // FNV-1a
+    for (const unsigned char *p = (const unsigned char *)path; *p; ++p) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    h ^= (uint64_t)mtime_ns * 0x9E3779B97F4A7C15ULL;
+    h ^= (uint64_t)size + (h << 6) + (h >> 2);
+    h ^= (uint64_t)type * 0xBF58476D1CE4E5B9ULL;
+    return h;
+}
+
+ImageCache *image_cache_create(size_t byte_budget, int shards) {
+    if (byte_budget == 0) return NULL;
+
+    int n = 1;
+    while (n < shards) n <<= 1;
+
+    ImageCache *c = (ImageCache *)calloc(1, sizeof(ImageCache));
+    if (!c) return NULL;
+    c->shards = (CacheShard *)calloc(n, sizeof(CacheShard));
+    if (!c->shards) {
+        free(c);
+        return NULL;
+    }
+    c->n_shards = n;
+    c->budget   = byte_budget;
+
+    for (int i = 0; i < n; ++i) omp_init_lock(&c->shards[i].lock);
+    return c;
+}
+
+static void lru_unlink(CacheShard *s, CacheEntry *e) {
+    if (e->lru_prev) e->lru_prev->lru_next = e->lru_next;
+    else             s->lru_head = e->lru_next;
+    if (e->lru_next) e->lru_next->lru_prev = e->lru_prev;
+    else             s->lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = NULL;
+}
+
+static void lru_push_front(CacheShard *s, CacheEntry *e) {
+    e->lru_prev = NULL;
+    e->lru_next = s->lru_head;
+    if (s->lru_head) s->lru_head->lru_prev = e;
+    s->lru_head = e;
+    if (!s->lru_tail) s->lru_tail = e;
+}
+
+static void entry_free(CacheEntry *e) {
+    free_image(e->img);
+    free(e->path);
+    free(e);
+}
+
+static unsigned long long next_use(ImageCache *c) {
+    return __atomic_add_fetch(&c->clock, 1, __ATOMIC_RELAXED);
+}
+
+/* Remove e from its bucket and the LRU list, then free it. */
+static void shard_remove(ImageCache *c, CacheShard *s, CacheEntry *e) {
+    CacheEntry **pp = &s->buckets[e->hash % BUCKETS_PER_SHARD];
+    while (*pp && *pp != e) pp = &(*pp)->bucket_next;
+    if (*pp) *pp = e->bucket_next;
+    lru_unlink(s, e);
+    s->bytes -= e->bytes;
+    __atomic_sub_fetch(&c->bytes, e->bytes, __ATOMIC_RELAXED);
+    entry_free(e);
+}
+
+static CacheEntry *shard_find(CacheShard *s, uint64_t hash, const char *path,
+                              long long mtime_ns, long long size,
+                              SampleType type) {
+    for (CacheEntry *e = s->buckets[hash % BUCKETS_PER_SHARD]; e;
+         e = e->bucket_next) {
+        if (e->hash == hash && e->mtime_ns == mtime_ns && e->size == size &&
+            e->type == type && strcmp(e->path, path) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+/*
+ * Takes ownership of img; frees it if it cannot be cached. The total
+ * may exceed the budget afterwards: the caller runs cache_evict() once
+ * the shard lock is released.
+ */
+static void shard_insert(ImageCache *c, CacheShard *s, uint64_t hash,
+                         const char *path, long long mtime_ns, long long size,
+                         Image *img, double decode_sec) {
+    size_t bytes = image_bytes(img);
+    if (bytes > c->budget ||
+        shard_find(s, hash, path, mtime_ns, size, img->type) != NULL) {
+        free_image(img);
+        return;
+    }
+
+    CacheEntry *e = (CacheEntry *)calloc(1, sizeof(CacheEntry));
+    if (!e || !(e->path = strdup(path))) {
+        free(e);
+        free_image(img);
+        return;
+    }
+    e->mtime_ns   = mtime_ns;
+    e->size       = size;
+    e->type       = img->type;
+    e->hash       = hash;
+    e->img        = img;
+    e->bytes      = bytes;
+    e->decode_sec = decode_sec;
+    e->last_use   = next_use(c);
+
+    CacheEntry **bucket = &s->buckets[hash % BUCKETS_PER_SHARD];
+    e->bucket_next = *bucket;
+    *bucket = e;
+    lru_push_front(s, e);
+    s->bytes += bytes;
+    __atomic_add_fetch(&c->bytes, bytes, __ATOMIC_RELAXED);
+}
+
+/*
+ * Evict least recently used entries until the total fits the budget.
+ * The victim is the oldest LRU tail over all shards. Holds at most one
+ * shard lock at a time, so it must be called with none held.
+ */
+static void cache_evict(ImageCache *c) {
+    while (__atomic_load_n(&c->bytes, __ATOMIC_RELAXED) > c->budget) {
+        int victim = -1;
+        unsigned long long oldest = ULLONG_MAX;
+        for (int i = 0; i < c->n_shards; ++i) {
+            CacheShard *s = &c->shards[i];
+            omp_set_lock(&s->lock);
+            if (s->lru_tail && s->lru_tail->last_use < oldest) {
+                oldest = s->lru_tail->last_use;
+                victim = i;
+            }
+            omp_unset_lock(&s->lock);
+        }
+        if (victim < 0) return;
+
+        // the tail may have changed since the scan; any tail is old
+        CacheShard *s = &c->shards[victim];
+        omp_set_lock(&s->lock);
+        if (s->lru_tail && __atomic_load_n(&c->bytes, __ATOMIC_RELAXED) > c->budget) {
+            shard_remove(c, s, s->lru_tail);
+            s->evictions++;
+        }
+        omp_unset_lock(&s->lock);
+    }
+}
+
+Image *image_cache_load(ImageCache *cache, const char *path, SampleType type) {
+    if (!cache) return load_image_typed(path, type);
+    if (!path) return NULL;
+
+    struct stat st;
+    if (stat(path, &st) != 0) return load_image_typed(path, type);   // reports the error
+
+    long long mtime_ns = (long long)st.st_mtim.tv_sec * 1000000000LL +
+                         st.st_mtim.tv_nsec;
+    long long size     = (long long)st.st_size;
+    uint64_t  hash     = key_hash(path, mtime_ns, size, type);
+    CacheShard *s = &cache->shards[(hash >> 32) & (uint64_t)(cache->n_shards - 1)];
+
+    // Hit: copy under the shard lock and refresh LRU position
+    omp_set_lock(&s->lock);
+    CacheEntry *e = shard_find(s, hash, path, mtime_ns, size, type);
+    if (e) {
+        double t0 = wall_time();
+        Image *copy = clone_image(e->img);
+        double copy_sec = wall_time() - t0;
+
+        lru_unlink(s, e);
+        lru_push_front(s, e);
+        e->last_use = next_use(cache);
+        s->hits++;
+        if (e->decode_sec > copy_sec)
+            s->saved_decode_sec += e->decode_sec - copy_sec;
+        omp_unset_lock(&s->lock);
+        if (copy) return copy;
+    } else {
+        s->misses++;
+        omp_unset_lock(&s->lock);
+    }
+
+    // Miss: decode outside the lock, then insert a copy
+    double t0 = wall_time();
+    Image *img = load_image_typed(path, type);
+    double decode_sec = wall_time() - t0;
+    if (!img) return NULL;
+
+    Image *cached = clone_image(img);
+
+    omp_set_lock(&s->lock);
+    s->decode_sec += decode_sec;
+    if (cached)
+        shard_insert(cache, s, hash, path, mtime_ns, size, cached, decode_sec);
+    omp_unset_lock(&s->lock);
+    cache_evict(cache);
+
+    return img;
+}
+
+void image_cache_stats(ImageCache *cache, CacheStats *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!cache) return;
+
+    for (int i = 0; i < cache->n_shards; ++i) {
+        CacheShard *s = &cache->shards[i];
+        omp_set_lock(&s->lock);
+        out->hits             += s->hits;
+        out->misses           += s->misses;
+        out->evictions        += s->evictions;
+        out->bytes_cached     += (long long)s->bytes;
+        out->decode_sec       += s->decode_sec;
+        out->saved_decode_sec += s->saved_decode_sec;
+        omp_unset_lock(&s->lock);
+    }
+}
+
+void image_cache_destroy(ImageCache *cache) {
+    if (!cache) return;
+    for (int i = 0; i < cache->n_shards; ++i) {
+        CacheShard *s = &cache->shards[i];
+        while (s->lru_head) shard_remove(cache, s, s->lru_head);
+        omp_destroy_lock(&s->lock);
+    }
+    free(cache->shards);
+    free(cache);
+}
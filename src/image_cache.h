@@ -0,0 +1,46 @@
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include <stddef.h>
+#include "filters.h"
+
+/**
+ * In-memory LRU cache of decoded images, keyed by path + mtime + size
+ * (+ sample type).
+ * Entries are spread over independently locked shards, so concurrent
+ * OpenMP threads rarely contend; the byte budget and the LRU order are
+ * cache-wide. Thread-safe.
+ */
+typedef struct ImageCache ImageCache;
+
+typedef struct {
+    long long hits;
+    long long misses;
+    long long evictions;
+    long long bytes_cached;      // current pixel bytes held
+    double    decode_sec;        // time spent decoding on misses
+    double    saved_decode_sec;  // decode time avoided by hits (minus copy)
+} CacheStats;
+
+/**
+ * Create a cache holding at most byte_budget bytes of pixel data in
+ * total, spread over `shards` locks (rounded up to a power of two).
+ * Returns NULL on failure.
+ */
+ImageCache *image_cache_create(size_t byte_budget, int shards);
+
+/**
+ * Load an image with the given sample type through the cache. Returns a
+ * private copy the caller owns (filters run in place), or NULL if the
+ * file cannot be decoded. A NULL cache just calls load_image_typed().
+ */
+Image *image_cache_load(ImageCache *cache, const char *path, SampleType type);
+
+/**
+ * Snapshot of the cumulative counters.
+ */
+void image_cache_stats(ImageCache *cache, CacheStats *out);
+
+void image_cache_destroy(ImageCache *cache);
+
+#endif // IMAGE_CACHE_H
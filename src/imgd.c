@@ -0,0 +1,420 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <omp.h>
+
+#include "filters.h"
+#include "timer.h"
+#include "cpubudget.h"
+#include "jobsched.h"
+
+/*
+ * Resident processing service: reads requests from stdin (or a FIFO
+ * redirected to it) and runs grayscale -> blur(2) -> Sobel on a pool of
+ * OpenMP workers fed by the deadline-aware scheduler in jobsched.c.
+ *
+ *   imgd [--workers N] [--policy edf|fifo] [--interactive-ms MS]
+ *        [--metrics PATH]
+ *
+ * Requests, one per line:
+ *
+ *   image <input_file> <output_file> [deadline=MS] [prio=N]
+ *   dir   <input_dir>  <output_dir>  [deadline=MS] [prio=N]
+ *   stats
+ *   quit                                  (same as end of input)
+ *
+ * `image` is interactive (prio 1, deadline --interactive-ms, default
+ * 50); `dir` is bulk (prio 0, no deadline), one task per image.
+ * deadline=0 removes the deadline. Replies go to stdout:
+ *
+ *   accepted <id> <class> tasks=<n>
+ *   done <id> <class> tasks=<n> failed=<n> latency_ms=<ms> deadline=met|missed|none
+ *
+ * On quit the queue is drained and per-class latency percentiles are
+ * written to results/logs/daemon_metrics.json.
+ */
+
+#define DEFAULT_METRICS_PATH "results/logs/daemon_metrics.json"
+
+typedef struct {
+    int         workers;          // 0 = CPU budget
+    SchedPolicy policy;
+    double      interactive_ms;
+    const char *metrics_path;
+} DaemonOptions;
+
+/* Request payload behind Job.ctx. */
+typedef struct {
+    char  *input;     // file (image) or directory (dir)
+    char  *output;
+    char **files;     // dir jobs: names relative to input
+    int    n_files;
+} Request;
+
+static int ends_with(const char *name, const char *ext) {
+    size_t len_name = strlen(name);
+    size_t len_ext  = strlen(ext);
+    if (len_name < len_ext) return 0;
+    return strcmp(name + len_name - len_ext, ext) == 0;
+}
+
+static int is_image_file(const char *name) {
+    return ends_with(name, ".png")  ||
+           ends_with(name, ".jpg")  ||
+           ends_with(name, ".jpeg") ||
+           ends_with(name, ".bmp");
+}
+
+static void ensure_directory(const char *path) {
+    if (!path) return;
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return;
+        fprintf(stderr, "[imgd] %s exists but is not a directory!\n", path);
+        return;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror("[imgd] mkdir");
+    }
+}
+
+static int collect_image_files(const char *input_dir, char ***out_files) {
+    *out_files = NULL;
+
+    DIR *dir = opendir(input_dir);
+    if (!dir) return -1;
+
+    char **files = NULL;
+    int file_count = 0;
+    int capacity   = 0;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (!is_image_file(ent->d_name))
+            continue;
+        if (file_count == capacity) {
+            capacity = (capacity == 0) ? 16 : capacity * 2;
+            char **grown = (char **)realloc(files, capacity * sizeof(char *));
+            if (!grown) break;
+            files = grown;
+        }
+        files[file_count] = strdup(ent->d_name);
+        if (files[file_count]) file_count++;
+    }
+    closedir(dir);
+
+    *out_files = files;
+    return file_count;
+}
+
+static void free_request(Request *r) {
+    if (!r) return;
+    for (int i = 0; i < r->n_files; ++i) free(r->files[i]);
+    free(r->files);
+    free(r->input);
+    free(r->output);
+    free(r);
+}
+
+static void free_job(Job *job) {
+    if (!job) return;
+    free_request((Request *)job->ctx);
+    free(job);
+}
+
+static void reply(const char *fmt_line) {
+    #pragma omp critical(imgd_reply)
+    {
+        fputs(fmt_line, stdout);
+        fflush(stdout);
+    }
+}
+
+/* Process task `index` of a job. Returns 0 on success. */
+static int run_task(const Job *job, int index) {
+    const Request *r = (const Request *)job->ctx;
+    char in_path[512];
+    char out_path[512];
+    if (r->files) {
+        snprintf(in_path, sizeof(in_path), "%s/%s", r->input, r->files[index]);
+        snprintf(out_path, sizeof(out_path), "%s/%s", r->output, r->files[index]);
+    } else {
+        snprintf(in_path, sizeof(in_path), "%s", r->input);
+        snprintf(out_path, sizeof(out_path), "%s", r->output);
+    }
+
+    Image *img = load_image(in_path);
+    if (!img) return -1;
+
+    apply_grayscale(img);
+    apply_box_blur(img, 2);
+    apply_sobel_edge(img);
+
+    int rc = save_image_png(out_path, img);
+    if (rc != 0) fprintf(stderr, "[imgd] Failed to save %s\n", out_path);
+    free_image(img);
+    return (rc == 0) ? 0 : -1;
+}
+
+static void worker_loop(Scheduler *s, long long *images_done) {
+    Task t;
+    while (sched_next(s, &t) == 0) {
+        int ok = (run_task(t.job, t.index) == 0);
+        double now = wall_time();
+        if (ok) {
+            #pragma omp atomic
+            (*images_done)++;
+        }
+        if (!sched_task_done(s, &t, ok, now)) continue;
+
+        Job *job = t.job;
+        const char *verdict = (job->deadline == 0.0) ? "none"
+                            : (now > job->deadline)  ? "missed" : "met";
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "done %lld %s tasks=%d failed=%d latency_ms=%.3f deadline=%s\n",
+                 job->id, job_class_name(job->cls), job->tasks, job->failed,
+                 (now - job->submit_time) * 1000.0, verdict);
+        reply(line);
+        free_job(job);
+    }
+}
+
+static void print_stats(Scheduler *s) {
+    for (int c = 0; c < JOB_CLASS_COUNT; ++c) {
+        ClassStats st;
+        sched_class_stats(s, (JobClass)c, &st);
+        char line[320];
+        snprintf(line, sizeof(line),
+                 "stats %s jobs=%lld tasks=%lld misses=%lld "
+                 "p50_ms=%.3f p90_ms=%.3f p99_ms=%.3f max_ms=%.3f\n",
+                 job_class_name((JobClass)c), st.jobs, st.tasks,
+                 st.deadline_misses, st.p50_ms, st.p90_ms, st.p99_ms,
+                 st.max_ms);
+        reply(line);
+    }
+}
+
+/*
+ * Parse and submit one request line. Returns 1 on quit, 0 otherwise.
+ */
+static int handle_line(Scheduler *s, const DaemonOptions *opt, char *line,
+                       long long *next_id) {
+    char *save = NULL;
+    char *cmd = strtok_r(line, " \t\r\n", &save);
+    if (!cmd || cmd[0] == '#') return 0;
+
+    if (strcmp(cmd, "quit") == 0) return 1;
+    if (strcmp(cmd, "stats") == 0) {
+        print_stats(s);
+        return 0;
+    }
+
+    int is_dir = (strcmp(cmd, "dir") == 0);
+    if (!is_dir && strcmp(cmd, "image") != 0) {
+        reply("error unknown command\n");
+        return 0;
+    }
+
+    char *input  = strtok_r(NULL, " \t\r\n", &save);
+    char *output = strtok_r(NULL, " \t\r\n", &save);
+    if (!input || !output) {
+        reply("error usage: image|dir <input> <output> [deadline=MS] [prio=N]\n");
+        return 0;
+    }
+
+    double deadline_ms = is_dir ? 0.0 : opt->interactive_ms;
+    int priority = is_dir ? 0 : 1;
+    for (char *tok = strtok_r(NULL, " \t\r\n", &save); tok;
+         tok = strtok_r(NULL, " \t\r\n", &save)) {
+        if (strncmp(tok, "deadline=", 9) == 0) {
+            deadline_ms = atof(tok + 9);
+        } else if (strncmp(tok, "prio=", 5) == 0) {
+            priority = atoi(tok + 5);
+        } else {
+            reply("error unknown option\n");
+            return 0;
+        }
+    }
+
+    Job *job = (Job *)calloc(1, sizeof(Job));
+    Request *r = (Request *)calloc(1, sizeof(Request));
+    if (!job || !r) {
+        free(job);
+        free(r);
+        reply("error out of memory\n");
+        return 0;
+    }
+    r->input  = strdup(input);
+    r->output = strdup(output);
+    job->ctx  = r;
+
+    job->submit_time = wall_time();
+    job->id          = (*next_id)++;
+    job->cls         = is_dir ? JOB_BULK : JOB_INTERACTIVE;
+    job->priority    = priority;
+    job->deadline    = (deadline_ms > 0.0)
+                     ? job->submit_time + deadline_ms / 1000.0 : 0.0;
+    job->tasks       = 1;
+
+    if (is_dir) {
+        int n = collect_image_files(input, &r->files);
+        if (n <= 0) {
+            reply(n < 0 ? "error cannot open input directory\n"
+                        : "error no images in input directory\n");
+            free_job(job);
+            return 0;
+        }
+        r->n_files = n;
+        job->tasks = n;
+        ensure_directory(output);
+    }
+
+    // a worker may finish and free the job as soon as it is submitted:
+    // format the reply first, and print it under the reply lock so that
+    // its "done" line cannot come out ahead of "accepted"
+    char msg[128];
+    snprintf(msg, sizeof(msg), "accepted %lld %s tasks=%d\n",
+             job->id, job_class_name(job->cls), job->tasks);
+
+    int rc = -1;
+    if (r->input && r->output) {
+        #pragma omp critical(imgd_reply)
+        {
+            rc = sched_submit(s, job);
+            if (rc == 0) {
+                fputs(msg, stdout);
+                fflush(stdout);
+            }
+        }
+    }
+    if (rc != 0) {
+        reply("error cannot queue request\n");
+        free_job(job);
+    }
+    return 0;
+}
+
+static void write_daemon_metrics_json(const char *json_path, Scheduler *s,
+                                      const DaemonOptions *opt, int workers,
+                                      double uptime, long long images) {
+    ensure_directory("results");
+    ensure_directory("results/logs");
+
+    FILE *f = fopen(json_path, "w");
+    if (!f) {
+        perror("[imgd] fopen metrics json");
+        return;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"variant\": \"daemon\",\n");
+    fprintf(f, "  \"metrics\": {\n");
+    fprintf(f, "    \"policy\": \"%s\",\n", sched_policy_name(opt->policy));
+    fprintf(f, "    \"workers\": %d,\n", workers);
+    fprintf(f, "    \"interactive_deadline_ms\": %.3f,\n", opt->interactive_ms);
+    fprintf(f, "    \"uptime_sec\": %.6f,\n", uptime);
+    fprintf(f, "    \"images_processed\": %lld,\n", images);
+    fprintf(f, "    \"images_per_sec\": %.3f\n",
+            (uptime > 0.0) ? images / uptime : 0.0);
+    fprintf(f, "  },\n");
+    fprintf(f, "  \"classes\": [\n");
+    for (int c = 0; c < JOB_CLASS_COUNT; ++c) {
+        ClassStats st;
+        sched_class_stats(s, (JobClass)c, &st);
+        fprintf(f, "    {\n");
+        fprintf(f, "      \"class\": \"%s\",\n", job_class_name((JobClass)c));
+        fprintf(f, "      \"jobs\": %lld,\n", st.jobs);
+        fprintf(f, "      \"tasks\": %lld,\n", st.tasks);
+        fprintf(f, "      \"failed_tasks\": %lld,\n", st.failed_tasks);
+        fprintf(f, "      \"deadline_misses\": %lld,\n", st.deadline_misses);
+        fprintf(f, "      \"latency_mean_ms\": %.3f,\n", st.mean_ms);
+        fprintf(f, "      \"latency_p50_ms\": %.3f,\n", st.p50_ms);
+        fprintf(f, "      \"latency_p90_ms\": %.3f,\n", st.p90_ms);
+        fprintf(f, "      \"latency_p99_ms\": %.3f,\n", st.p99_ms);
+        fprintf(f, "      \"latency_max_ms\": %.3f\n", st.max_ms);
+        fprintf(f, "    }%s\n", (c + 1 < JOB_CLASS_COUNT) ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+    fprintf(stderr, "[imgd] Metrics written to %s\n", json_path);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--workers N] [--policy edf|fifo] "
+            "[--interactive-ms MS] [--metrics PATH]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    DaemonOptions opt;
+    opt.workers        = 0;
+    opt.policy         = POLICY_EDF;
+    opt.interactive_ms = 50.0;
+    opt.metrics_path   = DEFAULT_METRICS_PATH;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            opt.workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            if (parse_sched_policy(argv[++i], &opt.policy) != 0) {
+                fprintf(stderr, "[imgd] Unknown policy: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--interactive-ms") == 0 && i + 1 < argc) {
+            opt.interactive_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            opt.metrics_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (opt.workers <= 0) {
+        CpuBudget budget;
+        cpu_budget_detect(&budget);
+        opt.workers = budget.effective_cpus;
+    }
+
+    Scheduler sched;
+    if (sched_init(&sched, opt.policy) != 0) {
+        fprintf(stderr, "[imgd] Cannot initialise scheduler\n");
+        return 1;
+    }
+
+    fprintf(stderr, "[imgd] %d workers, policy %s, interactive deadline %.1f ms\n",
+            opt.workers, sched_policy_name(opt.policy), opt.interactive_ms);
+
+    long long images_done = 0;
+    long long next_id = 1;
+    double t_start = wall_time();
+
+    // Thread 0 reads requests, the others work. Once input ends,
+    // thread 0 helps drain the queue.
+    #pragma omp parallel num_threads(opt.workers + 1)
+    {
+        if (omp_get_thread_num() == 0) {
+            char line[2048];
+            while (fgets(line, sizeof(line), stdin)) {
+                if (handle_line(&sched, &opt, line, &next_id)) break;
+            }
+            sched_close(&sched);
+        }
+        worker_loop(&sched, &images_done);
+    }
+
+    double uptime = wall_time() - t_start;
+    print_stats(&sched);
+    write_daemon_metrics_json(opt.metrics_path, &sched, &opt, opt.workers,
+                              uptime, images_done);
+    sched_destroy(&sched);
+    return 0;
+}
@@ -0,0 +1,234 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "jobsched.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * DEADLINE-AWARE TASK SCHEDULING
+ * ------------------------------
+ *
+ * The batch drivers hand one directory to an OpenMP loop, so every
+ * image waits behind everything listed before it. A resident service
+ * gets mixed traffic instead:
+ *
+ *   interactive  one image, answer within ~50 ms
+ *   bulk         a whole directory, throughput matters, latency does not
+ *
+ * Bulk jobs are split into one task per image and every task goes into
+ * a binary heap ordered by
+ *
+ *   1. job priority (higher first)
+ *   2. job deadline (earliest first; no deadline sorts last)
+ *   3. arrival sequence
+ *
+ * so an interactive request waits for at most one in-flight image per
+ * worker, never for the rest of a bulk job. Tasks are not preempted:
+ * an image is the unit of yielding. With POLICY_FIFO only the arrival
+ * sequence counts, which reproduces the batch drivers' behaviour for
+ * comparison.
+ */
+
+int parse_sched_policy(const char *s, SchedPolicy *out) {
+    if (!s || !out) return -1;
+    if (strcmp(s, "edf")  == 0) { *out = POLICY_EDF;  return 0; }
+    if (strcmp(s, "fifo") == 0) { *out = POLICY_FIFO; return 0; }
+    return -1;
+}
+
+const char *sched_policy_name(SchedPolicy policy) {
+    return (policy == POLICY_FIFO) ? "fifo" : "edf";
+}
+
+const char *job_class_name(JobClass cls) {
+    return (cls == JOB_INTERACTIVE) ? "interactive" : "bulk";
+}
+
+int sched_init(Scheduler *s, SchedPolicy policy) {
+    if (!s) return -1;
+    memset(s, 0, sizeof(*s));
+    s->policy = policy;
+    if (pthread_mutex_init(&s->lock, NULL) != 0) return -1;
+    if (pthread_cond_init(&s->ready, NULL) != 0) {
+        pthread_mutex_destroy(&s->lock);
+        return -1;
+    }
+    return 0;
+}
+
+void sched_destroy(Scheduler *s) {
+    if (!s) return;
+    free(s->heap);
+    for (int c = 0; c < JOB_CLASS_COUNT; ++c) free(s->logs[c].ms);
+    pthread_cond_destroy(&s->ready);
+    pthread_mutex_destroy(&s->lock);
+}
+
+/* Non-zero if a must run before b. */
+static int more_urgent(SchedPolicy policy, const Task *a, const Task *b) {
+    if (policy == POLICY_EDF) {
+        const Job *x = a->job;
+        const Job *y = b->job;
+        if (x->priority != y->priority) return x->priority > y->priority;
+        if (x->deadline != y->deadline) {
+            if (x->deadline == 0.0) return 0;
+            if (y->deadline == 0.0) return 1;
+            return x->deadline < y->deadline;
+        }
+    }
+    return a->seq < b->seq;
+}
+
+static void sift_up(Scheduler *s, int i) {
+    Task t = s->heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!more_urgent(s->policy, &t, &s->heap[parent])) break;
+        s->heap[i] = s->heap[parent];
+        i = parent;
+    }
+    s->heap[i] = t;
+}
+
+static void sift_down(Scheduler *s, int i) {
+    Task t = s->heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= s->size) break;
+        if (child + 1 < s->size &&
+            more_urgent(s->policy, &s->heap[child + 1], &s->heap[child]))
+            child++;
+        if (!more_urgent(s->policy, &s->heap[child], &t)) break;
+        s->heap[i] = s->heap[child];
+        i = child;
+    }
+    s->heap[i] = t;
+}
+
+int sched_submit(Scheduler *s, Job *job) {
+    if (!s || !job || job->tasks <= 0) return -1;
+
+    pthread_mutex_lock(&s->lock);
+    if (s->closed) {
+        pthread_mutex_unlock(&s->lock);
+        return -1;
+    }
+    if (s->size + job->tasks > s->cap) {
+        int cap = s->cap ? s->cap : 64;
+        while (cap < s->size + job->tasks) cap *= 2;
+        Task *grown = (Task *)realloc(s->heap, (size_t)cap * sizeof(Task));
+        if (!grown) {
+            pthread_mutex_unlock(&s->lock);
+            fprintf(stderr, "[jobsched] Out of memory queueing job %lld\n", job->id);
+            return -1;
+        }
+        s->heap = grown;
+        s->cap  = cap;
+    }
+
+    job->remaining = job->tasks;
+    job->failed    = 0;
+    for (int i = 0; i < job->tasks; ++i) {
+        Task *t  = &s->heap[s->size];
+        t->job   = job;
+        t->index = i;
+        t->seq   = s->seq++;
+        sift_up(s, s->size++);
+    }
+    pthread_cond_broadcast(&s->ready);
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+}
+
+int sched_next(Scheduler *s, Task *out) {
+    pthread_mutex_lock(&s->lock);
+    while (s->size == 0 && !s->closed)
+        pthread_cond_wait(&s->ready, &s->lock);
+    if (s->size == 0) {
+        pthread_mutex_unlock(&s->lock);
+        return -1;
+    }
+    *out = s->heap[0];
+    s->heap[0] = s->heap[--s->size];
+    if (s->size > 0) sift_down(s, 0);
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+}
+
+static void log_latency(LatencyLog *log, double ms) {
+    if (log->n == log->cap) {
+        int cap = log->cap ? log->cap * 2 : 256;
+        double *grown = (double *)realloc(log->ms, (size_t)cap * sizeof(double));
+        if (!grown) return;   // drop the sample rather than the job
+        log->ms  = grown;
+        log->cap = cap;
+    }
+    log->ms[log->n++] = ms;
+}
+
+int sched_task_done(Scheduler *s, const Task *t, int ok, double now) {
+    Job *job = t->job;
+    pthread_mutex_lock(&s->lock);
+    LatencyLog *log = &s->logs[job->cls];
+    log->tasks++;
+    if (!ok) {
+        job->failed++;
+        log->failed_tasks++;
+    }
+    int finished = (--job->remaining == 0);
+    if (finished) {
+        log_latency(log, (now - job->submit_time) * 1000.0);
+        if (job->deadline > 0.0 && now > job->deadline) log->misses++;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return finished;
+}
+
+void sched_close(Scheduler *s) {
+    pthread_mutex_lock(&s->lock);
+    s->closed = 1;
+    pthread_cond_broadcast(&s->ready);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted v[0..n). */
+static double percentile(const double *v, int n, double p) {
+    int rank = (int)(p / 100.0 * n + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return v[rank - 1];
+}
+
+void sched_class_stats(Scheduler *s, JobClass cls, ClassStats *out) {
+    memset(out, 0, sizeof(*out));
+
+    pthread_mutex_lock(&s->lock);
+    const LatencyLog *log = &s->logs[cls];
+    int n = log->n;
+    out->jobs            = n;
+    out->tasks           = log->tasks;
+    out->failed_tasks    = log->failed_tasks;
+    out->deadline_misses = log->misses;
+    double *v = (n > 0) ? (double *)malloc((size_t)n * sizeof(double)) : NULL;
+    if (v) memcpy(v, log->ms, (size_t)n * sizeof(double));
+    pthread_mutex_unlock(&s->lock);
+
+    if (!v) return;
+    qsort(v, n, sizeof(double), compare_doubles);
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) sum += v[i];
+    out->mean_ms = sum / n;
+    out->p50_ms  = percentile(v, n, 50.0);
+    out->p90_ms  = percentile(v, n, 90.0);
+    out->p99_ms  = percentile(v, n, 99.0);
+    out->max_ms  = v[n - 1];
+    free(v);
+}
@@ -0,0 +1,118 @@
+#ifndef JOBSCHED_H
+#define JOBSCHED_H
+
+#include <pthread.h>
+
+/**
+ * Traffic classes of the resident service. Latency is reported per class.
+ */
+typedef enum {
+    JOB_INTERACTIVE = 0,   // single image, tight deadline
+    JOB_BULK,              // directory, split into one task per image
+    JOB_CLASS_COUNT
+} JobClass;
+
+typedef enum {
+    POLICY_EDF = 0,   // priority, then earliest deadline, then arrival
+    POLICY_FIFO       // arrival order only (the batch driver's behaviour)
+} SchedPolicy;
+
+/**
+ * One submitted request. The scheduler never looks at ctx; the caller
+ * owns the Job and frees it once sched_task_done() reports completion.
+ */
+typedef struct {
+    long long id;
+    JobClass  cls;
+    int       priority;      // higher runs first
+    double    submit_time;   // wall_time() at arrival
+    double    deadline;      // absolute wall_time(); 0 = none
+    int       tasks;
+    int       remaining;     // guarded by the scheduler lock
+    int       failed;
+    void     *ctx;
+} Job;
+
+/**
+ * Unit of work handed to a worker: task `index` of `job`.
+ */
+typedef struct {
+    Job               *job;
+    int                index;
+    unsigned long long seq;   // global arrival order (tie breaker)
+} Task;
+
+typedef struct {
+    double   *ms;      // end-to-end job latencies
+    int       n;
+    int       cap;
+    long long tasks;
+    long long failed_tasks;
+    long long misses;  // jobs finished after their deadline
+} LatencyLog;
+
+typedef struct {
+    SchedPolicy        policy;
+    pthread_mutex_t    lock;
+    pthread_cond_t     ready;
+
+    Task              *heap;
+    int                size;
+    int                cap;
+    unsigned long long seq;
+    int                closed;
+
+    LatencyLog         logs[JOB_CLASS_COUNT];
+} Scheduler;
+
+typedef struct {
+    long long jobs;
+    long long tasks;
+    long long failed_tasks;
+    long long deadline_misses;
+    double    mean_ms;
+    double    p50_ms;
+    double    p90_ms;
+    double    p99_ms;
+    double    max_ms;
+} ClassStats;
+
+int  parse_sched_policy(const char *s, SchedPolicy *out);
+const char *sched_policy_name(SchedPolicy policy);
+const char *job_class_name(JobClass cls);
+
+int  sched_init(Scheduler *s, SchedPolicy policy);
+void sched_destroy(Scheduler *s);
+
+/**
+ * Queue all job->tasks tasks of a job. Returns 0 on success, -1 if out
+ * of memory or the scheduler is closed.
+ */
+int sched_submit(Scheduler *s, Job *job);
+
+/**
+ * Block until a task is available and pop the most urgent one.
+ * Returns 0 with *out filled, or -1 once the scheduler is closed and
+ * drained.
+ */
+int sched_next(Scheduler *s, Task *out);
+
+/**
+ * Record the outcome of a task taken with sched_next(). Returns 1 if it
+ * was the job's last task (its latency is then recorded with `now` as
+ * completion time and the caller may free the job), 0 otherwise.
+ */
+int sched_task_done(Scheduler *s, const Task *t, int ok, double now);
+
+/**
+ * No more submissions; workers drain the queue and then sched_next()
+ * returns -1.
+ */
+void sched_close(Scheduler *s);
+
+/**
+ * Snapshot of a class's latency distribution (nearest-rank percentiles).
+ */
+void sched_class_stats(Scheduler *s, JobClass cls, ClassStats *out);
+
+#endif // JOBSCHED_H
@@ -0,0 +1,243 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+ * COMPLETION JOURNAL
+ * ------------------
+ *
+ * File format (text, one record per line):
+ *
+ *   # image-journal v1 <config key>
+ *   <output bytes>\t<file name>
+ *   ...
+ *
+ * A record is appended only after the outputs of a file are written, as
+ * one write() on an O_APPEND descriptor; the kernel serializes those, so
+ * lines from different threads or processes never interleave. A crash
+ * can at worst leave a torn last line, which has no trailing newline and
+ * is cut off on the next resume.
+ *
+ * fsync() runs every sync_every records (and at close), trading at most
+ * that many lost records on power loss for far fewer disk flushes.
+ * Losing a record only costs recomputing that file.
+ */
+
+#define JOURNAL_MAGIC        "# image-journal v1 "
+#define JOURNAL_DEFAULT_SYNC 64
+
+typedef struct {
+    char      *name;
+    long long  bytes;
+} JournalEntry;
+
+struct Journal {
+    int           fd;
+    int           sync_every;
+    long long     appended;    // records written by this process (atomic)
+
+    JournalEntry *table;       // open addressing, NULL name = empty
+    int           capacity;    // power of two
+    int           loaded;
+};
+
+static uint64_t name_hash(const char *s) {
+    uint64_t h = 1469598103934665603ULL;   // FNV-1a
+    for (const unsigned char *p = (const unsigned char *)s; *p; ++p) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static JournalEntry *table_slot(JournalEntry *table, int capacity,
+                                const char *name) {
+    uint64_t i = name_hash(name) & (uint64_t)(capacity - 1);
+    while (table[i].name && strcmp(table[i].name, name) != 0)
+        i = (i + 1) & (uint64_t)(capacity - 1);
+    return &table[i];
+}
+
+static int table_grow(Journal *j) {
+    int cap = j->capacity ? j->capacity * 2 : 256;
+    JournalEntry *t = (JournalEntry *)calloc(cap, sizeof(JournalEntry));
+    if (!t) return -1;
+    for (int i = 0; i < j->capacity; ++i) {
+        if (!j->table[i].name) continue;
+        *table_slot(t, cap, j->table[i].name) = j->table[i];
+    }
+    free(j->table);
+    j->table    = t;
+    j->capacity = cap;
+    return 0;
+}
+
+static void table_put(Journal *j, const char *name, long long bytes) {
+    if ((j->loaded + 1) * 2 > j->capacity && table_grow(j) != 0) return;
+
+    JournalEntry *e = table_slot(j->table, j->capacity, name);
+    if (e->name) {               // a later record supersedes an earlier one
+        e->bytes = bytes;
+        return;
+    }
+    e->name = strdup(name);
+    if (!e->name) return;
+    e->bytes = bytes;
+    j->loaded++;
+}
+
+/* mkdir -p for the journal's parent directory. */
+static void ensure_parent_directory(const char *path) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    char *slash = strrchr(tmp, '/');
+    if (!slash || slash == tmp) return;
+    *slash = '\0';
+
+    for (char *p = tmp + 1; *p; ++p) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(tmp, 0755);
+        *p = '/';
+    }
+    mkdir(tmp, 0755);
+}
+
+/*
+ * Load records from an existing journal. Returns the byte offset just
+ * past the last complete line, or -1 if the header does not match.
+ */
+static long load_records(Journal *j, FILE *f, const char *config_key) {
+    char  *line = NULL;
+    size_t cap  = 0;
+    ssize_t len;
+    long   valid_end = 0;
+
+    len = getline(&line, &cap, f);
+    if (len <= 0 || line[len - 1] != '\n' ||
+        strncmp(line, JOURNAL_MAGIC, strlen(JOURNAL_MAGIC)) != 0) {
+        free(line);
+        return -1;
+    }
+    line[len - 1] = '\0';
+    if (strcmp(line + strlen(JOURNAL_MAGIC), config_key) != 0) {
+        free(line);
+        return -1;
+    }
+    valid_end = (long)len;
+
+    while ((len = getline(&line, &cap, f)) > 0) {
+        if (line[len - 1] != '\n') break;          // torn tail
+        line[len - 1] = '\0';
+
+        char *tab = strchr(line, '\t');
+        if (!tab || tab[1] == '\0') break;
+        *tab = '\0';
+        table_put(j, tab + 1, atoll(line));
+        valid_end += (long)len;
+    }
+
+    free(line);
+    return valid_end;
+}
+
+Journal *journal_open(const char *path, const char *config_key,
+                      int resume, int sync_every) {
+    if (!path || !config_key) return NULL;
+
+    Journal *j = (Journal *)calloc(1, sizeof(Journal));
+    if (!j) return NULL;
+    j->fd         = -1;
+    j->sync_every = (sync_every > 0) ? sync_every : JOURNAL_DEFAULT_SYNC;
+
+    ensure_parent_directory(path);
+
+    long keep = -1;
+    if (resume) {
+        FILE *f = fopen(path, "r");
+        if (f) {
+            keep = load_records(j, f, config_key);
+            fclose(f);
+            if (keep < 0)
+                fprintf(stderr, "[journal] %s belongs to a different run; "
+                                "starting afresh\n", path);
+        }
+    }
+
+    j->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (j->fd < 0) {
+        perror("[journal] open");
+        journal_close(j);
+        return NULL;
+    }
+
+    if (keep >= 0) {
+        // Drop a torn last line so new records start on a fresh line
+        if (ftruncate(j->fd, (off_t)keep) != 0)
+            perror("[journal] ftruncate");
+    } else {
+        if (ftruncate(j->fd, 0) != 0)
+            perror("[journal] ftruncate");
+        char header[1200];
+        int n = snprintf(header, sizeof(header), "%s%s\n",
+                         JOURNAL_MAGIC, config_key);
+        if (n <= 0 || n >= (int)sizeof(header) ||
+            write(j->fd, header, (size_t)n) != n) {
+            fprintf(stderr, "[journal] Failed to write header to %s\n", path);
+            journal_close(j);
+            return NULL;
+        }
+        fsync(j->fd);
+    }
+
+    return j;
+}
+
+int journal_lookup(const Journal *j, const char *name, long long *out_bytes) {
+    if (!j || !name || j->capacity == 0) return 0;
+    const JournalEntry *e = table_slot(j->table, j->capacity, name);
+    if (!e->name) return 0;
+    if (out_bytes) *out_bytes = e->bytes;
+    return 1;
+}
+
+int journal_loaded(const Journal *j) {
+    return j ? j->loaded : 0;
+}
+
+int journal_record(Journal *j, const char *name, long long out_bytes) {
+    if (!j || !name || strpbrk(name, "\t\n")) return -1;
+
+    char line[600];
+    int n = snprintf(line, sizeof(line), "%lld\t%s\n", out_bytes, name);
+    if (n <= 0 || n >= (int)sizeof(line)) return -1;
+    if (write(j->fd, line, (size_t)n) != n) {
+        perror("[journal] write");
+        return -1;
+    }
+
+    long long count = __atomic_add_fetch(&j->appended, 1, __ATOMIC_RELAXED);
+    if (count % j->sync_every == 0)
+        fdatasync(j->fd);
+    return 0;
+}
+
+void journal_close(Journal *j) {
+    if (!j) return;
+    if (j->fd >= 0) {
+        fsync(j->fd);
+        close(j->fd);
+    }
+    for (int i = 0; i < j->capacity; ++i) free(j->table[i].name);
+    free(j->table);
+    free(j);
+}
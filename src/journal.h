@@ -0,0 +1,47 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+/**
+ * Append-only completion journal for long batch runs.
+ *
+ * Each processed input is recorded as one line (output bytes + file
+ * name) with a single O_APPEND write, so concurrent threads and forked
+ * worker processes can share one journal. fsync() is batched. On resume
+ * the existing records are loaded into a hash set in one pass.
+ */
+typedef struct Journal Journal;
+
+/**
+ * Open the journal at path, creating parent directories as needed.
+ * config_key identifies the run (inputs, outputs, pipeline); with
+ * resume != 0 and a matching key the existing records are loaded,
+ * otherwise the journal is started afresh. sync_every is the number of
+ * records between fsync() calls (<= 0 uses a default).
+ * Returns NULL on failure.
+ */
+Journal *journal_open(const char *path, const char *config_key,
+                      int resume, int sync_every);
+
+/**
+ * Look up a record loaded at open time. Returns 1 and sets *out_bytes
+ * if name was recorded as done, 0 otherwise.
+ */
+int journal_lookup(const Journal *j, const char *name, long long *out_bytes);
+
+/**
+ * Number of records loaded at open time.
+ */
+int journal_loaded(const Journal *j);
+
+/**
+ * Record name as completed with out_bytes of output. Thread-safe.
+ * Returns 0 on success.
+ */
+int journal_record(Journal *j, const char *name, long long out_bytes);
+
+/**
+ * fsync outstanding records and close the journal.
+ */
+void journal_close(Journal *j);
+
+#endif // JOURNAL_H
@@ -0,0 +1,21 @@
+#include "jsonout.h"
+
+/*
+ * The metrics files are written with fprintf, and most of their fields
+ * are numbers. Strings from the command line or the file system (input
+ * and output directories, file and host names) go through here, so a
+ * quote or backslash in a path cannot break the JSON.
+ */
+
+void write_json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (const unsigned char *p = (const unsigned char *)(s ? s : ""); *p; ++p) {
+        if (*p == '"' || *p == '\\')
+            fprintf(f, "\\%c", *p);
+        else if (*p < 0x20)
+            fprintf(f, "\\u%04x", *p);
+        else
+            fputc(*p, f);
+    }
+    fputc('"', f);
+}
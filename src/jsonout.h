@@ -0,0 +1,13 @@
+#ifndef JSONOUT_H
+#define JSONOUT_H
+
+#include <stdio.h>
+
+/**
+ * Write s to f as a quoted JSON string: quotes, backslashes and control
+ * bytes are escaped, other bytes (UTF-8 included) pass through. NULL
+ * writes "".
+ */
+void write_json_string(FILE *f, const char *s);
+
+#endif // JSONOUT_H
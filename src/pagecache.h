@@ -0,0 +1,50 @@
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+/**
+ * What to do with the OS page cache before each measured repetition.
+ */
+typedef enum {
+    PAGE_CACHE_NONE = 0,   // leave it alone (whatever ran before)
+    PAGE_CACHE_WARM,       // read every input first: measure compute only
+    PAGE_CACHE_COLD        // evict inputs and outputs: measure real I/O
+} PageCacheMode;
+
+/**
+ * Parse "none", "warm" or "cold". Returns 0 on success.
+ */
+int parse_page_cache_mode(const char *s, PageCacheMode *out);
+
+const char *page_cache_mode_name(PageCacheMode mode);
+
+/**
+ * Read path to the end so it is resident in the page cache.
+ * Returns the number of bytes read, or -1 if it cannot be opened.
+ */
+long long page_cache_warm(const char *path);
+
+/**
+ * Flush path's dirty pages and drop it from the page cache with
+ * posix_fadvise(POSIX_FADV_DONTNEED). A missing file is not an error.
+ * Returns 0 on success.
+ */
+int page_cache_evict(const char *path);
+
+/**
+ * Storage I/O counters of this process from /proc/self/io. The kernel
+ * folds in the counters of reaped child processes.
+ */
+typedef struct {
+    int       available;
+    long long rchar;         // bytes passed to read() (incl. cache hits)
+    long long wchar;
+    long long read_bytes;    // bytes actually fetched from storage
+    long long write_bytes;
+} IoCounters;
+
+/**
+ * Returns 0 on success; on failure *out is zeroed and not available.
+ */
+int io_counters_read(IoCounters *out);
+
+#endif // PAGECACHE_H
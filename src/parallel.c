@@ -11,9 +11,21 @@
 #include <omp.h>
 #include <strings.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "filters.h"
 #include "timer.h"
+#include "autotune.h"
+#include "pipeline.h"
+#include "image_cache.h"
+#include "procpool.h"
+#include "journal.h"
+#include "cpubudget.h"
+#include "diskorder.h"
+#include "pagecache.h"
+#include "energy.h"
+#include "dedup.h"
+#include "jsonout.h"
 
 /*
  * ABOUT cpu_cycles AND "PERF-LIKE" TOTAL CYCLES
@@ -93,8 +105,202 @@ typedef struct {
     int      max_width;
     int      max_height;
     int      threads_used;
+
+    // OpenMP loop configuration actually used for this run
+    int         schedule_kind;
+    int         chunk_size;
+    const char *profile_source;   // "default", "profile" or "autotune"
+
+    // Multi-output DAG mode (--dag); 0 sinks = fixed single-output pipeline
+    int         dag_sinks;
+    int         dag_nodes;
+    long long   outputs_written;
+
+    // Benchmark repetitions and decoded-image cache (--repeat, --cache-mb)
+    int         repeats;
+    long long   cache_budget_bytes;
+    long long   cache_hits;
+    long long   cache_misses;
+    long long   cache_evictions;
+    double      cache_decode_sec;
+    double      cache_saved_decode_sec;
+
+    SampleType  sample_type;      // --depth
+
+    // Multi-process sharded mode (--procs); 0 = OpenMP threads
+    int              procs;
+    int              worker_restarts;
+    int              poison_count;
+    char           **poison_files;    // names of inputs that crashed a worker
+    ProcWorkerStats *per_worker;      // `procs` entries
+
+    // Completion journal (--resume)
+    int              resumed;
+    int              resume_skipped;  // inputs already done with valid outputs
+
+    // CPU budget (affinity + cgroup quota) and CFS throttling during the run
+    int              cpu_online;
+    int              cpu_affinity;
+    double           cpu_quota;       // 0 = unlimited
+    int              cpu_budget;
+    const char      *cpu_budget_source;
+    int              throttle_available;
+    long long        throttle_periods;
+    long long        throttled_periods;
+    double           throttled_sec;
+
+    // Input ordering and readahead (--order, --prefetch)
+    FileOrder        file_order;
+    int              order_fallbacks; // extent order: files sorted by inode
+    int              prefetch_window;
+    long long        prefetch_advised;
+
+    // Page-cache state before each repetition (--page-cache) and storage
+    // traffic of the measured region from /proc/self/io
+    PageCacheMode    page_cache;
+    int              io_available;
+    long long        io_read_bytes;
+    long long        io_write_bytes;
+    long long        io_rchar;
+
+    // RAPL energy of the measured region (see energy.h)
+    int              energy_available;
+    double           energy_package_j;
+    double           energy_dram_j;
+    double           energy_total_j;
+    double           joules_per_image;
+    double           joules_per_megapixel;
+    double           avg_power_w;
+    double           energy_delay_product;   // J * s
+
+    // Decode limits and per-image time budget (--max-pixels, --max-mb,
+    // --budget-ms); thread mode only, workers count these as failed
+    long long        limit_max_pixels;
+    long long        limit_max_bytes;
+    double           budget_ms;
+    int              defer_over_budget;
+    int              limit_rejected;        // refused before decode
+    int              over_budget;           // budget ran out (first attempt)
+    int              over_budget_retried;   // deferred and then completed
+    double           max_image_ms;          // slowest image of the main pass
+
+    // Duplicate inputs linked to an owner's outputs (--dedup), summed
+    // over repetitions; linked outputs count in outputs_written
+    DedupMode        dedup_mode;
+    int              dedup_max_distance;
+    int              dedup_exact;
+    int              dedup_near;
+    int              dedup_fallbacks;       // owner had no outputs
+    double           dedup_hash_sec;
+    double           dedup_saved_sec;
+
+    // Hough nodes of --dag, summed over images and repetitions; the
+    // rate is votes over the whole run's wall time
+    long long        hough_votes;
+    double           hough_vote_sec;        // summed over threads
+    double           hough_votes_per_sec;
 } Metrics;
 
+/*
+ * Command-line options of the parallel driver:
+ *
+ *   parallel [input_dir] [output_dir] [--autotune] [--tune-sample N]
+ *            [--no-profile] [--dag SPEC] [--repeat N] [--cache-mb MB]
+ *            [--depth u8|u16|f32] [--procs N|auto]
+ *            [--resume] [--journal PATH] [--no-journal]
+ *            [--order readdir|name|inode|extent] [--prefetch N]
+ *            [--page-cache none|warm|cold]
+ *            [--max-pixels N] [--max-mb MB] [--budget-ms MS]
+ *            [--over-budget defer|skip]
+ *            [--dedup off|exact|near] [--dedup-distance N]
+ *
+ * Without --no-profile, a tuned profile saved for this host under
+ * results/profiles/ is applied automatically. With --dag, each image is
+ * decoded once and fed to every branch of SPEC (see pipeline.h); the
+ * branches' own output directories replace output_dir. --repeat runs
+ * the whole list N times inside the measured region; --cache-mb keeps
+ * decoded inputs in an LRU cache so repetitions skip the decode.
+ * --depth selects the sample type images are decoded to and filtered in
+ * (16-bit PNG output for u16/f32). --procs N forks N single-threaded
+ * worker processes instead of using OpenMP threads; a crashing image
+ * only costs its worker, which is restarted (see procpool.h).
+ * --procs auto uses one process per CPU of the budget below.
+ * Unless OMP_NUM_THREADS is set, the default thread count is the CPU
+ * budget from the affinity mask and cgroup quota (see cpubudget.h).
+ * --order sorts the inputs by on-disk placement and --prefetch keeps N
+ * files of WILLNEED readahead ahead of the threads (see diskorder.h).
+ * --page-cache warm reads every input before each repetition, cold
+ * drops inputs and outputs from the page cache (see pagecache.h); the
+ * preparation is not timed.
+ * Inputs whose header exceeds --max-pixels or a decoded size of
+ * --max-mb are refused before decode (0 = no limit). With --budget-ms,
+ * an image whose filters run past the budget is abandoned between row
+ * bands and either retried after the rest of the list without a budget
+ * (defer, the default) or dropped (skip); see filters.h.
+ * --dedup exact links byte-identical inputs to the outputs of the first
+ * copy instead of processing them again; near also links decoded images
+ * of the same size whose dHash is within --dedup-distance bits (default
+ * 6, at most 7). Thread mode only (see dedup.h).
+ * Every completed input is appended to a journal (default
+ * results/logs/parallel_journal.log); --resume skips inputs the journal
+ * lists whose outputs still exist with the recorded size.
+ */
+typedef struct {
+    const char *input_dir;
+    const char *output_dir;
+    int         autotune;
+    int         tune_sample;
+    int         use_profile;
+    const char *dag_spec;
+    int         repeats;
+    int         cache_mb;
+    SampleType  sample_type;
+    int         procs;
+    const char *journal_path;     // NULL = --no-journal
+    int         resume;
+    FileOrder   order;
+    int         prefetch;         // -1 = automatic
+    PageCacheMode page_cache;
+    DecodeLimits limits;
+    double      budget_ms;        // 0 = no per-image budget
+    int         defer_over_budget;
+    DedupMode   dedup;
+    int         dedup_distance;
+} Options;
+
+/*
+ * Everything a measured run needs besides the file list and the
+ * OpenMP profile. Shared by the real run and the autotune trials.
+ */
+typedef struct {
+    const char     *input_dir;
+    const char     *output_dir;
+    const Pipeline *dag;
+    ImageCache     *cache;
+    int             repeats;
+    SampleType      sample_type;
+    int             procs;
+    Journal        *journal;
+    Prefetcher     *prefetch;     // thread mode only; NULL = off
+    PageCacheMode   page_cache;
+    DecodeLimits    limits;
+    double          budget_sec;   // 0 = none
+    int             defer_over_budget;
+    DedupIndex     *dedup;        // thread mode only; NULL = off
+} RunConfig;
+
+#define PROFILE_DIR "results/profiles"
+
+#define DEFAULT_MAX_PIXELS 100000000LL   // 100 MP
+#define DEFAULT_MAX_MB     1024
+
+/* process_one_image() results besides 0 (done) */
+#define ITEM_FAILED      -1   // could not be decoded
+#define ITEM_REJECTED    -2   // header over the decode limits
+#define ITEM_OVER_BUDGET -3   // filters ran past the time budget
+#define ITEM_DUPLICATE   -4   // linked to an earlier input (run->dedup)
+#define JOURNAL_PATH "results/logs/parallel_journal.log"
+
 typedef struct {
     double speedup_wall_time;
     double speedup_cpu_user;
@@ -102,6 +308,10 @@ typedef struct {
     double speedup_pixels_per_sec;
     double parallel_efficiency;
 
+    // Energy: parallel / serial (below 1 = parallel is cheaper)
+    double energy_ratio;
+    double edp_ratio;
+
     // For reporting in compare_metrics.json
     uint64_t serial_est_total_cycles_all_threads;
     uint64_t parallel_est_total_cycles_all_threads;
@@ -155,8 +365,11 @@ static void write_parallel_metrics_json(const char *json_path,
 
     fprintf(f, "{\n");
     fprintf(f, "  \"variant\": \"parallel\",\n");
-    fprintf(f, "  \"input_dir\": \"%s\",\n", input_dir);
-    fprintf(f, "  \"output_dir\": \"%s\",\n", output_dir);
+    fprintf(f, "  \"input_dir\": ");
+    write_json_string(f, input_dir);
+    fprintf(f, ",\n  \"output_dir\": ");
+    write_json_string(f, output_dir);
+    fprintf(f, ",\n");
     fprintf(f, "  \"metrics\": {\n");
     fprintf(f, "    \"images_processed\": %d,\n", m->images_processed);
     fprintf(f, "    \"total_pixels\": %lld,\n", m->total_pixels);
@@ -177,9 +390,101 @@ static void write_parallel_metrics_json(const char *json_path,
             m->estimated_cycles_per_pixel_all_threads);
     fprintf(f, "    \"max_width\": %d,\n", m->max_width);
     fprintf(f, "    \"max_height\": %d,\n", m->max_height);
-    fprintf(f, "    \"threads_used\": %d\n", m->threads_used);
-    fprintf(f, "  }\n");
-    fprintf(f, "}\n");
+    fprintf(f, "    \"threads_used\": %d,\n", m->threads_used);
+    fprintf(f, "    \"schedule\": \"%s\",\n",
+            tune_schedule_name(m->schedule_kind));
+    fprintf(f, "    \"chunk_size\": %d,\n", m->chunk_size);
+    fprintf(f, "    \"profile_source\": \"%s\",\n",
+            m->profile_source ? m->profile_source : "default");
+    fprintf(f, "    \"dag_sinks\": %d,\n", m->dag_sinks);
+    fprintf(f, "    \"dag_nodes\": %d,\n", m->dag_nodes);
+    fprintf(f, "    \"outputs_written\": %lld,\n", m->outputs_written);
+    fprintf(f, "    \"hough_votes\": %lld,\n", m->hough_votes);
+    fprintf(f, "    \"hough_vote_sec\": %.9f,\n", m->hough_vote_sec);
+    fprintf(f, "    \"hough_votes_per_sec\": %.1f,\n", m->hough_votes_per_sec);
+    fprintf(f, "    \"repeats\": %d,\n", m->repeats);
+    fprintf(f, "    \"cache_budget_bytes\": %lld,\n", m->cache_budget_bytes);
+    fprintf(f, "    \"cache_hits\": %lld,\n", m->cache_hits);
+    fprintf(f, "    \"cache_misses\": %lld,\n", m->cache_misses);
+    fprintf(f, "    \"cache_hit_rate\": %.6f,\n",
+            (m->cache_hits + m->cache_misses) > 0
+                ? (double)m->cache_hits / (double)(m->cache_hits + m->cache_misses)
+                : 0.0);
+    fprintf(f, "    \"cache_evictions\": %lld,\n", m->cache_evictions);
+    fprintf(f, "    \"cache_decode_sec\": %.9f,\n", m->cache_decode_sec);
+    fprintf(f, "    \"cache_saved_decode_sec\": %.9f,\n", m->cache_saved_decode_sec);
+    fprintf(f, "    \"sample_type\": \"%s\",\n", sample_type_name(m->sample_type));
+    fprintf(f, "    \"mode\": \"%s\",\n", m->procs > 0 ? "processes" : "threads");
+    fprintf(f, "    \"worker_processes\": %d,\n", m->procs);
+    fprintf(f, "    \"worker_restarts\": %d,\n", m->worker_restarts);
+    fprintf(f, "    \"cpu_online\": %d,\n", m->cpu_online);
+    fprintf(f, "    \"cpu_affinity\": %d,\n", m->cpu_affinity);
+    fprintf(f, "    \"cpu_quota\": %.3f,\n", m->cpu_quota);
+    fprintf(f, "    \"cpu_budget\": %d,\n", m->cpu_budget);
+    fprintf(f, "    \"cpu_budget_source\": \"%s\",\n",
+            m->cpu_budget_source ? m->cpu_budget_source : "online");
+    fprintf(f, "    \"throttle_available\": %s,\n",
+            m->throttle_available ? "true" : "false");
+    fprintf(f, "    \"throttle_periods\": %lld,\n", m->throttle_periods);
+    fprintf(f, "    \"throttled_periods\": %lld,\n", m->throttled_periods);
+    fprintf(f, "    \"throttled_sec\": %.6f,\n", m->throttled_sec);
+    fprintf(f, "    \"file_order\": \"%s\",\n", file_order_name(m->file_order));
+    fprintf(f, "    \"order_fallbacks\": %d,\n", m->order_fallbacks);
+    fprintf(f, "    \"prefetch_window\": %d,\n", m->prefetch_window);
+    fprintf(f, "    \"prefetch_advised\": %lld,\n", m->prefetch_advised);
+    fprintf(f, "    \"page_cache_mode\": \"%s\",\n", page_cache_mode_name(m->page_cache));
+    fprintf(f, "    \"io_available\": %s,\n", m->io_available ? "true" : "false");
+    fprintf(f, "    \"io_read_bytes\": %lld,\n", m->io_read_bytes);
+    fprintf(f, "    \"io_write_bytes\": %lld,\n", m->io_write_bytes);
+    fprintf(f, "    \"io_rchar\": %lld,\n", m->io_rchar);
+    fprintf(f, "    \"energy_available\": %s,\n", m->energy_available ? "true" : "false");
+    fprintf(f, "    \"energy_package_j\": %.6f,\n", m->energy_package_j);
+    fprintf(f, "    \"energy_dram_j\": %.6f,\n", m->energy_dram_j);
+    fprintf(f, "    \"energy_total_j\": %.6f,\n", m->energy_total_j);
+    fprintf(f, "    \"joules_per_image\": %.9f,\n", m->joules_per_image);
+    fprintf(f, "    \"joules_per_megapixel\": %.9f,\n", m->joules_per_megapixel);
+    fprintf(f, "    \"avg_power_w\": %.6f,\n", m->avg_power_w);
+    fprintf(f, "    \"energy_delay_product\": %.9f,\n", m->energy_delay_product);
+    fprintf(f, "    \"limit_max_pixels\": %lld,\n", m->limit_max_pixels);
+    fprintf(f, "    \"limit_max_bytes\": %lld,\n", m->limit_max_bytes);
+    fprintf(f, "    \"limit_rejected\": %d,\n", m->limit_rejected);
+    fprintf(f, "    \"budget_ms\": %.3f,\n", m->budget_ms);
+    fprintf(f, "    \"over_budget_policy\": \"%s\",\n",
+            m->defer_over_budget ? "defer" : "skip");
+    fprintf(f, "    \"over_budget\": %d,\n", m->over_budget);
+    fprintf(f, "    \"over_budget_retried\": %d,\n", m->over_budget_retried);
+    fprintf(f, "    \"max_image_ms\": %.3f,\n", m->max_image_ms);
+    fprintf(f, "    \"dedup_mode\": \"%s\",\n", dedup_mode_name(m->dedup_mode));
+    fprintf(f, "    \"dedup_max_distance\": %d,\n", m->dedup_max_distance);
+    fprintf(f, "    \"dedup_exact\": %d,\n", m->dedup_exact);
+    fprintf(f, "    \"dedup_near\": %d,\n", m->dedup_near);
+    fprintf(f, "    \"dedup_fallbacks\": %d,\n", m->dedup_fallbacks);
+    fprintf(f, "    \"dedup_hash_sec\": %.9f,\n", m->dedup_hash_sec);
+    fprintf(f, "    \"dedup_saved_sec\": %.9f,\n", m->dedup_saved_sec);
+    fprintf(f, "    \"resumed\": %s,\n", m->resumed ? "true" : "false");
+    fprintf(f, "    \"resume_skipped\": %d,\n", m->resume_skipped);
+    fprintf(f, "    \"poison_files\": [");
+    for (int i = 0; i < m->poison_count; ++i) {
+        if (i) fprintf(f, ", ");
+        write_json_string(f, m->poison_files[i]);
+    }
+    fprintf(f, "]\n");
+    fprintf(f, "  }");
+
+    if (m->per_worker) {
+        fprintf(f, ",\n  \"per_worker\": [\n");
+        for (int i = 0; i < m->procs; ++i) {
+            const ProcWorkerStats *w = &m->per_worker[i];
+            fprintf(f, "    {\"worker\": %d, \"images_processed\": %d, "
+                       "\"images_failed\": %d, \"crashes\": %d, "
+                       "\"total_pixels\": %lld, \"busy_time_sec\": %.9f}%s\n",
+                    i, w->images_processed, w->images_failed, w->crashes,
+                    w->total_pixels, w->busy_time_sec,
+                    (i + 1 < m->procs) ? "," : "");
+        }
+        fprintf(f, "  ]");
+    }
+    fprintf(f, "\n}\n");
 
     fclose(f);
     printf("[parallel] Metrics written to %s\n", json_path);
@@ -261,6 +566,22 @@ static int load_serial_metrics(const char *json_path, Metrics *out) {
     out->cycles_per_pixel        = extract_double(buf, "\"cycles_per_pixel\"");
     out->max_width               = extract_int   (buf, "\"max_width\"");
     out->max_height              = extract_int   (buf, "\"max_height\"");
+    out->io_read_bytes           = extract_ll    (buf, "\"io_read_bytes\"");
+    out->io_available            = strstr(buf, "\"io_available\": true") != NULL;
+    out->energy_available        = strstr(buf, "\"energy_available\": true") != NULL;
+    out->energy_total_j          = extract_double(buf, "\"energy_total_j\"");
+    out->joules_per_image        = extract_double(buf, "\"joules_per_image\"");
+    out->joules_per_megapixel    = extract_double(buf, "\"joules_per_megapixel\"");
+    out->energy_delay_product    = extract_double(buf, "\"energy_delay_product\"");
+    // absent in metrics from before --depth: those runs were u8
+    if (strstr(buf, "\"sample_type\": \"u16\""))
+        out->sample_type = SAMPLE_U16;
+    else if (strstr(buf, "\"sample_type\": \"f32\""))
+        out->sample_type = SAMPLE_F32;
+    if (strstr(buf, "\"page_cache_mode\": \"warm\""))
+        out->page_cache = PAGE_CACHE_WARM;
+    else if (strstr(buf, "\"page_cache_mode\": \"cold\""))
+        out->page_cache = PAGE_CACHE_COLD;
 
     free(buf);
     return 1;
@@ -319,8 +640,22 @@ static void write_compare_json(const char *json_path,
     fprintf(f, "    \"parallel_cpu_utilization\": %.6f,\n", parallel_cpu_util);
     fprintf(f, "    \"serial_est_total_cycles_all_threads\": %llu,\n",
             (unsigned long long)cmp->serial_est_total_cycles_all_threads);
-    fprintf(f, "    \"parallel_est_total_cycles_all_threads\": %llu\n",
+    fprintf(f, "    \"parallel_est_total_cycles_all_threads\": %llu,\n",
             (unsigned long long)cmp->parallel_est_total_cycles_all_threads);
+    // Wall times are only comparable when both ran in the same cache state
+    fprintf(f, "    \"page_cache_modes_match\": %s,\n",
+            serial->page_cache == parallel->page_cache ? "true" : "false");
+    // ... and filtered the same sample type (--depth)
+    fprintf(f, "    \"sample_types_match\": %s,\n",
+            serial->sample_type == parallel->sample_type ? "true" : "false");
+    fprintf(f, "    \"energy_available\": %s,\n",
+            (serial->energy_available && parallel->energy_available) ? "true" : "false");
+    fprintf(f, "    \"serial_joules_per_image\": %.9f,\n", serial->joules_per_image);
+    fprintf(f, "    \"parallel_joules_per_image\": %.9f,\n", parallel->joules_per_image);
+    fprintf(f, "    \"serial_joules_per_megapixel\": %.9f,\n", serial->joules_per_megapixel);
+    fprintf(f, "    \"parallel_joules_per_megapixel\": %.9f,\n", parallel->joules_per_megapixel);
+    fprintf(f, "    \"energy_ratio\": %.6f,\n", cmp->energy_ratio);
+    fprintf(f, "    \"edp_ratio\": %.6f\n", cmp->edp_ratio);
     fprintf(f, "  },\n");
 
     fprintf(f, "  \"serial\": {\n");
@@ -336,7 +671,11 @@ static void write_compare_json(const char *json_path,
     fprintf(f, "    \"cycles_per_image_tsc\": %.3f,\n", serial->cycles_per_image);
     fprintf(f, "    \"cycles_per_pixel_tsc\": %.3f,\n", serial->cycles_per_pixel);
     fprintf(f, "    \"max_width\": %d,\n", serial->max_width);
-    fprintf(f, "    \"max_height\": %d\n", serial->max_height);
+    fprintf(f, "    \"max_height\": %d,\n", serial->max_height);
+    fprintf(f, "    \"sample_type\": \"%s\",\n", sample_type_name(serial->sample_type));
+    fprintf(f, "    \"page_cache_mode\": \"%s\",\n",
+            page_cache_mode_name(serial->page_cache));
+    fprintf(f, "    \"io_read_bytes\": %lld\n", serial->io_read_bytes);
     fprintf(f, "  },\n");
 
     fprintf(f, "  \"parallel\": {\n");
@@ -359,7 +698,11 @@ static void write_compare_json(const char *json_path,
             parallel->estimated_cycles_per_pixel_all_threads);
     fprintf(f, "    \"max_width\": %d,\n", parallel->max_width);
     fprintf(f, "    \"max_height\": %d,\n", parallel->max_height);
-    fprintf(f, "    \"threads_used\": %d\n", parallel->threads_used);
+    fprintf(f, "    \"threads_used\": %d,\n", parallel->threads_used);
+    fprintf(f, "    \"sample_type\": \"%s\",\n", sample_type_name(parallel->sample_type));
+    fprintf(f, "    \"page_cache_mode\": \"%s\",\n",
+            page_cache_mode_name(parallel->page_cache));
+    fprintf(f, "    \"io_read_bytes\": %lld\n", parallel->io_read_bytes);
     fprintf(f, "  }\n");
 
     fprintf(f, "}\n");
@@ -368,28 +711,19 @@ static void write_compare_json(const char *json_path,
 }
 
 /*
- * Main parallel processing function.
- * - Collects file names
- * - Runs an OpenMP parallel for over images
- * - Measures time, CPU time, TSC
- * - Derives both TSC-based and perf-like cycle metrics
+ * Collect all image file names from input_dir up front, so the OpenMP
+ * loop iterates over a plain array. Returns the number of files found
+ * (0 on error); release the list with free_file_list().
  */
-static void process_directory_parallel(const char *input_dir,
-                                       const char *output_dir,
-                                       Metrics *metrics) {
-    memset(metrics, 0, sizeof(*metrics));
-    metrics->max_width  = 0;
-    metrics->max_height = 0;
-
-    ensure_directory(output_dir);
+static int collect_image_files(const char *input_dir, char ***out_files) {
+    *out_files = NULL;
 
     DIR *dir = opendir(input_dir);
     if (!dir) {
         perror("[parallel] opendir input_dir");
-        return;
+        return 0;
     }
 
-    // 1) Collect file names first (so OpenMP loop is clean)
     char **files = NULL;
     int file_count = 0;
     int capacity   = 0;
@@ -410,69 +744,564 @@ static void process_directory_parallel(const char *input_dir,
     }
     closedir(dir);
 
-    if (file_count == 0) {
-        printf("[parallel] No images found in %s\n", input_dir);
-        free(files);
+    *out_files = files;
+    return file_count;
+}
+
+static void free_file_list(char **files, int file_count) {
+    for (int i = 0; i < file_count; ++i) {
+        free(files[i]);
+    }
+    free(files);
+}
+
+static void apply_profile(const TuneProfile *prof) {
+    omp_set_num_threads(prof->threads);
+    omp_set_schedule((omp_sched_t)prof->schedule, prof->chunk);
+}
+
+/*
+ * Total bytes of the outputs written for one input, or -1 if any is
+ * missing or empty. This is what the journal records and --resume checks.
+ */
+static long long output_bytes(const RunConfig *run, const char *name) {
+    if (run->dag) return pipeline_output_bytes(run->dag, name);
+
+    char out_path[512];
+    struct stat st;
+    snprintf(out_path, sizeof(out_path), "%s/%s", run->output_dir, name);
+    if (stat(out_path, &st) != 0 || st.st_size <= 0) return -1;
+    return (long long)st.st_size;
+}
+
+static void journal_completion(const RunConfig *run, const char *name,
+                               int outputs) {
+    if (!run->journal) return;
+    int expected = run->dag ? run->dag->n_sinks : 1;
+    if (outputs < expected) return;   // partial: redo on resume
+
+    long long bytes = output_bytes(run, name);
+    if (bytes > 0) journal_record(run->journal, name, bytes);
+}
+
+static void remove_output(const char *path, const char *sink, StageKind kind,
+                          void *ctx) {
+    (void)sink;
+    (void)kind;
+    (void)ctx;
+    if (unlink(path) != 0 && errno != ENOENT)
+        fprintf(stderr, "[parallel] Cannot remove %s: %s\n", path, strerror(errno));
+}
+
+/*
+ * Decode one input and run it through the DAG or the fixed
+ * gray -> blur -> sobel pipeline. Returns 0 and fills *out, or one of
+ * the ITEM_* codes: the image could not be loaded, its header exceeds
+ * run->limits, the filters ran past budget_sec (> 0), in which case
+ * nothing was written, or run->dedup found it to be a duplicate of an
+ * earlier input (`index` is its position in the list; < 0 = do not
+ * check). Shared by the thread and process modes.
+ */
+static int process_one_image(const RunConfig *run, const char *name, int index,
+                             ProcItemResult *out, double budget_sec) {
+    char in_path[512];
+    char out_path[512];
+    snprintf(in_path, sizeof(in_path), "%s/%s", run->input_dir, name);
+    snprintf(out_path, sizeof(out_path), "%s/%s", run->output_dir, name);
+
+    int w, h;
+    int verdict = check_decode_limits(in_path, run->sample_type, &run->limits, &w, &h);
+    if (verdict == 1) {
+        fprintf(stderr, "[parallel] Skip %dx%d image over decode limits: %s\n",
+                w, h, in_path);
+        return ITEM_REJECTED;
+    }
+    if (verdict != 0) {
+        fprintf(stderr, "[parallel] Skip unreadable header: %s\n", in_path);
+        return ITEM_FAILED;
+    }
+
+    int dedup = (run->dedup && index >= 0);
+    if (dedup && dedup_claim_file(run->dedup, index) >= 0)
+        return ITEM_DUPLICATE;
+
+    // The budget covers decode too, but only the filters can stop early
+    filter_budget_arm(budget_sec);
+    Image *img = image_cache_load(run->cache, in_path, run->sample_type);
+    if (!img) {
+        filter_budget_disarm();
+        fprintf(stderr, "[parallel] Skip failed load: %s\n", in_path);
+        return ITEM_FAILED;
+    }
+    if (dedup && dedup_claim_image(run->dedup, index, img) >= 0) {
+        filter_budget_disarm();
+        free_image(img);
+        return ITEM_DUPLICATE;
+    }
+
+    out->pixels  = (long long)img->width * img->height;
+    out->width   = img->width;
+    out->height  = img->height;
+    out->outputs = 0;
+    out->hough_votes = 0;
+    out->hough_sec   = 0.0;
+
+    if (run->dag) {
+        // One decode feeds every branch; pipeline_run frees img
+        PipelineRunStats st;
+        out->outputs = pipeline_run(run->dag, img, name, &st);
+        out->hough_votes = st.hough_votes;
+        out->hough_sec   = st.hough_sec;
+        int over = filter_budget_exceeded();
+        filter_budget_disarm();
+        if (over) {
+            // sinks above the stage that ran out were already written
+            pipeline_for_each_output(run->dag, name, remove_output, NULL);
+            out->outputs = 0;
+            return ITEM_OVER_BUDGET;
+        }
+        journal_completion(run, name, out->outputs);
+        return 0;
+    }
+
+    // Apply same pipeline as serial version
+    apply_grayscale(img);
+    apply_box_blur(img, 2);
+    apply_sobel_edge(img);
+
+    int over = filter_budget_exceeded();
+    filter_budget_disarm();
+    if (over) {
+        free_image(img);   // partially filtered
+        return ITEM_OVER_BUDGET;
+    }
+
+    if (save_image_png(out_path, img) != 0) {
+        fprintf(stderr, "[parallel] Failed to save %s\n", out_path);
+    } else {
+        out->outputs = 1;
+    }
+
+    free_image(img);
+    journal_completion(run, name, out->outputs);
+    return 0;
+}
+
+/* --- multi-process mode --- */
+
+typedef struct {
+    const RunConfig *run;
+    char           **files;
+} ProcContext;
+
+static int proc_item(int index, void *ctx, ProcItemResult *out) {
+    const ProcContext *pc = (const ProcContext *)ctx;
+    int rc = process_one_image(pc->run, pc->files[index], index, out,
+                               pc->run->budget_sec);
+    return (rc == 0) ? 0 : -1;   // workers count rejected/over budget as failed
+}
+
+/*
+ * Run files[] `repeats` times over through run->procs forked workers
+ * and fold their per-worker counters into the totals.
+ */
+static void process_with_workers(const RunConfig *run, char **files,
+                                 int file_count, int repeats, Metrics *metrics,
+                                 long long *total_pixels, int *images_processed,
+                                 long long *outputs_written,
+                                 long long *hough_votes, double *hough_sec,
+                                 int *max_w, int *max_h) {
+    ProcContext pc = { run, files };
+    ProcPoolResult res;
+    if (procpool_run(run->procs, file_count, repeats, proc_item, &pc, &res) != 0)
         return;
+
+    for (int w = 0; w < res.workers && res.per_worker; ++w) {
+        const ProcWorkerStats *ws = &res.per_worker[w];
+        *total_pixels     += ws->total_pixels;
+        *images_processed += ws->images_processed;
+        *outputs_written  += ws->outputs_written;
+        *hough_votes      += ws->hough_votes;
+        *hough_sec        += ws->hough_sec;
+        if (ws->max_width  > *max_w) *max_w = ws->max_width;
+        if (ws->max_height > *max_h) *max_h = ws->max_height;
     }
 
-    metrics->threads_used = omp_get_max_threads();
+    metrics->worker_restarts = res.restarts;
+    metrics->poison_count    = res.poison_count;
+    if (res.poison_count > 0) {
+        metrics->poison_files = (char **)malloc(res.poison_count * sizeof(char *));
+        for (int i = 0; metrics->poison_files && i < res.poison_count; ++i) {
+            metrics->poison_files[i] = strdup(files[res.poison[i]]);
+            fprintf(stderr, "[parallel] Poison file skipped: %s\n",
+                    metrics->poison_files[i]);
+        }
+        if (!metrics->poison_files) metrics->poison_count = 0;
+    }
+    metrics->per_worker = res.per_worker;   // ownership moves to metrics
+    res.per_worker = NULL;
+    procpool_result_free(&res);
+}
 
-    // 2) Start timers and TSC
-    double   user_before, sys_before, user_after, sys_after;
-    get_cpu_times(&user_before, &sys_before);
-    double   t_start = wall_time();
-    uint64_t c_start = read_tsc();
+static void evict_output(const char *path, const char *sink, StageKind kind,
+                         void *ctx) {
+    (void)sink;
+    (void)kind;
+    (void)ctx;
+    page_cache_evict(path);
+}
 
-    long long total_pixels = 0;
-    int max_w = 0, max_h = 0;
-    int images_processed = 0;
+/*
+ * Put the page cache into the state --page-cache asks for before a
+ * measured repetition: every input read (warm), or every input and
+ * output dropped (cold).
+ */
+static void prepare_page_cache(const RunConfig *run, char **files, int file_count) {
+    if (run->page_cache == PAGE_CACHE_NONE) return;
 
-#pragma omp parallel for reduction(+:total_pixels,images_processed) reduction(max:max_w,max_h)
     for (int i = 0; i < file_count; ++i) {
         char in_path[512];
-        char out_path[512];
-        snprintf(in_path, sizeof(in_path), "%s/%s", input_dir, files[i]);
-        snprintf(out_path, sizeof(out_path), "%s/%s", output_dir, files[i]);
+        snprintf(in_path, sizeof(in_path), "%s/%s", run->input_dir, files[i]);
 
-        Image *img = load_image(in_path);
-        if (!img) {
-            fprintf(stderr, "[parallel] Skip failed load: %s\n", in_path);
+        if (run->page_cache == PAGE_CACHE_WARM) {
+            page_cache_warm(in_path);
             continue;
         }
 
-        long long pixels = (long long)img->width * img->height;
-        total_pixels     += pixels;
-        images_processed += 1;
+        page_cache_evict(in_path);
+        if (run->dag) {
+            pipeline_for_each_output(run->dag, files[i], evict_output, NULL);
+        } else {
+            char out_path[512];
+            snprintf(out_path, sizeof(out_path), "%s/%s", run->output_dir, files[i]);
+            page_cache_evict(out_path);
+        }
+    }
 
-        if (img->width  > max_w) max_w = img->width;
-        if (img->height > max_h) max_h = img->height;
+    // The readahead issued so far was just dropped
+    if (run->page_cache == PAGE_CACHE_COLD)
+        prefetch_rewind(run->prefetch);
+}
 
-        // Apply same pipeline as serial version
-        apply_grayscale(img);
-        apply_box_blur(img, 2);
-        apply_sobel_edge(img);
+/* --- duplicate inputs (--dedup) --- */
 
-        if (save_image_png(out_path, img) != 0) {
-            fprintf(stderr, "[parallel] Failed to save %s\n", out_path);
-        }
+typedef struct {
+    const char *owner;    // input whose outputs exist
+    const char *name;     // duplicate taking them over
+    int         linked;
+    int         failed;
+} LinkContext;
+
+/* The duplicate's output sits next to the owner's, named the same way. */
+static void link_output(const char *path, const char *sink, StageKind kind,
+                        void *ctx) {
+    LinkContext *lc = (LinkContext *)ctx;
+    char dst[512];
+    pipeline_output_path(dst, sizeof(dst), sink, kind, lc->name);
+    if (dedup_link_file(path, dst) == 0) lc->linked++;
+    else lc->failed++;
+}
 
-        free_image(img);
+/*
+ * Give duplicate `name` every output of `owner`. Returns the number of
+ * outputs linked, or -1 if any could not be.
+ */
+static int link_duplicate_outputs(const RunConfig *run, const char *owner,
+                                  const char *name) {
+    LinkContext lc = { owner, name, 0, 0 };
+    if (run->dag) {
+        pipeline_for_each_output(run->dag, owner, link_output, &lc);
+    } else {
+        char out_path[512];
+        snprintf(out_path, sizeof(out_path), "%s/%s", run->output_dir, owner);
+        link_output(out_path, run->output_dir, STAGE_SOURCE, &lc);
     }
+    return lc.failed ? -1 : lc.linked;
+}
+
+/*
+ * Run the pipeline over files[] with the given OpenMP configuration.
+ * When run->dag is non-NULL, every image goes through the multi-output
+ * DAG instead of the fixed gray -> blur -> sobel pipeline.
+ * - Runs an OpenMP parallel for over images (schedule(runtime)),
+ *   run->repeats times, or hands them to forked workers (run->procs)
+ * - Measures time, CPU time, TSC and /proc/self/io per repetition,
+ *   excluding the page-cache preparation in between
+ * - Derives both TSC-based and perf-like cycle metrics
+ */
+static void process_file_list(const RunConfig *run,
+                              char **files,
+                              int file_count,
+                              const TuneProfile *prof,
+                              Metrics *metrics) {
+    int repeats = (run->repeats > 0) ? run->repeats : 1;
 
-    // 3) Stop timers and TSC
-    uint64_t c_end = read_tsc();
-    double   t_end = wall_time();
-    get_cpu_times(&user_after, &sys_after);
+    memset(metrics, 0, sizeof(*metrics));
+    metrics->max_width  = 0;
+    metrics->max_height = 0;
+
+    apply_profile(prof);
+    if (run->procs > 0)
+        omp_set_num_threads(1);   // parallelism comes from the processes
+    metrics->threads_used  = (run->procs > 0) ? run->procs : prof->threads;
+    metrics->procs         = run->procs;
+    metrics->schedule_kind = prof->schedule;
+    metrics->chunk_size    = prof->chunk;
+    metrics->repeats       = repeats;
+    metrics->sample_type   = run->sample_type;
+    metrics->page_cache    = run->page_cache;
+
+    CacheStats cache_before;
+    image_cache_stats(run->cache, &cache_before);
+
+    long long total_pixels = 0;
+    int max_w = 0, max_h = 0;
+    int images_processed = 0;
+    long long outputs_written = 0;
+    long long hough_votes = 0;
+    double    hough_sec = 0.0;
+
+    double   wall_sum = 0.0, user_sum = 0.0, sys_sum = 0.0;
+    uint64_t cycles_sum = 0;
+    int      io_available = 1;
+    int      limit_rejected = 0, over_budget = 0, retried = 0;
+    double   max_image_ms = 0.0;
+
+    // Over-budget images of one repetition, retried at its end (defer)
+    int *deferred = NULL;
+    if (run->procs == 0 && run->budget_sec > 0.0 && run->defer_over_budget)
+        deferred = (int *)malloc(((size_t)file_count + 1) * sizeof(int));
+
+    // With --dedup: outputs each input wrote this repetition, and the
+    // (duplicate, owner) pairs to link once the owners are done
+    int *item_outputs = NULL;
+    int *dup_pairs    = NULL;
+    if (run->dedup) {
+        item_outputs = (int *)calloc((size_t)file_count + 1, sizeof(int));
+        dup_pairs    = (int *)malloc(((size_t)file_count + 1) * 2 * sizeof(int));
+        if (!item_outputs || !dup_pairs) {
+            fprintf(stderr, "[parallel] Out of memory for --dedup; disabled\n");
+            free(item_outputs);
+            free(dup_pairs);
+            item_outputs = dup_pairs = NULL;
+        }
+    }
+    DedupIndex *dedup = item_outputs ? run->dedup : NULL;
+    RunConfig   item_run = *run;   // process_one_image claims in `dedup`
+    item_run.dedup = dedup;
+    run = &item_run;
+    int    expected_outputs = run->dag ? run->dag->n_sinks : 1;
+    double fallback_budget  = run->defer_over_budget ? 0.0 : run->budget_sec;
+    DedupStats dedup_total;
+    memset(&dedup_total, 0, sizeof(dedup_total));
+
+    EnergyMeter   meter;
+    EnergyReading energy = {0};
+    energy_open(&meter);
+
+    // Forked workers run all repetitions in one pool, so they form a
+    // single measured segment; threads are measured per repetition
+    int segments = (run->procs > 0) ? 1 : repeats;
+
+    for (int seg = 0; seg < segments; ++seg) {
+        prepare_page_cache(run, files, file_count);
+        if (dedup) {
+            dedup_reset(dedup);
+            memset(item_outputs, 0, (size_t)file_count * sizeof(int));
+        }
+
+        IoCounters io_before, io_after;
+        io_counters_read(&io_before);
+        energy_begin(&meter);
+
+        // Start timers and TSC
+        double   user_before, sys_before, user_after, sys_after;
+        double   child_user_before, child_sys_before, child_user_after, child_sys_after;
+        get_cpu_times(&user_before, &sys_before);
+        get_children_cpu_times(&child_user_before, &child_sys_before);
+        double   t_start = wall_time();
+        uint64_t c_start = read_tsc();
+
+        if (run->procs > 0) {
+            process_with_workers(run, files, file_count, repeats, metrics,
+                                 &total_pixels, &images_processed,
+                                 &outputs_written, &hough_votes, &hough_sec,
+                                 &max_w, &max_h);
+        } else {
+            int n_deferred = 0;
+#pragma omp parallel for schedule(runtime) reduction(+:total_pixels,images_processed,outputs_written,hough_votes,hough_sec,limit_rejected,over_budget) reduction(max:max_w,max_h,max_image_ms)
+            for (int i = 0; i < file_count; ++i) {
+                ProcItemResult r;
+                prefetch_advance(run->prefetch);
+                double t0 = wall_time();
+                int rc = process_one_image(run, files[i], i, &r, run->budget_sec);
+                double ms = (wall_time() - t0) * 1000.0;
+                if (ms > max_image_ms) max_image_ms = ms;
+                dedup_set_cost(dedup, i, ms / 1000.0);
+
+                if (rc == ITEM_REJECTED) limit_rejected++;
+                if (rc == ITEM_OVER_BUDGET) {
+                    over_budget++;
+                    if (deferred) {
+                        int slot;
+#pragma omp atomic capture
+                        slot = n_deferred++;
+                        deferred[slot] = i;
+                    } else {
+                        fprintf(stderr, "[parallel] Over budget, skipped: %s\n",
+                                files[i]);
+                    }
+                }
+                if (rc != 0)
+                    continue;
+
+                if (item_outputs) item_outputs[i] = r.outputs;
+                total_pixels     += r.pixels;
+                images_processed += 1;
+                outputs_written  += r.outputs;
+                hough_votes      += r.hough_votes;
+                hough_sec        += r.hough_sec;
+                if (r.width  > max_w) max_w = r.width;
+                if (r.height > max_h) max_h = r.height;
+            }
+
+            // Deferred images run after everything else, without a budget
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:total_pixels,images_processed,outputs_written,hough_votes,hough_sec,retried) reduction(max:max_w,max_h)
+            for (int k = 0; k < n_deferred; ++k) {
+                ProcItemResult r;
+                int i = deferred[k];
+                double t0 = wall_time();
+                if (process_one_image(run, files[i], i, &r, 0.0) != 0)
+                    continue;
+
+                dedup_set_cost(dedup, i, wall_time() - t0);
+                if (item_outputs) item_outputs[i] = r.outputs;
+                total_pixels     += r.pixels;
+                images_processed += 1;
+                outputs_written  += r.outputs;
+                hough_votes      += r.hough_votes;
+                hough_sec        += r.hough_sec;
+                retried          += 1;
+                if (r.width  > max_w) max_w = r.width;
+                if (r.height > max_h) max_h = r.height;
+            }
+
+            // Duplicates take over their owner's outputs; if the owner
+            // wrote none (failed, skipped), the duplicate is processed
+            int n_dups = 0;
+            for (int i = 0; dedup && i < file_count; ++i) {
+                int owner = dedup_owner(dedup, i);
+                if (owner < 0) continue;
+                dup_pairs[2 * n_dups]     = i;
+                dup_pairs[2 * n_dups + 1] = owner;
+                n_dups++;
+            }
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:total_pixels,images_processed,outputs_written,hough_votes,hough_sec) reduction(max:max_w,max_h)
+            for (int k = 0; k < n_dups; ++k) {
+                int i = dup_pairs[2 * k], owner = dup_pairs[2 * k + 1];
+                int linked = -1;
+                if (item_outputs[owner] >= expected_outputs)
+                    linked = link_duplicate_outputs(run, files[owner], files[i]);
+                if (linked >= 0) {
+                    outputs_written += linked;
+                    journal_completion(run, files[i], linked);
+                    continue;
+                }
+
+                dedup_unlink(dedup, i);
+                ProcItemResult r;
+                double t0 = wall_time();
+                if (process_one_image(run, files[i], -1, &r, fallback_budget) != 0)
+                    continue;
+
+                dedup_set_cost(dedup, i, wall_time() - t0);
+                total_pixels     += r.pixels;
+                images_processed += 1;
+                outputs_written  += r.outputs;
+                hough_votes      += r.hough_votes;
+                hough_sec        += r.hough_sec;
+                if (r.width  > max_w) max_w = r.width;
+                if (r.height > max_h) max_h = r.height;
+            }
+        }
+
+        // Stop timers and TSC
+        uint64_t c_end = read_tsc();
+        double   t_end = wall_time();
+        get_cpu_times(&user_after, &sys_after);
+        get_children_cpu_times(&child_user_after, &child_sys_after);
+        energy_end(&meter, &energy);
+
+        // Worker processes are reaped before this point, so their CPU time
+        // shows up in RUSAGE_CHILDREN
+        user_after += child_user_after - child_user_before;
+        sys_after  += child_sys_after  - child_sys_before;
+
+        if (dedup) {
+            DedupStats ds;
+            dedup_stats(dedup, &ds);
+            dedup_total.exact     += ds.exact;
+            dedup_total.near      += ds.near;
+            dedup_total.fallbacks += ds.fallbacks;
+            dedup_total.hash_sec  += ds.hash_sec;
+            dedup_total.saved_sec += ds.saved_sec;
+        }
+
+        wall_sum   += t_end - t_start;
+        user_sum   += user_after - user_before;
+        sys_sum    += sys_after - sys_before;
+        cycles_sum += c_end - c_start;
+
+        if (io_counters_read(&io_after) == 0 && io_before.available) {
+            metrics->io_read_bytes  += io_after.read_bytes  - io_before.read_bytes;
+            metrics->io_write_bytes += io_after.write_bytes - io_before.write_bytes;
+            metrics->io_rchar       += io_after.rchar       - io_before.rchar;
+        } else {
+            io_available = 0;
+        }
+    }
+    metrics->io_available = io_available;
+    energy_close(&meter);
+    free(deferred);
+    free(item_outputs);
+    free(dup_pairs);
+
+    metrics->limit_max_pixels    = run->limits.max_pixels;
+    metrics->limit_max_bytes     = run->limits.max_bytes;
+    metrics->budget_ms           = run->budget_sec * 1000.0;
+    metrics->defer_over_budget   = run->defer_over_budget;
+    metrics->limit_rejected      = limit_rejected;
+    metrics->over_budget         = over_budget;
+    metrics->over_budget_retried = retried;
+    metrics->max_image_ms        = max_image_ms;
+    metrics->dedup_exact         = dedup_total.exact;
+    metrics->dedup_near          = dedup_total.near;
+    metrics->dedup_fallbacks     = dedup_total.fallbacks;
+    metrics->dedup_hash_sec      = dedup_total.hash_sec;
+    metrics->dedup_saved_sec     = dedup_total.saved_sec;
+
+    CacheStats cache_after;
+    image_cache_stats(run->cache, &cache_after);
+    metrics->cache_hits       = cache_after.hits - cache_before.hits;
+    metrics->cache_misses     = cache_after.misses - cache_before.misses;
+    metrics->cache_evictions  = cache_after.evictions - cache_before.evictions;
+    metrics->cache_decode_sec = cache_after.decode_sec - cache_before.decode_sec;
+    metrics->cache_saved_decode_sec =
+        cache_after.saved_decode_sec - cache_before.saved_decode_sec;
 
     metrics->images_processed    = images_processed;
     metrics->total_pixels        = total_pixels;
     metrics->max_width           = max_w;
     metrics->max_height          = max_h;
-    metrics->wall_time_sec       = t_end - t_start;
-    metrics->cpu_user_time_sec   = user_after - user_before;
-    metrics->cpu_system_time_sec = sys_after - sys_before;
-    metrics->cpu_cycles          = c_end - c_start;  // TSC delta (wall-clock based)
+    metrics->outputs_written     = outputs_written;
+    metrics->hough_votes         = hough_votes;
+    metrics->hough_vote_sec      = hough_sec;
+    metrics->hough_votes_per_sec =
+        wall_sum > 0.0 ? (double)hough_votes / wall_sum : 0.0;
+    metrics->wall_time_sec       = wall_sum;
+    metrics->cpu_user_time_sec   = user_sum;
+    metrics->cpu_system_time_sec = sys_sum;
+    metrics->cpu_cycles          = cycles_sum;  // TSC delta (wall-clock based)
 
     if (metrics->images_processed > 0) {
         metrics->avg_time_per_image_ms =
@@ -494,7 +1323,7 @@ static void process_directory_parallel(const char *input_dir,
         metrics->cycles_per_pixel      = 0.0;
     }
 
-    // 4) DERIVE "PERF-LIKE" TOTAL CYCLES ACROSS ALL THREADS
+    // DERIVE "PERF-LIKE" TOTAL CYCLES ACROSS ALL THREADS
     //
     // estimated_total_cycles_all_threads
     //   ≈ cpu_cycles_TSC * (cpu_total_time_sec / wall_time_sec)
@@ -530,21 +1359,364 @@ static void process_directory_parallel(const char *input_dir,
         metrics->estimated_cycles_per_pixel_all_threads = 0.0;
     }
 
-    for (int i = 0; i < file_count; ++i) {
-        free(files[i]);
+    // Energy per unit of work and energy-delay product (lower is better)
+    if (energy.available) {
+        metrics->energy_available     = 1;
+        metrics->energy_package_j     = energy.package_j;
+        metrics->energy_dram_j        = energy.dram_j;
+        metrics->energy_total_j       = energy.total_j;
+        metrics->energy_delay_product = energy.total_j * metrics->wall_time_sec;
+        if (metrics->wall_time_sec > 0.0)
+            metrics->avg_power_w = energy.total_j / metrics->wall_time_sec;
+        if (metrics->images_processed > 0)
+            metrics->joules_per_image = energy.total_j / metrics->images_processed;
+        if (metrics->total_pixels > 0)
+            metrics->joules_per_megapixel =
+                energy.total_j * 1e6 / (double)metrics->total_pixels;
+    }
+
+}
+
+/* --- autotuning: benchmark trials on a sample of the input --- */
+
+typedef struct {
+    RunConfig   run;
+    char      **files;
+    int         file_count;
+} TuneContext;
+
+static double tune_trial(const TuneProfile *p, void *ctx) {
+    const TuneContext *tc = (const TuneContext *)ctx;
+    Metrics m;
+    process_file_list(&tc->run, tc->files, tc->file_count, p, &m);
+    if (m.images_processed == 0) return -1.0;
+    return m.wall_time_sec;
+}
+
+/*
+ * Search the tuning space on an evenly spaced sample of up to
+ * sample_size files and persist the winner for this host.
+ */
+static void autotune_profile(const Options *opt, const RunConfig *run,
+                             char **files, int file_count, int max_threads,
+                             TuneProfile *prof) {
+    int n = opt->tune_sample;
+    if (n < 1 || n > file_count) n = file_count;
+
+    char **sample = (char **)malloc(n * sizeof(char *));
+    if (!sample) {
+        fprintf(stderr, "[parallel] Out of memory for autotune sample\n");
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        sample[i] = files[(long long)i * file_count / n];
+    }
+
+    printf("[parallel] Autotuning on %d of %d images\n", n, file_count);
+
+    TuneContext tc = { *run, sample, n };
+    tc.run.repeats = 1;
+    tc.run.journal = NULL;   // trials are not real progress
+    tc.run.prefetch = NULL;
+    tc.run.page_cache = PAGE_CACHE_NONE;
+    tc.run.dedup = NULL;     // the sample is timed in full
+    double best = tune_search(tune_trial, &tc, max_threads, 2, prof);
+    if (best >= 0.0)
+        tune_save_profile(PROFILE_DIR, prof, best);
+
+    free(sample);
+}
+
+/*
+ * Main parallel processing function.
+ * - Collects file names
+ * - Picks the OpenMP configuration (default, saved profile or autotune)
+ * - Processes all files and fills in metrics
+ */
+static void process_directory_parallel(const Options *opt, Metrics *metrics) {
+    memset(metrics, 0, sizeof(*metrics));
+
+    Pipeline *dag = NULL;
+    if (opt->dag_spec) {
+        dag = pipeline_parse(opt->dag_spec);
+        if (!dag) {
+            fprintf(stderr, "[parallel] Invalid --dag spec: %s\n", opt->dag_spec);
+            return;
+        }
+        pipeline_print(dag);
+        pipeline_prepare_outputs(dag);
+    } else {
+        ensure_directory(opt->output_dir);
+    }
+
+    char **files = NULL;
+    int file_count = collect_image_files(opt->input_dir, &files);
+    if (file_count == 0) {
+        printf("[parallel] No images found in %s\n", opt->input_dir);
+        free(files);
+        pipeline_free(dag);
+        return;
+    }
+
+    RunConfig run;
+    run.input_dir  = opt->input_dir;
+    run.output_dir = opt->output_dir;
+    run.dag        = dag;
+    run.cache      = NULL;
+    run.repeats    = opt->repeats;
+    run.sample_type = opt->sample_type;
+    run.procs      = opt->procs;
+    run.journal    = NULL;
+    run.prefetch   = NULL;
+    run.page_cache = opt->page_cache;
+    run.limits     = opt->limits;
+    run.budget_sec = opt->budget_ms / 1000.0;
+    run.defer_over_budget = opt->defer_over_budget;
+    run.dedup      = NULL;
+
+    CpuBudget budget;
+    cpu_budget_detect(&budget);
+    printf("[parallel] CPU budget: %d (online %d, affinity %d, quota %.2f; %s)\n",
+           budget.effective_cpus, budget.online_cpus, budget.affinity_cpus,
+           budget.quota_cpus, budget.source);
+    if (run.procs < 0)
+        run.procs = budget.effective_cpus;   // --procs auto
+
+    // Open the journal; on --resume drop inputs that are already done
+    int resume_skipped = 0;
+    if (opt->journal_path) {
+        char config_key[1024];
+        snprintf(config_key, sizeof(config_key), "input=%s output=%s dag=%s depth=%s",
+                 opt->input_dir, opt->output_dir,
+                 opt->dag_spec ? opt->dag_spec : "-",
+                 sample_type_name(opt->sample_type));
+        run.journal = journal_open(opt->journal_path, config_key, opt->resume, 0);
+        if (!run.journal)
+            fprintf(stderr, "[parallel] Could not open journal %s\n",
+                    opt->journal_path);
+    }
+    if (run.journal && opt->resume) {
+        int kept = 0;
+        for (int i = 0; i < file_count; ++i) {
+            long long recorded;
+            if (journal_lookup(run.journal, files[i], &recorded) &&
+                output_bytes(&run, files[i]) == recorded) {
+                free(files[i]);
+                resume_skipped++;
+            } else {
+                files[kept++] = files[i];
+            }
+        }
+        printf("[parallel] Resume: %d of %d inputs already done (%d journal records)\n",
+               resume_skipped, file_count, journal_loaded(run.journal));
+        file_count = kept;
+    }
+
+    size_t cache_budget = (size_t)opt->cache_mb * 1024 * 1024;
+    if (cache_budget > 0) {
+        run.cache = image_cache_create(cache_budget, 16);
+        if (!run.cache)
+            fprintf(stderr, "[parallel] Could not create image cache\n");
+    }
+
+    // Sort by disk placement, then keep a readahead window in that order
+    int order_fallbacks = order_files(opt->input_dir, files, file_count, opt->order);
+    int window = opt->prefetch;
+    if (window < 0)
+        window = (opt->order == ORDER_INODE || opt->order == ORDER_EXTENT) ? 32 : 0;
+    if (run.procs > 0)
+        window = 0;   // workers have no shared view of progress
+    Prefetcher prefetcher;
+    if (window > 0) {
+        prefetch_start(&prefetcher, opt->input_dir, files, file_count, window);
+        run.prefetch = &prefetcher;
+    }
+    if (opt->order != ORDER_READDIR)
+        printf("[parallel] Input order: %s (%d fallbacks), prefetch window %d\n",
+               file_order_name(opt->order), order_fallbacks, window);
+
+    // Built after ordering: owners are the earliest copies in that order
+    if (opt->dedup != DEDUP_OFF && run.procs > 0) {
+        fprintf(stderr, "[parallel] --dedup needs a shared index; "
+                        "ignored with --procs\n");
+    } else if (opt->dedup != DEDUP_OFF) {
+        run.dedup = dedup_create(opt->input_dir, files, file_count,
+                                 opt->dedup, opt->dedup_distance);
+        if (!run.dedup)
+            fprintf(stderr, "[parallel] Could not create dedup index\n");
+    }
+
+    // An explicit OMP_NUM_THREADS wins; otherwise size to the budget
+    TuneProfile prof;
+    prof.threads  = getenv("OMP_NUM_THREADS") ? omp_get_max_threads()
+                                              : budget.effective_cpus;
+    prof.schedule = omp_sched_static;
+    prof.chunk    = 0;
+    const char *source = "default";
+
+    if (opt->autotune && run.procs > 0) {
+        fprintf(stderr, "[parallel] --autotune tunes OpenMP threads; "
+                        "ignored with --procs\n");
+    } else if (opt->autotune) {
+        autotune_profile(opt, &run, files, file_count, budget.effective_cpus, &prof);
+        source = "autotune";
+    } else if (opt->use_profile && tune_load_profile(PROFILE_DIR, &prof)) {
+        printf("[parallel] Using saved profile: threads=%d schedule=%s chunk=%d\n",
+               prof.threads, tune_schedule_name(prof.schedule), prof.chunk);
+        if (prof.threads > budget.effective_cpus && !getenv("OMP_NUM_THREADS")) {
+            printf("[parallel] Profile threads capped to CPU budget %d\n",
+                   budget.effective_cpus);
+            prof.threads = budget.effective_cpus;
+        }
+        source = "profile";
+    }
+
+    CpuThrottleStats thr_before, thr_after;
+    cpu_throttle_read(&budget, &thr_before);
+
+    process_file_list(&run, files, file_count, &prof, metrics);
+
+    if (cpu_throttle_read(&budget, &thr_after) == 0 && thr_before.available) {
+        metrics->throttle_available = 1;
+        metrics->throttle_periods   = thr_after.nr_periods - thr_before.nr_periods;
+        metrics->throttled_periods  = thr_after.nr_throttled - thr_before.nr_throttled;
+        metrics->throttled_sec      = thr_after.throttled_sec - thr_before.throttled_sec;
+    }
+    metrics->cpu_online        = budget.online_cpus;
+    metrics->cpu_affinity      = budget.affinity_cpus;
+    metrics->cpu_quota         = budget.quota_cpus;
+    metrics->cpu_budget        = budget.effective_cpus;
+    metrics->cpu_budget_source = budget.source;
+    metrics->file_order        = opt->order;
+    metrics->order_fallbacks   = order_fallbacks;
+    metrics->prefetch_window   = window;
+    metrics->prefetch_advised  = run.prefetch ? prefetcher.advised : 0;
+    metrics->profile_source = source;
+    metrics->resumed        = opt->resume && run.journal != NULL;
+    metrics->resume_skipped = resume_skipped;
+    metrics->dedup_mode     = run.dedup ? opt->dedup : DEDUP_OFF;
+    metrics->dedup_max_distance =
+        (run.dedup && opt->dedup == DEDUP_NEAR) ? opt->dedup_distance : 0;
+    if (run.cache)
+        metrics->cache_budget_bytes = (long long)cache_budget;
+    if (dag) {
+        metrics->dag_sinks = dag->n_sinks;
+        metrics->dag_nodes = dag->n_nodes;
+    }
+
+    dedup_destroy(run.dedup);
+    free_file_list(files, file_count);
+    image_cache_destroy(run.cache);
+    journal_close(run.journal);
+    pipeline_free(dag);
+}
+
+static void parse_options(int argc, char **argv, Options *opt) {
+    opt->input_dir   = "data/input";
+    opt->output_dir  = "data/output_parallel";
+    opt->autotune    = 0;
+    opt->tune_sample = 8;
+    opt->use_profile = 1;
+    opt->dag_spec    = NULL;
+    opt->repeats     = 1;
+    opt->cache_mb    = 0;
+    opt->sample_type = SAMPLE_U8;
+    opt->procs       = 0;
+    opt->journal_path = JOURNAL_PATH;
+    opt->resume      = 0;
+    opt->order       = ORDER_READDIR;
+    opt->prefetch    = -1;
+    opt->page_cache  = PAGE_CACHE_NONE;
+    opt->limits.max_pixels = DEFAULT_MAX_PIXELS;
+    opt->limits.max_bytes  = (long long)DEFAULT_MAX_MB * 1024 * 1024;
+    opt->budget_ms   = 0.0;
+    opt->defer_over_budget = 1;
+    opt->dedup       = DEDUP_OFF;
+    opt->dedup_distance = 6;
+
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--autotune") == 0) {
+            opt->autotune = 1;
+        } else if (strcmp(argv[i], "--tune-sample") == 0 && i + 1 < argc) {
+            opt->tune_sample = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-profile") == 0) {
+            opt->use_profile = 0;
+        } else if (strcmp(argv[i], "--dag") == 0 && i + 1 < argc) {
+            opt->dag_spec = argv[++i];
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            opt->repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc) {
+            opt->cache_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            if (parse_sample_type(argv[++i], &opt->sample_type) != 0)
+                fprintf(stderr, "[parallel] Unknown --depth %s (u8|u16|f32)\n",
+                        argv[i]);
+        } else if (strcmp(argv[i], "--procs") == 0 && i + 1 < argc) {
+            ++i;
+            opt->procs = (strcmp(argv[i], "auto") == 0) ? -1 : atoi(argv[i]);
+            if (opt->procs < -1) opt->procs = 0;
+        } else if (strcmp(argv[i], "--order") == 0 && i + 1 < argc) {
+            if (parse_file_order(argv[++i], &opt->order) != 0)
+                fprintf(stderr, "[parallel] Unknown --order %s "
+                                "(readdir|name|inode|extent)\n", argv[i]);
+        } else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc) {
+            opt->prefetch = atoi(argv[++i]);
+            if (opt->prefetch < 0) opt->prefetch = 0;
+        } else if (strcmp(argv[i], "--page-cache") == 0 && i + 1 < argc) {
+            if (parse_page_cache_mode(argv[++i], &opt->page_cache) != 0)
+                fprintf(stderr, "[parallel] Unknown --page-cache %s "
+                                "(none|warm|cold)\n", argv[i]);
+        } else if (strcmp(argv[i], "--max-pixels") == 0 && i + 1 < argc) {
+            opt->limits.max_pixels = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--max-mb") == 0 && i + 1 < argc) {
+            opt->limits.max_bytes = atoll(argv[++i]) * 1024 * 1024;
+        } else if (strcmp(argv[i], "--budget-ms") == 0 && i + 1 < argc) {
+            opt->budget_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--over-budget") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "defer") == 0)     opt->defer_over_budget = 1;
+            else if (strcmp(argv[i], "skip") == 0) opt->defer_over_budget = 0;
+            else fprintf(stderr, "[parallel] Unknown --over-budget %s "
+                                 "(defer|skip)\n", argv[i]);
+        } else if (strcmp(argv[i], "--dedup") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "off") == 0)        opt->dedup = DEDUP_OFF;
+            else if (strcmp(argv[i], "exact") == 0) opt->dedup = DEDUP_EXACT;
+            else if (strcmp(argv[i], "near") == 0)  opt->dedup = DEDUP_NEAR;
+            else fprintf(stderr, "[parallel] Unknown --dedup %s "
+                                 "(off|exact|near)\n", argv[i]);
+        } else if (strcmp(argv[i], "--dedup-distance") == 0 && i + 1 < argc) {
+            opt->dedup_distance = atoi(argv[++i]);
+            if (opt->dedup_distance < 0) opt->dedup_distance = 0;
+            if (opt->dedup_distance > 7) opt->dedup_distance = 7;
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            opt->resume = 1;
+        } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            opt->journal_path = argv[++i];
+        } else if (strcmp(argv[i], "--no-journal") == 0) {
+            opt->journal_path = NULL;
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            fprintf(stderr, "[parallel] Unknown option: %s\n", argv[i]);
+        } else if (positional == 0) {
+            opt->input_dir = argv[i];
+            positional++;
+        } else if (positional == 1) {
+            opt->output_dir = argv[i];
+            positional++;
+        }
     }
-    free(files);
 }
 
 int main(int argc, char **argv) {
-    const char *input_dir  = "data/input";
-    const char *output_dir = "data/output_parallel";
+    Options opt;
+    parse_options(argc, argv, &opt);
 
-    if (argc >= 2) input_dir  = argv[1];
-    if (argc >= 3) output_dir = argv[2];
+    const char *input_dir  = opt.input_dir;
+    const char *output_dir = opt.output_dir;
 
     Metrics pm;
-    process_directory_parallel(input_dir, output_dir, &pm);
+    process_directory_parallel(&opt, &pm);
 
     printf("[parallel] Images processed : %d\n", pm.images_processed);
     printf("[parallel] Total pixels     : %lld\n", pm.total_pixels);
@@ -555,7 +1727,37 @@ int main(int argc, char **argv) {
            (unsigned long long)pm.cpu_cycles);
     printf("[parallel] Est. total cycles (all threads, perf-like) : %llu\n",
            (unsigned long long)pm.estimated_total_cycles_all_threads);
-    printf("[parallel] Threads used     : %d\n", pm.threads_used);
+    if (pm.throttle_available)
+        printf("[parallel] CFS throttling   : %lld of %lld periods, %.6f s\n",
+               pm.throttled_periods, pm.throttle_periods, pm.throttled_sec);
+    if (pm.procs > 0)
+        printf("[parallel] Worker processes : %d (%d restarts, %d poison files)\n",
+               pm.procs, pm.worker_restarts, pm.poison_count);
+    else
+        printf("[parallel] Threads used     : %d\n", pm.threads_used);
+    printf("[parallel] Sample type      : %s\n", sample_type_name(pm.sample_type));
+    printf("[parallel] Schedule         : %s, chunk %d (%s)\n",
+           tune_schedule_name(pm.schedule_kind), pm.chunk_size,
+           pm.profile_source ? pm.profile_source : "default");
+    printf("[parallel] Page cache       : %s, %lld bytes read from storage\n",
+           page_cache_mode_name(pm.page_cache), pm.io_read_bytes);
+    if (pm.energy_available)
+        printf("[parallel] Energy           : %.3f J (%.6f J/image, %.1f W)\n",
+               pm.energy_total_j, pm.joules_per_image, pm.avg_power_w);
+    else
+        printf("[parallel] Energy           : unavailable\n");
+    if (pm.limit_rejected > 0 || pm.budget_ms > 0.0)
+        printf("[parallel] Guards           : %d over decode limits, %d over "
+               "%.1f ms budget (%d retried), slowest image %.3f ms\n",
+               pm.limit_rejected, pm.over_budget, pm.budget_ms,
+               pm.over_budget_retried, pm.max_image_ms);
+    if (pm.cache_budget_bytes > 0)
+        printf("[parallel] Image cache      : %lld hits, %lld misses, "
+               "%.6f s decode saved\n",
+               pm.cache_hits, pm.cache_misses, pm.cache_saved_decode_sec);
+    if (pm.hough_votes > 0)
+        printf("[parallel] Hough votes      : %lld (%.3e votes/s, %.6f s voting)\n",
+               pm.hough_votes, pm.hough_votes_per_sec, pm.hough_vote_sec);
 
     write_parallel_metrics_json("results/logs/parallel_metrics.json",
                                 &pm, input_dir, output_dir);
@@ -591,6 +1793,21 @@ int main(int argc, char **argv) {
             cmp.parallel_efficiency =
                 cmp.speedup_wall_time / (double)pm.threads_used;
 
+        // Energy is compared per image, so differing image counts
+        // (e.g. --repeat) do not skew it; EDP per image likewise
+        if (sm.energy_available && pm.energy_available &&
+            sm.joules_per_image > 0.0 && pm.joules_per_image > 0.0) {
+            cmp.energy_ratio = pm.joules_per_image / sm.joules_per_image;
+            if (sm.images_processed > 0 && pm.images_processed > 0 &&
+                sm.energy_delay_product > 0.0) {
+                double s_edp = sm.energy_delay_product /
+                               ((double)sm.images_processed * sm.images_processed);
+                double p_edp = pm.energy_delay_product /
+                               ((double)pm.images_processed * pm.images_processed);
+                cmp.edp_ratio = p_edp / s_edp;
+            }
+        }
+
         // Also compute perf-like total cycles for serial & parallel
         double serial_cpu_time =
             sm.cpu_user_time_sec + sm.cpu_system_time_sec;
@@ -625,5 +1842,9 @@ int main(int argc, char **argv) {
                 "Run ./bin/serial first for comparison.\n");
     }
 
+    for (int i = 0; i < pm.poison_count; ++i)
+        free(pm.poison_files[i]);
+    free(pm.poison_files);
+    free(pm.per_worker);
     return 0;
 }
@@ -0,0 +1,524 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <mpi.h>
+#include <omp.h>
+#include <strings.h>
+
+#include "filters.h"
+#include "timer.h"
+#include "cpubudget.h"
+#include "jsonout.h"
+
+/*
+ * MPI-DISTRIBUTED BATCH MODE
+ * --------------------------
+ *
+ *   mpirun -np 4 ./bin/parallel_mpi [input_dir] [output_dir] [--batch N]
+ *
+ * Rank 0 is the coordinator; ranks 1..N-1 are workers:
+ *
+ *   1) Rank 0 scans input_dir and estimates each file's cost from its
+ *      header (width * height via image_info, file size as fallback).
+ *   2) Files are sorted by decreasing cost (longest-processing-time
+ *      first), so the expensive images start early and the tail of the
+ *      run is made of cheap ones.
+ *   3) Workers pull work dynamically: each sends a REQUEST, rank 0 replies
+ *      with the next batch of file names (or STOP). A slow rank simply
+ *      asks less often, so skew does not leave other ranks idle.
+ *   4) Every worker runs the batch with the same OpenMP loop as
+ *      bin/parallel (schedule(dynamic, 1) inside the batch).
+ *   5) Rank 0 works too. Its master thread answers requests (and makes
+ *      every MPI call, so MPI_THREAD_FUNNELED is enough); a second
+ *      thread takes batches from the same list and runs them on the
+ *      rank's other cores. The coordinator keeps one core, because
+ *      MPI_Recv typically polls rather than sleeps.
+ *   6) Per-rank metrics are gathered on rank 0 and written, together
+ *      with cluster-wide totals, to results/logs/mpi_metrics.json.
+ *
+ * Input and output directories must be visible to all ranks (shared
+ * filesystem, or the same local directories when testing on one box).
+ * With a single rank, rank 0 processes everything itself.
+ */
+
+#define TAG_REQUEST 1
+#define TAG_WORK    2
+#define TAG_STOP    3
+
+typedef struct {
+    int       rank;
+    int       threads;
+    int       batches;
+    int       images_processed;
+    long long total_pixels;
+    double    wall_time_sec;      // from start barrier to last batch done
+    double    busy_time_sec;      // time spent inside batches
+    double    cpu_user_time_sec;
+    double    cpu_system_time_sec;
+    int       max_width;
+    int       max_height;
+    char      host[64];
+} RankMetrics;
+
+typedef struct {
+    char     *name;
+    long long cost;
+} WorkItem;
+
+/* Sorted file list, shared by the coordinator and rank 0's own worker. */
+typedef struct {
+    WorkItem  *items;
+    int        count;
+    int        next;     // first item not handed out yet
+    omp_lock_t lock;
+} WorkQueue;
+
+static int ends_with(const char *name, const char *ext) {
+    size_t ln = strlen(name);
+    size_t le = strlen(ext);
+    if (ln < le) return 0;
+    return strcasecmp(name + ln - le, ext) == 0;
+}
+
+static int is_image_file(const char *name) {
+    return ends_with(name, ".png")  ||
+           ends_with(name, ".jpg")  ||
+           ends_with(name, ".jpeg") ||
+           ends_with(name, ".bmp");
+}
+
+static void ensure_directory(const char *path) {
+    if (!path) return;
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return;
+        fprintf(stderr, "[mpi] %s exists but is not a directory!\n", path);
+        return;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror("[mpi] mkdir");
+    }
+}
+
+static int cmp_cost_desc(const void *a, const void *b) {
+    const WorkItem *x = (const WorkItem *)a;
+    const WorkItem *y = (const WorkItem *)b;
+    if (x->cost != y->cost) return (x->cost < y->cost) ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+/*
+ * Rank 0: collect image files and their estimated cost, most expensive
+ * first. Returns the number of items.
+ */
+static int scan_work(const char *input_dir, WorkItem **out) {
+    *out = NULL;
+
+    DIR *dir = opendir(input_dir);
+    if (!dir) {
+        perror("[mpi] opendir input_dir");
+        return 0;
+    }
+
+    WorkItem *items = NULL;
+    int count = 0;
+    int capacity = 0;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+            continue;
+        if (!is_image_file(ent->d_name))
+            continue;
+
+        if (count == capacity) {
+            capacity = (capacity == 0) ? 16 : capacity * 2;
+            items = (WorkItem *)realloc(items, capacity * sizeof(WorkItem));
+        }
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", input_dir, ent->d_name);
+
+        long long cost = 0;
+        int w, h;
+        struct stat st;
+        if (image_info(path, &w, &h) == 0)
+            cost = (long long)w * h;
+        else if (stat(path, &st) == 0)
+            cost = (long long)st.st_size;
+
+        items[count].name = strdup(ent->d_name);
+        items[count].cost = cost;
+        count++;
+    }
+    closedir(dir);
+
+    qsort(items, count, sizeof(WorkItem), cmp_cost_desc);
+    *out = items;
+    return count;
+}
+
+/*
+ * Process one batch of file names with the usual OpenMP loop and
+ * accumulate into *m.
+ */
+static void process_batch(const char *input_dir, const char *output_dir,
+                          char **names, int n, RankMetrics *m) {
+    double t0 = wall_time();
+
+    long long total_pixels = 0;
+    int images_processed = 0;
+    int max_w = m->max_width, max_h = m->max_height;
+
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:total_pixels,images_processed) reduction(max:max_w,max_h)
+    for (int i = 0; i < n; ++i) {
+        char in_path[512];
+        char out_path[512];
+        snprintf(in_path, sizeof(in_path), "%s/%s", input_dir, names[i]);
+        snprintf(out_path, sizeof(out_path), "%s/%s", output_dir, names[i]);
+
+        Image *img = load_image(in_path);
+        if (!img) {
+            fprintf(stderr, "[mpi] Skip failed load: %s\n", in_path);
+            continue;
+        }
+
+        total_pixels     += (long long)img->width * img->height;
+        images_processed += 1;
+        if (img->width  > max_w) max_w = img->width;
+        if (img->height > max_h) max_h = img->height;
+
+        apply_grayscale(img);
+        apply_box_blur(img, 2);
+        apply_sobel_edge(img);
+
+        if (save_image_png(out_path, img) != 0) {
+            fprintf(stderr, "[mpi] Failed to save %s\n", out_path);
+        }
+
+        free_image(img);
+    }
+
+    m->total_pixels     += total_pixels;
+    m->images_processed += images_processed;
+    m->max_width         = max_w;
+    m->max_height        = max_h;
+    m->batches          += 1;
+    m->busy_time_sec    += wall_time() - t0;
+}
+
+/* Pack names[0..n) as consecutive NUL-terminated strings. */
+static int pack_names(WorkItem *items, int first, int n, char *buf, int cap) {
+    int len = 0;
+    for (int i = 0; i < n; ++i) {
+        int l = (int)strlen(items[first + i].name) + 1;
+        if (len + l > cap) break;
+        memcpy(buf + len, items[first + i].name, l);
+        len += l;
+    }
+    return len;
+}
+
+static int unpack_names(char *buf, int len, char **names, int max) {
+    int n = 0;
+    for (int off = 0; off < len && n < max; ) {
+        names[n++] = buf + off;
+        off += (int)strlen(buf + off) + 1;
+    }
+    return n;
+}
+
+#define MSG_CAP (64 * 1024)
+
+static void run_coordinator(WorkQueue *q, int batch, int nranks) {
+    char *buf = (char *)malloc(MSG_CAP);
+    int active = nranks - 1;
+
+    while (active > 0) {
+        int want;
+        MPI_Status st;
+        MPI_Recv(&want, 1, MPI_INT, MPI_ANY_SOURCE, TAG_REQUEST,
+                 MPI_COMM_WORLD, &st);
+
+        int n = (batch > 0) ? batch : want;
+        if (n < 1) n = 1;
+
+        // pack_names may stop early if the message would overflow
+        int len = 0;
+        omp_set_lock(&q->lock);
+        while (q->next < q->count) {
+            if (n > q->count - q->next) n = q->count - q->next;
+            len = pack_names(q->items, q->next, n, buf, MSG_CAP);
+            int sent = 0;
+            for (int off = 0; off < len; off += (int)strlen(buf + off) + 1) sent++;
+            if (sent > 0) {
+                q->next += sent;
+                break;
+            }
+            fprintf(stderr, "[mpi] File name too long, skipping: %s\n",
+                    q->items[q->next].name);
+            q->next++;
+        }
+        omp_unset_lock(&q->lock);
+
+        if (len == 0) {
+            MPI_Send(NULL, 0, MPI_CHAR, st.MPI_SOURCE, TAG_STOP, MPI_COMM_WORLD);
+            active--;
+            continue;
+        }
+        MPI_Send(buf, len, MPI_CHAR, st.MPI_SOURCE, TAG_WORK, MPI_COMM_WORLD);
+    }
+
+    free(buf);
+}
+
+/* Rank 0's worker: batches straight from the queue, no messages. */
+static void run_local_worker(WorkQueue *q, int batch, const char *input_dir,
+                             const char *output_dir, RankMetrics *m) {
+    int want = (batch > 0) ? batch : m->threads;
+    char **names = (char **)malloc((size_t)want * sizeof(char *));
+    if (!names) return;
+
+    for (;;) {
+        omp_set_lock(&q->lock);
+        int first = q->next;
+        int n = q->count - first;
+        if (n > want) n = want;
+        q->next += n;
+        omp_unset_lock(&q->lock);
+        if (n <= 0) break;
+
+        for (int i = 0; i < n; ++i) names[i] = q->items[first + i].name;
+        process_batch(input_dir, output_dir, names, n, m);
+    }
+
+    free(names);
+}
+
+static void run_worker(const char *input_dir, const char *output_dir,
+                       RankMetrics *m) {
+    char *buf = (char *)malloc(MSG_CAP);
+    char **names = (char **)malloc(MSG_CAP * sizeof(char *) / 2);
+    int want = m->threads;
+
+    for (;;) {
+        MPI_Send(&want, 1, MPI_INT, 0, TAG_REQUEST, MPI_COMM_WORLD);
+
+        MPI_Status st;
+        MPI_Recv(buf, MSG_CAP, MPI_CHAR, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &st);
+        if (st.MPI_TAG == TAG_STOP) break;
+
+        int len;
+        MPI_Get_count(&st, MPI_CHAR, &len);
+        int n = unpack_names(buf, len, names, MSG_CAP / 2);
+        process_batch(input_dir, output_dir, names, n, m);
+    }
+
+    free(names);
+    free(buf);
+}
+
+static void write_mpi_metrics_json(const char *json_path,
+                                   const RankMetrics *ranks, int nranks,
+                                   double cluster_wall,
+                                   const char *input_dir,
+                                   const char *output_dir) {
+    ensure_directory("results");
+    ensure_directory("results/logs");
+
+    FILE *f = fopen(json_path, "w");
+    if (!f) {
+        perror("[mpi] fopen metrics json");
+        return;
+    }
+
+    long long pixels = 0;
+    int images = 0, threads = 0, max_w = 0, max_h = 0;
+    double cpu_user = 0.0, cpu_sys = 0.0, busy = 0.0;
+    for (int r = 0; r < nranks; ++r) {
+        pixels   += ranks[r].total_pixels;
+        images   += ranks[r].images_processed;
+        threads  += ranks[r].threads;
+        cpu_user += ranks[r].cpu_user_time_sec;
+        cpu_sys  += ranks[r].cpu_system_time_sec;
+        busy     += ranks[r].busy_time_sec;
+        if (ranks[r].max_width  > max_w) max_w = ranks[r].max_width;
+        if (ranks[r].max_height > max_h) max_h = ranks[r].max_height;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"variant\": \"mpi\",\n");
+    fprintf(f, "  \"input_dir\": ");
+    write_json_string(f, input_dir);
+    fprintf(f, ",\n  \"output_dir\": ");
+    write_json_string(f, output_dir);
+    fprintf(f, ",\n");
+    fprintf(f, "  \"metrics\": {\n");
+    fprintf(f, "    \"ranks\": %d,\n", nranks);
+    fprintf(f, "    \"images_processed\": %d,\n", images);
+    fprintf(f, "    \"total_pixels\": %lld,\n", pixels);
+    fprintf(f, "    \"wall_time_sec\": %.9f,\n", cluster_wall);
+    fprintf(f, "    \"cpu_user_time_sec\": %.9f,\n", cpu_user);
+    fprintf(f, "    \"cpu_system_time_sec\": %.9f,\n", cpu_sys);
+    fprintf(f, "    \"avg_time_per_image_ms\": %.6f,\n",
+            images > 0 ? cluster_wall * 1000.0 / images : 0.0);
+    fprintf(f, "    \"avg_time_per_pixel_ns\": %.6f,\n",
+            pixels > 0 ? cluster_wall * 1e9 / (double)pixels : 0.0);
+    fprintf(f, "    \"pixels_per_sec\": %.3f,\n",
+            cluster_wall > 0.0 ? (double)pixels / cluster_wall : 0.0);
+    fprintf(f, "    \"busy_time_sec_all_ranks\": %.9f,\n", busy);
+    fprintf(f, "    \"max_width\": %d,\n", max_w);
+    fprintf(f, "    \"max_height\": %d,\n", max_h);
+    fprintf(f, "    \"threads_used\": %d\n", threads);
+    fprintf(f, "  },\n");
+
+    fprintf(f, "  \"per_rank\": [\n");
+    for (int r = 0; r < nranks; ++r) {
+        const RankMetrics *m = &ranks[r];
+        fprintf(f, "    {\n");
+        fprintf(f, "      \"rank\": %d,\n", m->rank);
+        fprintf(f, "      \"host\": ");
+        write_json_string(f, m->host);
+        fprintf(f, ",\n");
+        fprintf(f, "      \"threads\": %d,\n", m->threads);
+        fprintf(f, "      \"batches\": %d,\n", m->batches);
+        fprintf(f, "      \"images_processed\": %d,\n", m->images_processed);
+        fprintf(f, "      \"total_pixels\": %lld,\n", m->total_pixels);
+        fprintf(f, "      \"wall_time_sec\": %.9f,\n", m->wall_time_sec);
+        fprintf(f, "      \"busy_time_sec\": %.9f,\n", m->busy_time_sec);
+        fprintf(f, "      \"utilization\": %.6f,\n",
+                cluster_wall > 0.0 ? m->busy_time_sec / cluster_wall : 0.0);
+        fprintf(f, "      \"cpu_user_time_sec\": %.9f,\n", m->cpu_user_time_sec);
+        fprintf(f, "      \"cpu_system_time_sec\": %.9f\n", m->cpu_system_time_sec);
+        fprintf(f, "    }%s\n", (r + 1 < nranks) ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+    printf("[mpi] Metrics written to %s\n", json_path);
+}
+
+int main(int argc, char **argv) {
+    int thread_level = MPI_THREAD_SINGLE;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_level);
+
+    int rank, nranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+
+    const char *input_dir  = "data/input";
+    const char *output_dir = "data/output_mpi";
+    int batch = 0;   // 0 = one file per worker thread per request
+
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch = atoi(argv[++i]);
+        } else if (positional == 0) {
+            input_dir = argv[i];
+            positional++;
+        } else if (positional == 1) {
+            output_dir = argv[i];
+            positional++;
+        }
+    }
+
+    RankMetrics m;
+    memset(&m, 0, sizeof(m));
+    m.rank    = rank;
+    // Size each rank to its affinity mask and cgroup quota unless
+    // OMP_NUM_THREADS says otherwise (mpirun binding narrows the mask)
+    if (!getenv("OMP_NUM_THREADS")) {
+        CpuBudget budget;
+        cpu_budget_detect(&budget);
+        omp_set_num_threads(budget.effective_cpus);
+    }
+    m.threads = omp_get_max_threads();
+    gethostname(m.host, sizeof(m.host) - 1);
+
+    WorkItem *items = NULL;
+    int count = 0;
+    if (rank == 0) {
+        ensure_directory(output_dir);
+        count = scan_work(input_dir, &items);
+        printf("[mpi] %d ranks, %d images in %s\n", nranks, count, input_dir);
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    double user_before, sys_before, user_after, sys_after;
+    get_cpu_times(&user_before, &sys_before);
+    double t_start = wall_time();
+
+    if (nranks == 1) {
+        char **names = (char **)malloc((count > 0 ? count : 1) * sizeof(char *));
+        for (int i = 0; i < count; ++i) names[i] = items[i].name;
+        process_batch(input_dir, output_dir, names, count, &m);
+        free(names);
+    } else if (rank == 0) {
+        WorkQueue q = { items, count, 0 };
+        omp_init_lock(&q.lock);
+        // one core stays with the coordinator, the rest work
+        int local = (thread_level >= MPI_THREAD_FUNNELED) ? m.threads - 1 : 0;
+        m.threads = local;
+        if (local < 1) {
+            run_coordinator(&q, batch, nranks);
+        } else {
+            omp_set_max_active_levels(2);
+#pragma omp parallel num_threads(2)
+            {
+                if (omp_get_thread_num() == 0) {
+                    run_coordinator(&q, batch, nranks);
+                } else {
+                    omp_set_num_threads(local);
+                    run_local_worker(&q, batch, input_dir, output_dir, &m);
+                }
+            }
+        }
+        omp_destroy_lock(&q.lock);
+    } else {
+        run_worker(input_dir, output_dir, &m);
+    }
+
+    m.wall_time_sec = wall_time() - t_start;
+    get_cpu_times(&user_after, &sys_after);
+    m.cpu_user_time_sec   = user_after - user_before;
+    m.cpu_system_time_sec = sys_after - sys_before;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double cluster_wall = wall_time() - t_start;
+
+    RankMetrics *all = NULL;
+    if (rank == 0) all = (RankMetrics *)malloc(nranks * sizeof(RankMetrics));
+    MPI_Gather(&m, (int)sizeof(RankMetrics), MPI_BYTE,
+               all, (int)sizeof(RankMetrics), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        for (int r = 0; r < nranks; ++r) {
+            printf("[mpi] rank %d (%s): %d images in %d batches, busy %.3f s\n",
+                   all[r].rank, all[r].host, all[r].images_processed,
+                   all[r].batches, all[r].busy_time_sec);
+        }
+        printf("[mpi] Cluster wall time (s) : %.6f\n", cluster_wall);
+
+        write_mpi_metrics_json("results/logs/mpi_metrics.json",
+                               all, nranks, cluster_wall,
+                               input_dir, output_dir);
+        free(all);
+
+        for (int i = 0; i < count; ++i) free(items[i].name);
+        free(items);
+    }
+
+    MPI_Finalize();
+    return 0;
+}
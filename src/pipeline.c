@@ -0,0 +1,746 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pipeline.h"
+#include "edgelist.h"
+#include "ccl.h"
+#include "hough.h"
+#include "corners.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+/*
+ * MULTI-OUTPUT DAG EXECUTION
+ * --------------------------
+ *
+ * Branches are inserted into a prefix tree rooted at the decoded image:
+ *
+ *   source ── gray ──┬── [sink out/gray]
+ *                    └── blur2 ──┬── [sink out/blur]
+ *                                └── sobel ── [sink out/edges]
+ *
+ * Execution is depth-first. Each node output is reference counted by
+ * its number of consumers (child stages). All consumers but the last
+ * get a private copy; the last one takes the buffer and filters it in
+ * place, so a buffer is released as soon as its final consumer is done
+ * and at most one buffer per DAG level is alive at a time.
+ *
+ * POINTWISE FOLDING
+ * -----------------
+ *
+ * gamma, invert, threshold, stretch and posterize map each 8-bit sample
+ * through a fixed function of that sample alone, so any run of them is
+ * one function {0..255} -> {0..255}. After parsing, every maximal run
+ * whose inner nodes have no sink and a single child is replaced by one
+ * STAGE_LUT node:
+ *
+ *   gray ── gamma0.8 ── stretch16-240 ── invert ── [sink]
+ *   gray ── lut[gamma0.8,stretch16-240,invert] ── [sink]
+ *
+ * The table is built by running the real stages over a 0..255 ramp, so
+ * the folded pass is bit-identical to the unfolded one, and the chain
+ * costs one table-lookup sweep (apply_lut_u8) however long it is. The
+ * original nodes stay attached to the LUT node and run one by one on
+ * u16/f32 images, where a table would not fit.
+ *
+ * Mask, sparse and label nodes end their branch: they threshold the
+ * image they receive (Otsu if no level was given) and their sinks get
+ * 1-bit PNGs, .sedg edge lists (see edgelist.c) or the JSON list of
+ * 8-connected components (see ccl.c) instead of RGB PNGs. A hough
+ * node runs its own Sobel pass on the image it receives and writes the
+ * detected lines as JSON (see hough.c).
+ *
+ * harris and shitomasi nodes write a JSON keypoint list (see corners.c).
+ * Directly below a sobel node they take the gx/gy that node computed
+ * on its way to the edge image, so "gray,sobel=e;gray,sobel,harris=k"
+ * runs Sobel once; anywhere else they run their own Sobel pass.
+ */
+
+static PipelineNode *node_new(StageKind kind, int param) {
+    PipelineNode *n = (PipelineNode *)calloc(1, sizeof(PipelineNode));
+    if (!n) return NULL;
+    n->kind  = kind;
+    n->param = param;
+    return n;
+}
+
+static void node_free(PipelineNode *n) {
+    if (!n) return;
+    node_free(n->folded);
+    free(n->lut);
+    for (int i = 0; i < n->n_children; ++i) node_free(n->children[i]);
+    for (int i = 0; i < n->n_sinks; ++i) free(n->sinks[i]);
+    free(n->children);
+    free(n->sinks);
+    free(n);
+}
+
+static const char *stage_name(StageKind kind) {
+    switch (kind) {
+    case STAGE_SOURCE:    return "source";
+    case STAGE_GRAY:      return "gray";
+    case STAGE_BLUR:      return "blur";
+    case STAGE_SOBEL:     return "sobel";
+    case STAGE_GAMMA:     return "gamma";
+    case STAGE_INVERT:    return "invert";
+    case STAGE_THRESHOLD: return "threshold";
+    case STAGE_STRETCH:   return "stretch";
+    case STAGE_POSTERIZE: return "posterize";
+    case STAGE_LUT:       return "lut";
+    case STAGE_MASK:      return "mask";
+    case STAGE_SPARSE:    return "sparse";
+    case STAGE_LABEL:     return "label";
+    case STAGE_HOUGH:     return "hough";
+    case STAGE_HARRIS:    return "harris";
+    case STAGE_SHI_TOMASI: return "shitomasi";
+    default:              return "?";
+    }
+}
+
+static int is_corner(StageKind kind) {
+    return kind == STAGE_HARRIS || kind == STAGE_SHI_TOMASI;
+}
+
+static int is_terminal(StageKind kind) {
+    return kind == STAGE_MASK || kind == STAGE_SPARSE || kind == STAGE_LABEL ||
+           kind == STAGE_HOUGH || is_corner(kind);
+}
+
+static int is_pointwise(StageKind kind) {
+    return kind == STAGE_GAMMA || kind == STAGE_INVERT ||
+           kind == STAGE_THRESHOLD || kind == STAGE_STRETCH ||
+           kind == STAGE_POSTERIZE;
+}
+
+/* Whole-string number; an empty suffix keeps *out (the default). */
+static int parse_number(const char *s, double *out) {
+    if (*s == '\0') return 0;
+    char *end = NULL;
+    errno = 0;
+    double v = strtod(s, &end);
+    if (errno != 0 || end == s || *end != '\0') return -1;
+    *out = v;
+    return 0;
+}
+
+/*
+ * Parse one stage token ("gray", "blur", "blur4", "sobel", "gamma0.8",
+ * "invert", "threshold128", "stretch16-240", "posterize4").
+ */
+static int parse_stage(const char *tok, StageKind *kind, int *param,
+                       double args[2]) {
+    *param = 0;
+    args[0] = args[1] = 0.0;
+    if (strcmp(tok, "invert") == 0) {
+        *kind = STAGE_INVERT;
+        return 0;
+    }
+    if (strncmp(tok, "gamma", 5) == 0) {
+        *kind   = STAGE_GAMMA;
+        args[0] = 2.2;
+        if (parse_number(tok + 5, &args[0]) != 0) return -1;
+        return (args[0] > 0.0) ? 0 : -1;
+    }
+    if (strncmp(tok, "threshold", 9) == 0) {
+        double t = 128.0;
+        *kind = STAGE_THRESHOLD;
+        if (parse_number(tok + 9, &t) != 0 || t < 0.0 || t > 255.0) return -1;
+        args[0] = t / 255.0;
+        return 0;
+    }
+    if (strncmp(tok, "stretch", 7) == 0) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%s", tok + 7);
+        char *dash = strchr(buf, '-');
+        if (!dash) return -1;
+        *dash = '\0';
+        double lo = -1.0, hi = -1.0;
+        if (parse_number(buf, &lo) != 0 || parse_number(dash + 1, &hi) != 0)
+            return -1;
+        if (lo < 0.0 || hi > 255.0 || lo >= hi) return -1;
+        *kind   = STAGE_STRETCH;
+        args[0] = lo / 255.0;
+        args[1] = hi / 255.0;
+        return 0;
+    }
+    if (strncmp(tok, "posterize", 9) == 0) {
+        *kind  = STAGE_POSTERIZE;
+        *param = 4;
+        if (tok[9] != '\0') {
+            for (const char *d = tok + 9; *d; ++d)
+                if (!isdigit((unsigned char)*d)) return -1;
+            *param = atoi(tok + 9);
+        }
+        return (*param >= 2 && *param <= 256) ? 0 : -1;
+    }
+    if (strncmp(tok, "mask", 4) == 0 || strncmp(tok, "sparse", 6) == 0 ||
+        strncmp(tok, "label", 5) == 0) {
+        const char *num = tok + ((tok[0] == 'm') ? 4 : (tok[0] == 's') ? 6 : 5);
+        double t = -1.0;
+        *kind  = (tok[0] == 'm') ? STAGE_MASK :
+                 (tok[0] == 's') ? STAGE_SPARSE : STAGE_LABEL;
+        if (parse_number(num, &t) != 0 || t > 255.0) return -1;
+        if (*num != '\0' && t < 0.0) return -1;
+        *param = (t < 0.0) ? -1 : (int)t;
+        args[0] = (t < 0.0) ? 0.0 : t / 255.0;
+        return 0;
+    }
+    if (strncmp(tok, "harris", 6) == 0 || strncmp(tok, "shitomasi", 9) == 0) {
+        double n = 500.0;
+        int harris = (tok[0] == 'h');
+        *kind = harris ? STAGE_HARRIS : STAGE_SHI_TOMASI;
+        if (parse_number(tok + (harris ? 6 : 9), &n) != 0 || n < 1.0 || n > 1e6) return -1;
+        *param = (int)n;
+        return 0;
+    }
+    if (strncmp(tok, "hough", 5) == 0) {
+        double t = 64.0;
+        *kind = STAGE_HOUGH;
+        if (parse_number(tok + 5, &t) != 0 || t < 0.0 || t > 255.0) return -1;
+        *param  = (int)t;
+        args[0] = t / 255.0;
+        return 0;
+    }
+    if (strcmp(tok, "gray") == 0) {
+        *kind = STAGE_GRAY;
+        return 0;
+    }
+    if (strcmp(tok, "sobel") == 0) {
+        *kind = STAGE_SOBEL;
+        return 0;
+    }
+    if (strncmp(tok, "blur", 4) == 0) {
+        *kind  = STAGE_BLUR;
+        *param = 2;
+        if (tok[4] != '\0') {
+            for (const char *d = tok + 4; *d; ++d)
+                if (!isdigit((unsigned char)*d)) return -1;
+            *param = atoi(tok + 4);
+        }
+        return (*param > 0) ? 0 : -1;
+    }
+    return -1;
+}
+
+/* Find or create the child of parent for (kind, param, args). */
+static PipelineNode *child_for(Pipeline *p, PipelineNode *parent,
+                               StageKind kind, int param, const double args[2]) {
+    for (int i = 0; i < parent->n_children; ++i) {
+        PipelineNode *c = parent->children[i];
+        if (c->kind == kind && c->param == param &&
+            c->args[0] == args[0] && c->args[1] == args[1])
+            return c;
+    }
+
+    PipelineNode *c = node_new(kind, param);
+    if (c) {
+        c->args[0] = args[0];
+        c->args[1] = args[1];
+    }
+    PipelineNode **grown = (PipelineNode **)realloc(
+        parent->children, (parent->n_children + 1) * sizeof(*grown));
+    if (!c || !grown) {
+        free(c);
+        if (grown) parent->children = grown;
+        return NULL;
+    }
+    parent->children = grown;
+    parent->children[parent->n_children++] = c;
+    p->n_nodes++;
+    return c;
+}
+
+static int add_sink(PipelineNode *n, const char *dir) {
+    char **grown = (char **)realloc(n->sinks, (n->n_sinks + 1) * sizeof(*grown));
+    if (!grown) return -1;
+    n->sinks = grown;
+    n->sinks[n->n_sinks] = strdup(dir);
+    if (!n->sinks[n->n_sinks]) return -1;
+    n->n_sinks++;
+    return 0;
+}
+
+static int parse_branch(Pipeline *p, char *branch) {
+    char *eq = strrchr(branch, '=');
+    if (!eq || eq[1] == '\0') {
+        fprintf(stderr, "[pipeline] Branch needs '=output_dir': %s\n", branch);
+        return -1;
+    }
+    *eq = '\0';
+    const char *out_dir = eq + 1;
+
+    PipelineNode *cur = p->root;
+    char *save = NULL;
+    for (char *tok = strtok_r(branch, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save)) {
+        StageKind kind;
+        int param;
+        double args[2];
+        if (parse_stage(tok, &kind, &param, args) != 0) {
+            fprintf(stderr, "[pipeline] Unknown stage: %s\n", tok);
+            return -1;
+        }
+        if (is_terminal(cur->kind)) {
+            fprintf(stderr, "[pipeline] %s must be the last stage: %s\n",
+                    stage_name(cur->kind), tok);
+            return -1;
+        }
+        cur = child_for(p, cur, kind, param, args);
+        if (!cur) {
+            fprintf(stderr, "[pipeline] Out of memory.\n");
+            return -1;
+        }
+    }
+
+    if (add_sink(cur, out_dir) != 0) {
+        fprintf(stderr, "[pipeline] Out of memory.\n");
+        return -1;
+    }
+    p->n_sinks++;
+    p->n_branches++;
+    return 0;
+}
+
+static void apply_stage(const PipelineNode *n, Image *img);
+
+/*
+ * Replace the pointwise run starting at parent->children[slot] with a
+ * STAGE_LUT node. The run ends at the first node that has a sink, more
+ * or fewer than one child, or a non-pointwise child; that node's
+ * children and sinks move to the LUT node.
+ */
+static int fold_run(Pipeline *p, PipelineNode *parent, int slot) {
+    PipelineNode *first = parent->children[slot];
+    PipelineNode *last  = first;
+    int len = 1;
+    while (last->n_sinks == 0 && last->n_children == 1 &&
+           is_pointwise(last->children[0]->kind)) {
+        last = last->children[0];
+        len++;
+    }
+
+    // 256 x 1 ramp, every channel = x: the table is whatever the real
+    // stages make of each input value.
+    Image ramp = { .width = 256, .height = 1, .channels = 3, .type = SAMPLE_U8 };
+    unsigned char ramp_data[256 * 3];
+    for (int x = 0; x < 256; ++x)
+        ramp_data[3 * x] = ramp_data[3 * x + 1] = ramp_data[3 * x + 2] = (unsigned char)x;
+    ramp.data = ramp_data;
+    for (const PipelineNode *s = first; ; s = s->children[0]) {
+        apply_stage(s, &ramp);
+        if (s == last) break;
+    }
+
+    PipelineNode *lut = node_new(STAGE_LUT, len);
+    unsigned char *table = (unsigned char *)malloc(256);
+    if (!lut || !table) {
+        free(lut);
+        free(table);
+        return -1;
+    }
+    for (int x = 0; x < 256; ++x) table[x] = ramp_data[3 * x];
+
+    lut->lut        = table;
+    lut->folded     = first;
+    lut->children   = last->children;
+    lut->n_children = last->n_children;
+    lut->sinks      = last->sinks;
+    lut->n_sinks    = last->n_sinks;
+    last->children   = NULL;
+    last->n_children = 0;
+    last->sinks      = NULL;
+    last->n_sinks    = 0;
+
+    parent->children[slot] = lut;
+    p->n_nodes  -= len - 1;
+    p->n_folded += len;
+    return 0;
+}
+
+static int fold_pointwise(Pipeline *p, PipelineNode *n) {
+    for (int i = 0; i < n->n_children; ++i) {
+        if (is_pointwise(n->children[i]->kind) && fold_run(p, n, i) != 0)
+            return -1;
+        if (fold_pointwise(p, n->children[i]) != 0) return -1;
+    }
+    return 0;
+}
+
+Pipeline *pipeline_parse(const char *spec) {
+    if (!spec || !*spec) return NULL;
+
+    Pipeline *p = (Pipeline *)calloc(1, sizeof(Pipeline));
+    char *copy = strdup(spec);
+    if (!p || !copy) {
+        free(p);
+        free(copy);
+        return NULL;
+    }
+    p->root = node_new(STAGE_SOURCE, 0);
+    if (!p->root) {
+        free(copy);
+        free(p);
+        return NULL;
+    }
+
+    char *save = NULL;
+    for (char *branch = strtok_r(copy, ";", &save); branch;
+         branch = strtok_r(NULL, ";", &save)) {
+        if (parse_branch(p, branch) != 0) {
+            free(copy);
+            pipeline_free(p);
+            return NULL;
+        }
+    }
+    free(copy);
+
+    if (p->n_sinks == 0) {
+        pipeline_free(p);
+        return NULL;
+    }
+    if (fold_pointwise(p, p->root) != 0) {
+        fprintf(stderr, "[pipeline] Out of memory.\n");
+        pipeline_free(p);
+        return NULL;
+    }
+    return p;
+}
+
+/* mkdir -p: sink directories may be nested (e.g. out/edges). */
+static int ensure_directory(const char *path) {
+    char parent[512];
+    snprintf(parent, sizeof(parent), "%s", path);
+    for (char *slash = parent + 1; (slash = strchr(slash, '/')) != NULL; ++slash) {
+        *slash = '\0';
+        if (mkdir(parent, 0755) != 0 && errno != EEXIST) {
+            perror("[pipeline] mkdir");
+            return -1;
+        }
+        *slash = '/';
+    }
+
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return 0;
+        fprintf(stderr, "[pipeline] %s exists but is not a directory!\n", path);
+        return -1;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        perror("[pipeline] mkdir");
+        return -1;
+    }
+    return 0;
+}
+
+static int prepare_node(const PipelineNode *n) {
+    int rc = 0;
+    for (int i = 0; i < n->n_sinks; ++i)
+        if (ensure_directory(n->sinks[i]) != 0) rc = -1;
+    for (int i = 0; i < n->n_children; ++i)
+        if (prepare_node(n->children[i]) != 0) rc = -1;
+    return rc;
+}
+
+int pipeline_prepare_outputs(const Pipeline *p) {
+    if (!p) return -1;
+    return prepare_node(p->root);
+}
+
+static void apply_stage(const PipelineNode *n, Image *img) {
+    switch (n->kind) {
+    case STAGE_GRAY:      apply_grayscale(img);                                break;
+    case STAGE_BLUR:      apply_box_blur(img, n->param);                       break;
+    case STAGE_SOBEL:     apply_sobel_edge(img);                               break;
+    case STAGE_GAMMA:     apply_gamma(img, n->args[0]);                        break;
+    case STAGE_INVERT:    apply_invert(img);                                   break;
+    case STAGE_THRESHOLD: apply_threshold(img, n->args[0]);                    break;
+    case STAGE_STRETCH:   apply_contrast_stretch(img, n->args[0], n->args[1]); break;
+    case STAGE_POSTERIZE: apply_posterize(img, n->param);                      break;
+    case STAGE_LUT:
+        if (img->type == SAMPLE_U8) {
+            apply_lut_u8(img, n->lut);
+            break;
+        }
+        for (const PipelineNode *s = n->folded; s; ) {
+            apply_stage(s, img);
+            s = (s->n_children > 0) ? s->children[0] : NULL;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* Suffix a sink of kind appends to the input name: its file format. */
+static const char *output_extension(StageKind kind) {
+    switch (kind) {
+    case STAGE_SPARSE:     return ".sedg";
+    case STAGE_LABEL:
+    case STAGE_HOUGH:
+    case STAGE_HARRIS:
+    case STAGE_SHI_TOMASI: return ".json";
+    default:               return "";
+    }
+}
+
+void pipeline_output_path(char *buf, size_t size, const char *sink,
+                          StageKind kind, const char *file_name) {
+    snprintf(buf, size, "%s/%s%s", sink, file_name, output_extension(kind));
+}
+
+/* Vote img (freed here) into Hough lines and write them to every sink. */
+static int run_hough_node(const PipelineNode *n, Image *img, const char *file_name,
+                          PipelineRunStats *stats) {
+    HoughParams hp;
+    hough_default_params(&hp);
+    HoughResult *lines = hough_from_gray(img, n->args[0], &hp);
+    free_image(img);
+    if (!lines) return 0;
+    stats->hough_votes += lines->votes;
+    stats->hough_sec   += lines->vote_sec + lines->merge_sec;
+    if (filter_budget_exceeded()) {
+        free_hough(lines);
+        return 0;
+    }
+
+    int written = 0;
+    for (int i = 0; i < n->n_sinks; ++i) {
+        char out_path[512];
+        pipeline_output_path(out_path, sizeof(out_path), n->sinks[i], n->kind, file_name);
+        if (write_hough_json(out_path, lines) == 0) written++;
+    }
+    free_hough(lines);
+    return written;
+}
+
+/* Detect corners from grad and write them to every sink of n. */
+static int run_corner_node(const PipelineNode *n, const SobelGradients *grad,
+                           const char *file_name) {
+    CornerParams cp;
+    corner_default_params(&cp);
+    cp.method      = (n->kind == STAGE_SHI_TOMASI) ? CORNER_SHI_TOMASI : CORNER_HARRIS;
+    cp.max_corners = n->param;
+    KeypointList *corners = grad ? detect_corners(grad, &cp) : NULL;
+    if (!corners) return 0;
+    if (filter_budget_exceeded()) {
+        free_keypoints(corners);
+        return 0;
+    }
+
+    int written = 0;
+    for (int i = 0; i < n->n_sinks; ++i) {
+        char out_path[512];
+        pipeline_output_path(out_path, sizeof(out_path), n->sinks[i], n->kind, file_name);
+        if (write_keypoints_json(out_path, corners) == 0) written++;
+    }
+    free_keypoints(corners);
+    return written;
+}
+
+/* Threshold img (freed here) into a mask, edge list or components. */
+static int run_terminal_node(const PipelineNode *n, Image *img,
+                             const char *file_name, PipelineRunStats *stats) {
+    if (n->kind == STAGE_HOUGH) return run_hough_node(n, img, file_name, stats);
+    if (is_corner(n->kind)) {
+        SobelGradients *grad = sobel_gradients(img);
+        free_image(img);
+        int written = run_corner_node(n, grad, file_name);
+        free_gradients(grad);
+        return written;
+    }
+    double level = (n->param < 0) ? otsu_level(img) : n->args[0];
+    BitMask      *mask  = NULL;
+    EdgeList     *edges = NULL;
+    ComponentSet *comps = NULL;
+    if (n->kind == STAGE_SPARSE) {
+        edges = edge_list_from_image(img, level);
+    } else {
+        mask = threshold_mask(img, level);
+        if (mask && n->kind == STAGE_LABEL) {
+            comps = label_components(mask, 8);
+            free_mask(mask);
+            mask = NULL;
+        }
+    }
+    free_image(img);
+    if (!mask && !edges && !comps) return 0;
+    if (filter_budget_exceeded()) {
+        free_mask(mask);
+        edge_list_free(edges);
+        free_components(comps);
+        return 0;
+    }
+
+    int written = 0;
+    for (int i = 0; i < n->n_sinks; ++i) {
+        char out_path[512];
+        pipeline_output_path(out_path, sizeof(out_path), n->sinks[i], n->kind, file_name);
+        int rc = mask  ? save_mask_png(out_path, mask) :
+                 edges ? edge_list_write(out_path, edges) :
+                         write_components_json(out_path, comps);
+        if (rc == 0) written++;
+    }
+    free_mask(mask);
+    edge_list_free(edges);
+    free_components(comps);
+    return written;
+}
+
+/* img is owned by this call: consumed by the last child or freed. */
+static int run_node(const PipelineNode *n, Image *img, const char *file_name,
+                    PipelineRunStats *stats) {
+    if (is_terminal(n->kind)) return run_terminal_node(n, img, file_name, stats);
+
+    // corner children of a sobel node reuse its gradients, not its image
+    int corner_children = 0;
+    if (n->kind == STAGE_SOBEL)
+        for (int i = 0; i < n->n_children; ++i)
+            corner_children += is_corner(n->children[i]->kind);
+
+    // without gradients (out of memory) the corner children get none,
+    // but the image itself is still Sobel-filtered for the sinks
+    SobelGradients *grad = NULL;
+    if (corner_children > 0) grad = apply_sobel_edge_gradients(img);
+    if (!grad && !filter_budget_exceeded()) apply_stage(n, img);
+    if (filter_budget_exceeded()) {
+        free_gradients(grad);
+        free_image(img);   // partially filtered: write nothing below here
+        return 0;
+    }
+
+    int written = 0;
+    for (int i = 0; i < n->n_sinks; ++i) {
+        char out_path[512];
+        pipeline_output_path(out_path, sizeof(out_path), n->sinks[i], n->kind, file_name);
+        if (save_image_png(out_path, img) == 0)
+            written++;
+        else
+            fprintf(stderr, "[pipeline] Failed to save %s\n", out_path);
+    }
+
+    int refs = n->n_children - corner_children;
+    int image_children = refs;
+    for (int i = 0; i < n->n_children; ++i) {
+        if (corner_children > 0 && is_corner(n->children[i]->kind)) {
+            written += run_corner_node(n->children[i], grad, file_name);
+            continue;
+        }
+        Image *input = (--refs == 0) ? img : clone_image(img);
+        if (!input) continue;
+        written += run_node(n->children[i], input, file_name, stats);
+    }
+
+    free_gradients(grad);
+    if (image_children == 0) free_image(img);
+    return written;
+}
+
+int pipeline_run(const Pipeline *p, Image *img, const char *file_name,
+                 PipelineRunStats *stats) {
+    PipelineRunStats local;
+    memset(&local, 0, sizeof(local));
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (!p || !img || !file_name) {
+        free_image(img);
+        return 0;
+    }
+    return run_node(p->root, img, file_name, stats ? stats : &local);
+}
+
+static long long node_output_bytes(const PipelineNode *n, const char *file_name) {
+    long long total = 0;
+    for (int i = 0; i < n->n_sinks; ++i) {
+        char out_path[512];
+        struct stat st;
+        pipeline_output_path(out_path, sizeof(out_path), n->sinks[i], n->kind, file_name);
+        if (stat(out_path, &st) != 0 || st.st_size <= 0) return -1;
+        total += (long long)st.st_size;
+    }
+    for (int i = 0; i < n->n_children; ++i) {
+        long long sub = node_output_bytes(n->children[i], file_name);
+        if (sub < 0) return -1;
+        total += sub;
+    }
+    return total;
+}
+
+long long pipeline_output_bytes(const Pipeline *p, const char *file_name) {
+    if (!p || !file_name) return -1;
+    return node_output_bytes(p->root, file_name);
+}
+
+static void node_for_each_output(const PipelineNode *n, const char *file_name,
+                                 PipelineOutputFn fn, void *ctx) {
+    for (int i = 0; i < n->n_sinks; ++i) {
+        char out_path[512];
+        pipeline_output_path(out_path, sizeof(out_path), n->sinks[i], n->kind, file_name);
+        fn(out_path, n->sinks[i], n->kind, ctx);
+    }
+    for (int i = 0; i < n->n_children; ++i)
+        node_for_each_output(n->children[i], file_name, fn, ctx);
+}
+
+void pipeline_for_each_output(const Pipeline *p, const char *file_name,
+                              PipelineOutputFn fn, void *ctx) {
+    if (!p || !file_name || !fn) return;
+    node_for_each_output(p->root, file_name, fn, ctx);
+}
+
+static void print_stage_args(const PipelineNode *n) {
+    switch (n->kind) {
+    case STAGE_BLUR:      printf("(r=%d)", n->param);                        break;
+    case STAGE_GAMMA:     printf("(%.2f)", n->args[0]);                      break;
+    case STAGE_THRESHOLD: printf("(%.0f)", n->args[0] * 255.0);              break;
+    case STAGE_STRETCH:   printf("(%.0f-%.0f)", n->args[0] * 255.0,
+                                 n->args[1] * 255.0);                        break;
+    case STAGE_POSTERIZE: printf("(%d)", n->param);                          break;
+    case STAGE_HARRIS:
+    case STAGE_SHI_TOMASI: printf("(%d)", n->param);                         break;
+    case STAGE_MASK:
+    case STAGE_SPARSE:
+    case STAGE_LABEL:
+    case STAGE_HOUGH:
+        if (n->param < 0) printf("(otsu)");
+        else              printf("(%d)", n->param);
+        break;
+    default:                                                                 break;
+    }
+}
+
+static void print_node(const PipelineNode *n, int depth) {
+    printf("[pipeline] %*s%s", depth * 2, "", stage_name(n->kind));
+    print_stage_args(n);
+    if (n->kind == STAGE_LUT) {
+        printf("[");
+        for (const PipelineNode *s = n->folded; s; ) {
+            printf("%s", stage_name(s->kind));
+            print_stage_args(s);
+            s = (s->n_children > 0) ? s->children[0] : NULL;
+            if (s) printf(",");
+        }
+        printf("]");
+    }
+    for (int i = 0; i < n->n_sinks; ++i) printf(" -> %s", n->sinks[i]);
+    printf("\n");
+    for (int i = 0; i < n->n_children; ++i) print_node(n->children[i], depth + 1);
+}
+
+void pipeline_print(const Pipeline *p) {
+    if (!p) return;
+    printf("[pipeline] %d branches, %d stage nodes, %d sinks\n",
+           p->n_branches, p->n_nodes, p->n_sinks);
+    if (p->n_folded > 0)
+        printf("[pipeline] %d pointwise stages folded into lookup tables (%s)\n",
+               p->n_folded, lut_backend_name());
+    print_node(p->root, 0);
+}
+
+void pipeline_free(Pipeline *p) {
+    if (!p) return;
+    node_free(p->root);
+    free(p);
+}
@@ -0,0 +1,141 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "filters.h"
+
+/**
+ * Stages that can appear in a multi-output pipeline.
+ */
+typedef enum {
+    STAGE_SOURCE = 0,   // decoded input image (root of the DAG)
+    STAGE_GRAY,
+    STAGE_BLUR,         // param = radius
+    STAGE_SOBEL,
+    STAGE_GAMMA,        // args[0] = gamma
+    STAGE_INVERT,
+    STAGE_THRESHOLD,    // args[0] = level in [0, 1]
+    STAGE_STRETCH,      // args[0..1] = black/white point in [0, 1]
+    STAGE_POSTERIZE,    // param = levels
+    STAGE_LUT,          // folded chain of the five stages above
+    STAGE_MASK,         // 1-bpp mask, args[0] = level; param < 0 = Otsu
+    STAGE_SPARSE,       // .sedg edge list, same parameters as STAGE_MASK
+    STAGE_LABEL,        // component stats JSON, same parameters as STAGE_MASK
+    STAGE_HOUGH,        // Hough lines JSON, args[0] = Sobel magnitude level
+    STAGE_HARRIS,       // keypoint JSON, param = max corners
+    STAGE_SHI_TOMASI    // keypoint JSON, param = max corners
+} StageKind;
+
+/**
+ * One node of the pipeline DAG. Branches that share a prefix of stages
+ * share the corresponding nodes, so each prefix is computed once.
+ */
+typedef struct PipelineNode {
+    StageKind kind;
+    int       param;
+    double    args[2];
+
+    unsigned char       *lut;      // STAGE_LUT: 256-entry table for u8 input
+    struct PipelineNode *folded;   // STAGE_LUT: the original stages, one
+                                   // chain, run one by one on u16/f32
+
+    struct PipelineNode **children;
+    int                   n_children;
+
+    char **sinks;         // output directories written from this node
+    int    n_sinks;
+} PipelineNode;
+
+typedef struct {
+    PipelineNode *root;
+    int           n_nodes;    // stage nodes, excluding the source
+    int           n_folded;   // pointwise stages folded into lookup tables
+    int           n_sinks;
+    int           n_branches;
+} Pipeline;
+
+/**
+ * Parse a DAG spec of ';'-separated branches, each "stages=output_dir",
+ * where stages is a ','-separated chain of
+ *
+ *   gray, blur[N], sobel                 neighbourhood / colour stages
+ *   gamma[G], invert, threshold[T],      single-input pointwise stages
+ *   stretch<LO>-<HI>, posterize[N]       (T, LO, HI in 0..255)
+ *   mask[T], sparse[T], label[T]         1-bit mask / sparse edge list /
+ *                                        component JSON, Otsu without
+ *                                        T; must end their branch
+ *   hough[T]                             Hough lines JSON, Sobel
+ *                                        magnitude >= T (default 64);
+ *                                        must end its branch
+ *   harris[N], shitomasi[N]              N strongest corners (default
+ *                                        500) as JSON; after sobel they
+ *                                        reuse its gradients; must end
+ *                                        their branch
+ *
+ *   "gray=out/gray;gray,blur2=out/blur;gray,blur2,sobel=out/edges"
+ *
+ * An empty chain ("=out/raw") writes the decoded input.
+ * Runs of pointwise stages without an intermediate sink are folded
+ * into one STAGE_LUT node. Returns NULL on a malformed spec.
+ */
+Pipeline *pipeline_parse(const char *spec);
+
+/**
+ * Create all sink directories. Returns 0 on success.
+ */
+int pipeline_prepare_outputs(const Pipeline *p);
+
+/**
+ * Write to buf the path a sink of a `kind` node uses for input
+ * file_name: <sink dir>/<file_name>, plus ".sedg" for sparse edge lists
+ * and ".json" for component stats, Hough lines and corners. Image and
+ * mask sinks keep the input name.
+ */
+void pipeline_output_path(char *buf, size_t size, const char *sink,
+                          StageKind kind, const char *file_name);
+
+/**
+ * Work done by one pipeline_run() call, for throughput metrics.
+ */
+typedef struct {
+    long long hough_votes;   // accumulator increments of all hough nodes
+    double    hough_sec;     // their voting + merge time
+} PipelineRunStats;
+
+/**
+ * Run the DAG on one decoded image and write every sink to its
+ * pipeline_output_path(). Takes ownership of img (freed on return).
+ * If the filter time budget runs out (see filter_budget_arm), the
+ * stages after it are abandoned and their sinks are not written.
+ * Fills *stats unless it is NULL.
+ * Returns the number of outputs written successfully.
+ */
+int pipeline_run(const Pipeline *p, Image *img, const char *file_name,
+                 PipelineRunStats *stats);
+
+/**
+ * Total size in bytes of every sink's output for file_name, or -1 if
+ * any of them is missing or empty.
+ */
+long long pipeline_output_bytes(const Pipeline *p, const char *file_name);
+
+/**
+ * Called with the output path of one sink, its directory and the kind
+ * of the node writing it.
+ */
+typedef void (*PipelineOutputFn)(const char *path, const char *sink,
+                                 StageKind kind, void *ctx);
+
+/**
+ * Call fn for every sink's output for file_name.
+ */
+void pipeline_for_each_output(const Pipeline *p, const char *file_name,
+                              PipelineOutputFn fn, void *ctx);
+
+/**
+ * Print the DAG structure to stdout.
+ */
+void pipeline_print(const Pipeline *p);
+
+void pipeline_free(Pipeline *p);
+
+#endif // PIPELINE_H
@@ -0,0 +1,729 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pngdec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define PNG_SSE2 1
+#endif
+
+/*
+ * PNG DECODING
+ * ------------
+ *
+ * stb_image inflates one bit at a time through a 16-bit-at-most bit
+ * buffer and unfilters byte by byte. For the 8-bit images that make up
+ * most of our PNG input this decoder does both stages wider:
+ *
+ *   inflate   64-bit bit buffer refilled with one unaligned 8-byte load,
+ *             so a whole length/distance pair (at most 48 bits) decodes
+ *             without another refill. Huffman codes are looked up in a
+ *             table indexed by the next 10 (literal/length) or 8
+ *             (distance) bits, with second-level tables for longer
+ *             codes; every entry carries the symbol's base value and
+ *             extra-bit count. Matches with distance >= 8 copy 8 bytes
+ *             at a time into an output buffer padded by 8 bytes.
+ *   unfilter  Up is a plain loop the compiler vectorizes. Sub, Avg and
+ *             Paeth depend on the pixel to the left, so with SSE2 they
+ *             run one whole pixel (3 or 4 bytes) per step in vector
+ *             lanes, Paeth with branch-free 16-bit arithmetic; other
+ *             pixel sizes and non-SSE2 builds use the scalar loops.
+ *
+ * RGB and RGBA rows are unfiltered and compacted to RGB inside the
+ * inflate buffer; gray and palette rows are unfiltered in place, then
+ * expanded into a separate output. CRCs and the Adler-32 trailer are not
+ * checked, as in stb_image.
+ */
+
+#define PNG_MAX_DIM   (1 << 24)    // stb_image's limit
+
+/* --- inflate --- */
+
+#define LITLEN_BITS   10
+#define DIST_BITS     8
+#define CODELEN_BITS  7
+#define MAX_CODE_LEN  15
+
+/*
+ * Table entry: value (literal, base or subtable offset) in bits 16-31,
+ * extra bits (or subtable index bits) in 12-15, kind in 8-11, code
+ * length in 0-7.
+ */
+enum { K_LITERAL, K_BASE, K_END, K_SUBTABLE, K_INVALID };
+
+#define ENTRY(value, extra, kind, len) \
+    (((uint32_t)(value) << 16) | ((uint32_t)(extra) << 12) | \
+     ((uint32_t)(kind) << 8) | (uint32_t)(len))
+#define E_LEN(e)    ((e) & 0xFF)
+#define E_KIND(e)   (((e) >> 8) & 0xF)
+#define E_EXTRA(e)  (((e) >> 12) & 0xF)
+#define E_VALUE(e)  ((e) >> 16)
+
+// primary table + worst case of one second-level table per long code
+#define LITLEN_TABLE_SIZE ((1 << LITLEN_BITS) + 288 * (1 << (MAX_CODE_LEN - LITLEN_BITS)))
+#define DIST_TABLE_SIZE   ((1 << DIST_BITS) + 32 * (1 << (MAX_CODE_LEN - DIST_BITS)))
+
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t codelen_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+typedef struct {
+    const uint8_t *in;
+    const uint8_t *end;      // real end; 16 readable zero bytes follow
+    uint64_t       bits;
+    unsigned       count;    // valid bits in `bits`
+} BitReader;
+
+typedef struct {
+    uint32_t litlen[LITLEN_TABLE_SIZE];
+    uint32_t dist[DIST_TABLE_SIZE];
+    uint32_t codelen[1 << CODELEN_BITS];
+} HuffTables;
+
+static inline uint64_t load_le64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+/*
+ * Top up to at least 56 valid bits. Past the end the padding supplies
+ * zeros; zlib_inflate checks afterwards that none were consumed.
+ */
+static inline void refill(BitReader *br) {
+    if (br->in <= br->end + 8)
+        br->bits |= load_le64(br->in) << br->count;
+    br->in += (63 - br->count) >> 3;
+    br->count |= 56;
+}
+
+static inline void consume(BitReader *br, unsigned n) {
+    br->bits >>= n;
+    br->count -= n;
+}
+
+static inline uint32_t lookup(const uint32_t *table, int table_bits, uint64_t bits) {
+    uint32_t e = table[bits & ((1u << table_bits) - 1)];
+    if (E_KIND(e) == K_SUBTABLE)
+        e = table[E_VALUE(e) + ((bits >> table_bits) & ((1u << E_EXTRA(e)) - 1))];
+    return e;
+}
+
+/*
+ * Build a decode table from code lengths. sym_entry[s] is the entry
+ * for symbol s without its length. Incomplete codes are allowed; their
+ * unused slots decode as K_INVALID. Returns -1 if over-subscribed or if
+ * the subtables would not fit in size entries.
+ */
+static int build_table(uint32_t *table, int size, int table_bits,
+                       const uint8_t *lens, int n, const uint32_t *sym_entry) {
+    int count[MAX_CODE_LEN + 1] = {0};
+    for (int i = 0; i < n; ++i) count[lens[i]]++;
+    count[0] = 0;
+
+    int left = 1, max_len = 0;
+    for (int len = 1; len <= MAX_CODE_LEN; ++len) {
+        left = (left << 1) - count[len];
+        if (left < 0) return -1;
+        if (count[len]) max_len = len;
+    }
+
+    int next[MAX_CODE_LEN + 1];
+    int code = 0;
+    for (int len = 1; len <= MAX_CODE_LEN; ++len) {
+        code = (code + count[len - 1]) << 1;
+        next[len] = code;
+    }
+
+    uint32_t invalid = ENTRY(0, 0, K_INVALID, 0);
+    int primary = 1 << table_bits;
+    for (int i = 0; i < primary; ++i) table[i] = invalid;
+    int sub_bits = (max_len > table_bits) ? max_len - table_bits : 0;
+    int next_sub = primary;
+
+    for (int s = 0; s < n; ++s) {
+        int len = lens[s];
+        if (!len) continue;
+        int c = next[len]++;
+        int rev = 0;                       // codes are stored MSB first
+        for (int b = 0; b < len; ++b) rev |= ((c >> b) & 1) << (len - 1 - b);
+        uint32_t e = sym_entry[s] | (uint32_t)len;
+
+        if (len <= table_bits) {
+            for (int i = rev; i < primary; i += 1 << len) table[i] = e;
+            continue;
+        }
+        int prefix = rev & (primary - 1);
+        if (E_KIND(table[prefix]) != K_SUBTABLE) {
+            if (next_sub + (1 << sub_bits) > size) return -1;
+            table[prefix] = ENTRY(next_sub, sub_bits, K_SUBTABLE, table_bits);
+            for (int i = 0; i < (1 << sub_bits); ++i) table[next_sub + i] = invalid;
+            next_sub += 1 << sub_bits;
+        }
+        uint32_t base = E_VALUE(table[prefix]);
+        for (int i = rev >> table_bits; i < (1 << sub_bits); i += 1 << (len - table_bits))
+            table[base + i] = e;
+    }
+    return 0;
+}
+
+static int build_litlen(HuffTables *t, const uint8_t *lens, int n) {
+    uint32_t sym[288];
+    for (int s = 0; s < 288; ++s) {
+        if (s < 256)      sym[s] = ENTRY(s, 0, K_LITERAL, 0);
+        else if (s == 256) sym[s] = ENTRY(0, 0, K_END, 0);
+        else if (s < 286) sym[s] = ENTRY(length_base[s - 257], length_extra[s - 257], K_BASE, 0);
+        else              sym[s] = ENTRY(0, 0, K_INVALID, 0);
+    }
+    return build_table(t->litlen, LITLEN_TABLE_SIZE, LITLEN_BITS, lens, n, sym);
+}
+
+static int build_dist(HuffTables *t, const uint8_t *lens, int n) {
+    uint32_t sym[32];
+    for (int s = 0; s < 32; ++s)
+        sym[s] = (s < 30) ? ENTRY(dist_base[s], dist_extra[s], K_BASE, 0)
+                          : ENTRY(0, 0, K_INVALID, 0);
+    return build_table(t->dist, DIST_TABLE_SIZE, DIST_BITS, lens, n, sym);
+}
+
+static int build_fixed(HuffTables *t) {
+    uint8_t lens[288 + 32];
+    for (int i = 0; i < 144; ++i) lens[i] = 8;
+    for (int i = 144; i < 256; ++i) lens[i] = 9;
+    for (int i = 256; i < 280; ++i) lens[i] = 7;
+    for (int i = 280; i < 288; ++i) lens[i] = 8;
+    for (int i = 0; i < 32; ++i) lens[288 + i] = 5;
+    if (build_litlen(t, lens, 288) != 0) return -1;
+    return build_dist(t, lens + 288, 32);
+}
+
+static int read_dynamic(BitReader *br, HuffTables *t) {
+    refill(br);
+    int hlit  = (int)(br->bits & 31) + 257;
+    int hdist = (int)((br->bits >> 5) & 31) + 1;
+    int hclen = (int)((br->bits >> 10) & 15) + 4;
+    consume(br, 14);
+    if (hlit > 286 || hdist > 30) return -1;
+
+    uint8_t cl_lens[19] = {0};
+    for (int i = 0; i < hclen; ++i) {
+        if (br->count < 3) refill(br);
+        cl_lens[codelen_order[i]] = (uint8_t)(br->bits & 7);
+        consume(br, 3);
+    }
+    uint32_t cl_sym[19];
+    for (int s = 0; s < 19; ++s) cl_sym[s] = ENTRY(s, 0, K_LITERAL, 0);
+    if (build_table(t->codelen, 1 << CODELEN_BITS, CODELEN_BITS, cl_lens, 19, cl_sym) != 0) return -1;
+
+    uint8_t lens[286 + 30];
+    int total = hlit + hdist;
+    for (int i = 0; i < total;) {
+        refill(br);
+        uint32_t e = t->codelen[br->bits & ((1u << CODELEN_BITS) - 1)];
+        if (E_KIND(e) != K_LITERAL) return -1;
+        consume(br, E_LEN(e));
+        int sym = (int)E_VALUE(e);
+        if (sym < 16) {
+            lens[i++] = (uint8_t)sym;
+            continue;
+        }
+        int rep;
+        uint8_t val = 0;
+        if (sym == 16) {
+            if (i == 0) return -1;
+            val = lens[i - 1];
+            rep = 3 + (int)(br->bits & 3);
+            consume(br, 2);
+        } else if (sym == 17) {
+            rep = 3 + (int)(br->bits & 7);
+            consume(br, 3);
+        } else {
+            rep = 11 + (int)(br->bits & 127);
+            consume(br, 7);
+        }
+        if (i + rep > total) return -1;
+        memset(lens + i, val, (size_t)rep);
+        i += rep;
+    }
+    if (lens[256] == 0) return -1;         // no end-of-block code
+    if (build_litlen(t, lens, hlit) != 0) return -1;
+    return build_dist(t, lens + hlit, hdist);
+}
+
+/* Huffman-coded block body into out; returns the new write position. */
+static uint8_t *inflate_block(BitReader *br, const HuffTables *t, uint8_t *out,
+                              uint8_t *out_start, uint8_t *out_end) {
+    for (;;) {
+        refill(br);
+        uint32_t e = lookup(t->litlen, LITLEN_BITS, br->bits);
+        consume(br, E_LEN(e));
+        unsigned kind = E_KIND(e);
+        if (kind == K_LITERAL) {
+            if (out == out_end) return NULL;
+            *out++ = (uint8_t)E_VALUE(e);
+            continue;
+        }
+        if (kind == K_END) return out;
+        if (kind != K_BASE) return NULL;
+
+        unsigned extra = E_EXTRA(e);
+        size_t length = E_VALUE(e) + (size_t)(br->bits & ((1u << extra) - 1));
+        consume(br, extra);
+
+        e = lookup(t->dist, DIST_BITS, br->bits);
+        consume(br, E_LEN(e));
+        if (E_KIND(e) != K_BASE) return NULL;
+        extra = E_EXTRA(e);
+        size_t dist = E_VALUE(e) + (size_t)(br->bits & ((1u << extra) - 1));
+        consume(br, extra);
+
+        if (dist > (size_t)(out - out_start) || length > (size_t)(out_end - out))
+            return NULL;
+        const uint8_t *src = out - dist;
+        if (dist >= 8) {
+            // 8-byte chunks may run up to 7 bytes past the match (padding)
+            uint8_t *stop = out + length;
+            do {
+                memcpy(out, src, 8);
+                out += 8;
+                src += 8;
+            } while (out < stop);
+            out = stop;
+        } else if (dist == 1) {
+            memset(out, out[-1], length);
+            out += length;
+        } else {
+            for (size_t i = 0; i < length; ++i) out[i] = src[i];
+            out += length;
+        }
+    }
+}
+
+/*
+ * Inflate a zlib stream (src[len], followed by 16 zero bytes) into
+ * exactly out_len bytes of out (followed by 8 bytes of padding).
+ */
+static int zlib_inflate(const uint8_t *src, size_t len, uint8_t *out, size_t out_len) {
+    if (len < 2) return -1;
+    unsigned cmf = src[0], flg = src[1];
+    if ((cmf & 15) != 8 || (cmf * 256 + flg) % 31 != 0 || (flg & 32)) return -1;
+
+    HuffTables *t = (HuffTables *)malloc(sizeof(HuffTables));
+    if (!t) return -1;
+
+    BitReader br = { src + 2, src + len, 0, 0 };
+    uint8_t *pos = out, *out_end = out + out_len;
+    int final = 0, fixed_built = 0, rc = 0;
+
+    while (!final && rc == 0) {
+        refill(&br);
+        final = (int)(br.bits & 1);
+        unsigned type = (unsigned)((br.bits >> 1) & 3);
+        consume(&br, 3);
+
+        if (type == 0) {
+            // stored: back up to the first unread byte
+            consume(&br, br.count & 7);
+            const uint8_t *p = br.in - (br.count >> 3);
+            br.bits = 0;
+            br.count = 0;
+            if (p > br.end || br.end - p < 4) { rc = -1; break; }
+            size_t n = (size_t)p[0] | ((size_t)p[1] << 8);
+            size_t nn = (size_t)p[2] | ((size_t)p[3] << 8);
+            p += 4;
+            if (n != (~nn & 0xFFFF) || (size_t)(br.end - p) < n ||
+                (size_t)(out_end - pos) < n) {
+                rc = -1;
+                break;
+            }
+            memcpy(pos, p, n);
+            pos += n;
+            br.in = p + n;
+            continue;
+        }
+        if (type == 1) {
+            if (!fixed_built && build_fixed(t) != 0) { rc = -1; break; }
+            fixed_built = 1;
+        } else if (type == 2) {
+            fixed_built = 0;
+            if (read_dynamic(&br, t) != 0) { rc = -1; break; }
+        } else {
+            rc = -1;
+            break;
+        }
+        pos = inflate_block(&br, t, pos, out, out_end);
+        if (!pos) rc = -1;
+    }
+    if (br.in - (br.count >> 3) > br.end) rc = -1;   // read into the padding
+
+    free(t);
+    if (rc != 0 || pos != out_end) return -1;   // short or corrupt
+    return 0;
+}
+
+/* --- unfilter --- */
+
+static inline uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+/*
+ * dst may equal src or lie below it (rows compacted within one buffer);
+ * every byte is read before anything at or after it is written. prev is
+ * the previous unfiltered row (zeros for row 0).
+ */
+static void unfilter_scalar(int type, uint8_t *dst, const uint8_t *src,
+                            const uint8_t *prev, size_t n, int bpp) {
+    size_t i;
+    switch (type) {
+    case 1:
+        for (i = 0; i < (size_t)bpp; ++i) dst[i] = src[i];
+        for (; i < n; ++i) dst[i] = (uint8_t)(src[i] + dst[i - bpp]);
+        break;
+    case 2:
+        for (i = 0; i < n; ++i) dst[i] = (uint8_t)(src[i] + prev[i]);
+        break;
+    case 3:
+        for (i = 0; i < (size_t)bpp; ++i) dst[i] = (uint8_t)(src[i] + (prev[i] >> 1));
+        for (; i < n; ++i) dst[i] = (uint8_t)(src[i] + ((dst[i - bpp] + prev[i]) >> 1));
+        break;
+    case 4:
+        for (i = 0; i < (size_t)bpp; ++i) dst[i] = (uint8_t)(src[i] + prev[i]);
+        for (; i < n; ++i)
+            dst[i] = (uint8_t)(src[i] + paeth(dst[i - bpp], prev[i], prev[i - bpp]));
+        break;
+    default:
+        if (dst != src) memmove(dst, src, n);
+        break;
+    }
+}
+
+#ifdef PNG_SSE2
+/* One pixel of bpp (3 or 4) bytes into the low lanes of a vector. */
+static inline __m128i load_px(const uint8_t *p, int bpp) {
+    uint32_t v;
+    if (bpp == 4) {
+        memcpy(&v, p, 4);
+    } else if (bpp < 3) {
+        v = p[0];
+        if (bpp == 2) v |= (uint32_t)p[1] << 8;
+    } else {
+        // assembled in a register: a partial copy into a stack word
+        // would stall store forwarding on every pixel
+        uint16_t lo;
+        memcpy(&lo, p, 2);
+        v = lo | ((uint32_t)p[2] << 16);
+    }
+    return _mm_cvtsi32_si128((int)v);
+}
+
+static inline void store_px(uint8_t *p, __m128i x, int bpp) {
+    uint32_t v = (uint32_t)_mm_cvtsi128_si32(x);
+    if (bpp == 4) {
+        memcpy(p, &v, 4);
+    } else if (bpp < 3) {
+        p[0] = (uint8_t)v;
+        if (bpp == 2) p[1] = (uint8_t)(v >> 8);
+    } else {
+        uint16_t lo = (uint16_t)v;
+        memcpy(p, &lo, 2);
+        p[2] = (uint8_t)(v >> 16);
+    }
+}
+
+/*
+ * Sub, Avg and Paeth for 3- and 4-byte pixels, one pixel per step with
+ * the channels in parallel (the scheme of libpng's SSE2 filters). The
+ * running left pixel stays in a register. Always inlined with a constant
+ * bpp so the pixel loads and stores compile to plain moves.
+ */
+static inline __attribute__((always_inline))
+void unfilter_sse2(int type, uint8_t *dst, const uint8_t *src,
+                   const uint8_t *prev, size_t n, int bpp) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero;                 // left, unfiltered
+    __m128i c = zero;                 // upper left
+    size_t i = 0;
+
+    switch (type) {
+    case 1:
+        for (; i + (size_t)bpp <= n; i += (size_t)bpp) {
+            a = _mm_add_epi8(a, load_px(src + i, bpp));
+            store_px(dst + i, a, bpp);
+        }
+        break;
+    case 3:
+        for (; i + (size_t)bpp <= n; i += (size_t)bpp) {
+            __m128i b = load_px(prev + i, bpp);
+            // floor((a + b) / 2): pavgb rounds up, drop the carried bit
+            __m128i avg = _mm_avg_epu8(a, b);
+            avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+            a = _mm_add_epi8(avg, load_px(src + i, bpp));
+            store_px(dst + i, a, bpp);
+        }
+        break;
+    case 4:
+        for (; i + (size_t)bpp <= n; i += (size_t)bpp) {
+            __m128i b  = _mm_unpacklo_epi8(load_px(prev + i, bpp), zero);
+            __m128i aw = _mm_unpacklo_epi8(a, zero);
+            __m128i pa = _mm_sub_epi16(b, c);          // p - a = b - c
+            __m128i pb = _mm_sub_epi16(aw, c);         // p - b = a - c
+            __m128i pc = _mm_add_epi16(pa, pb);        // p - c
+            pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+            pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+            pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+            __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            // ties prefer a, then b, then c
+            __m128i use_a = _mm_cmpeq_epi16(smallest, pa);
+            __m128i use_b = _mm_cmpeq_epi16(smallest, pb);
+            __m128i pred  = _mm_or_si128(_mm_and_si128(use_b, b), _mm_andnot_si128(use_b, c));
+            pred = _mm_or_si128(_mm_and_si128(use_a, aw), _mm_andnot_si128(use_a, pred));
+            a = _mm_add_epi8(_mm_packus_epi16(pred, zero), load_px(src + i, bpp));
+            store_px(dst + i, a, bpp);
+            c = b;
+        }
+        break;
+    default:
+        unfilter_scalar(type, dst, src, prev, n, bpp);
+        return;
+    }
+}
+#endif
+
+static void unfilter_row(int type, uint8_t *dst, const uint8_t *src,
+                         const uint8_t *prev, size_t n, int bpp) {
+#ifdef PNG_SSE2
+    if (type != 2) {
+        switch (bpp) {
+        case 1: unfilter_sse2(type, dst, src, prev, n, 1); return;
+        case 2: unfilter_sse2(type, dst, src, prev, n, 2); return;
+        case 3: unfilter_sse2(type, dst, src, prev, n, 3); return;
+        case 4: unfilter_sse2(type, dst, src, prev, n, 4); return;
+        }
+    }
+#endif
+    unfilter_scalar(type, dst, src, prev, n, bpp);
+}
+
+const char *png_unfilter_backend(void) {
+#ifdef PNG_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+/* --- chunks --- */
+
+static inline uint32_t be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static const uint8_t png_signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+/* Signature + IHDR in the first 33 bytes: 1 if this decoder handles it. */
+static int supported_header(const uint8_t *p, size_t len, int *w, int *h,
+                            int *color) {
+    if (len < 33 || memcmp(p, png_signature, 8) != 0) return 0;
+    if (be32(p + 8) != 13 || memcmp(p + 12, "IHDR", 4) != 0) return 0;
+    uint32_t width = be32(p + 16), height = be32(p + 20);
+    int depth = p[24], ct = p[25];
+    if (width == 0 || height == 0 || width > PNG_MAX_DIM || height > PNG_MAX_DIM)
+        return 0;
+    if (depth != 8 || p[26] != 0 || p[27] != 0 || p[28] != 0) return 0;
+    if (ct != 0 && ct != 2 && ct != 3 && ct != 4 && ct != 6) return 0;
+    *w = (int)width;
+    *h = (int)height;
+    *color = ct;
+    return 1;
+}
+
+/* dst may lie below src in the same buffer. */
+static void rgba_to_rgb(uint8_t *dst, const uint8_t *src, int w) {
+    for (int x = 0; x < w; ++x) {
+        dst[3 * x + 0] = src[4 * x + 0];
+        dst[3 * x + 1] = src[4 * x + 1];
+        dst[3 * x + 2] = src[4 * x + 2];
+    }
+}
+
+unsigned char *png_decode_rgb8(const unsigned char *buf, size_t len,
+                               int *width, int *height) {
+    int w, h, ct;
+    if (!buf || !supported_header(buf, len, &w, &h, &ct)) return NULL;
+
+    static const int channels_of[7] = { 1, 0, 3, 1, 2, 0, 4 };
+    int bpp = channels_of[ct];
+    size_t row_bytes = (size_t)w * bpp;
+    if ((size_t)h > (SIZE_MAX - 16) / (row_bytes + 1) / 3) return NULL;
+
+    // gather IDAT payloads into one zlib stream, plus the palette
+    uint8_t palette[256][3];
+    memset(palette, 0, sizeof(palette));
+    int have_palette = 0;
+    size_t z_len = 0, z_cap = 0;
+    uint8_t *z = NULL;
+    size_t pos = 33;
+    int ok = 0;
+    while (pos + 12 <= len) {
+        uint32_t n = be32(buf + pos);
+        const uint8_t *type = buf + pos + 4;
+        const uint8_t *data = buf + pos + 8;
+        if (n > len - pos - 12) break;                // truncated
+        if (memcmp(type, "IDAT", 4) == 0) {
+            if (z_len + n + 16 > z_cap) {
+                size_t cap = (z_cap ? z_cap * 2 : 65536);
+                while (cap < z_len + n + 16) cap *= 2;
+                uint8_t *grown = (uint8_t *)realloc(z, cap);
+                if (!grown) break;
+                z = grown;
+                z_cap = cap;
+            }
+            memcpy(z + z_len, data, n);
+            z_len += n;
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            if (n % 3 != 0 || n > 768) break;
+            for (uint32_t i = 0; i < n / 3; ++i)
+                memcpy(palette[i], data + 3 * i, 3);
+            have_palette = 1;
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            ok = 1;
+            break;
+        } else if (!(type[0] & 32)) {
+            break;                                    // unknown critical chunk
+        }
+        pos += 12 + (size_t)n;
+    }
+    if (!ok || !z_len || (ct == 3 && !have_palette)) {
+        free(z);
+        return NULL;
+    }
+    memset(z + z_len, 0, 16);                         // refill reads ahead
+
+    /*
+     * RGB and RGBA rows are no wider than the filtered rows, so they are
+     * compacted into the inflate buffer itself instead of a second
+     * image-sized allocation (and its page faults). RGBA drops alpha one
+     * row late, once the row below no longer needs it as `prev`.
+     */
+    int in_place = (ct == 2 || ct == 6);
+    size_t raw_len = (row_bytes + 1) * (size_t)h;
+    size_t out_row = (size_t)w * 3;
+    uint8_t *raw = (uint8_t *)malloc(raw_len + 8);
+    uint8_t *out = in_place ? raw : (uint8_t *)malloc(out_row * h);
+    uint8_t *zero_row = (uint8_t *)calloc(row_bytes, 1);
+    int rc = (raw && out && zero_row) ? zlib_inflate(z, z_len, raw, raw_len) : -1;
+    free(z);
+
+    const uint8_t *prev = zero_row;
+    for (int y = 0; y < h && rc == 0; ++y) {
+        uint8_t *row = raw + (size_t)y * (row_bytes + 1);
+        int filter = row[0];
+        if (filter > 4) {
+            rc = -1;
+            break;
+        }
+        uint8_t *dst = out + (size_t)y * out_row;
+        if (ct == 2) {                                 // RGB: straight to output
+            unfilter_row(filter, dst, row + 1, prev, row_bytes, bpp);
+            prev = dst;
+            continue;
+        }
+
+        uint8_t *cur = row + 1;
+        unfilter_row(filter, cur, cur, prev, row_bytes, bpp);
+        if (ct == 6) {
+            if (y > 0) rgba_to_rgb(dst - out_row, prev, w);
+            prev = cur;
+            continue;
+        }
+        prev = cur;
+        switch (ct) {
+        case 0:
+            for (int x = 0; x < w; ++x) dst[3 * x] = dst[3 * x + 1] = dst[3 * x + 2] = cur[x];
+            break;
+        case 3:
+            for (int x = 0; x < w; ++x) memcpy(dst + 3 * x, palette[cur[x]], 3);
+            break;
+        default:                                       // gray + alpha
+            for (int x = 0; x < w; ++x)
+                dst[3 * x] = dst[3 * x + 1] = dst[3 * x + 2] = cur[2 * x];
+            break;
+        }
+    }
+    free(zero_row);
+
+    if (rc != 0) {
+        free(raw);
+        if (out != raw) free(out);
+        return NULL;
+    }
+    if (ct == 6) rgba_to_rgb(out + (size_t)(h - 1) * out_row, prev, w);
+    if (in_place) {
+        uint8_t *shrunk = (uint8_t *)realloc(raw, out_row * h);
+        if (shrunk) out = shrunk;
+    } else {
+        free(raw);
+    }
+    *width = w;
+    *height = h;
+    return out;
+}
+
+unsigned char *png_load_rgb8(const char *path, int *width, int *height) {
+    if (!path) return NULL;
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    // look at the header first: other files go to stb_image unread
+    uint8_t head[33];
+    int w, h, ct;
+    if (fread(head, 1, sizeof(head), f) != sizeof(head) ||
+        !supported_header(head, sizeof(head), &w, &h, &ct) ||
+        fseek(f, 0, SEEK_END) != 0) {
+        fclose(f);
+        return NULL;
+    }
+    long size = ftell(f);
+    uint8_t *buf = (size > 0) ? (uint8_t *)malloc((size_t)size) : NULL;
+    if (!buf || fseek(f, 0, SEEK_SET) != 0 ||
+        fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+
+    unsigned char *rgb = png_decode_rgb8(buf, (size_t)size, width, height);
+    free(buf);
+    return rgb;
+}
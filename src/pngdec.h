@@ -0,0 +1,29 @@
+#ifndef PNGDEC_H
+#define PNGDEC_H
+
+#include <stddef.h>
+
+/**
+ * Fast decoder for the common PNG case: 8-bit, non-interlaced gray,
+ * gray + alpha, RGB, RGBA or palette images. The result is packed RGB,
+ * byte for byte what stbi_load(path, .., 3) returns (alpha dropped,
+ * gray replicated, palette expanded), in a malloc'd buffer.
+ *
+ * Returns NULL for anything else (not a PNG, 1/2/4/16-bit, interlaced,
+ * malformed, out of memory) so the caller can fall back to stb_image,
+ * which also produces the error message.
+ */
+unsigned char *png_load_rgb8(const char *path, int *width, int *height);
+
+/**
+ * Same, for a PNG file already in memory.
+ */
+unsigned char *png_decode_rgb8(const unsigned char *buf, size_t len,
+                               int *width, int *height);
+
+/**
+ * Unfiltering code in use: "sse2" or "scalar".
+ */
+const char *png_unfilter_backend(void);
+
+#endif // PNGDEC_H
@@ -0,0 +1,317 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include "procpool.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/*
+ * MULTI-PROCESS SHARDED MODE
+ * --------------------------
+ *
+ * Threads share one address space and one malloc, so a single bad image
+ * that segfaults takes the whole run down, and all threads contend on
+ * the allocator's arenas. Here each worker is a separate process:
+ *
+ *   shared mapping (MAP_SHARED | MAP_ANONYMOUS, inherited across fork)
+ *   +------+--------------------+---------------+-------------+---------------------+
+ *   | next | ProcWorkerStats[N] | status[count] | busy[count] | owner[count*passes] |
+ *   +------+--------------------+---------------+-------------+---------------------+
+ *
+ * There are count * passes work units; unit u is item u % count.
+ * A worker takes candidate units from __atomic_fetch_add(&next, 1), but
+ * only owns one once a compare-and-swap writes its slot number into the
+ * unit's owner word: the claim and its record are one step. A worker
+ * that dies between the fetch_add and the swap leaves the unit unowned,
+ * and workers that find the counter drained sweep owner[] for such
+ * units, so none is lost.
+ *
+ * busy[item] holds the slot processing the item, so two passes of one
+ * item never write its outputs at the same time; the later pass waits.
+ * The worker then publishes the item in its slot's `current`, processes
+ * it, and marks the unit DONE.
+ *
+ * The parent only waits. When a worker dies from a signal inside fn,
+ * its `current` item is marked POISON; a unit it owned outside fn goes
+ * back to the pool. Either way a fresh worker is forked into the same
+ * slot while units remain. Later passes skip poison items instead of
+ * crashing on them again.
+ */
+
+enum {
+    ITEM_PENDING = 0,
+    ITEM_DONE    = 1,
+    ITEM_FAILED  = 2,
+    ITEM_POISON  = 3
+};
+
+#define UNIT_FREE  0
+#define UNIT_DONE  (-1)    // otherwise: owning slot + 1
+
+typedef struct {
+    long            next;
+    int             count;
+    int             passes;
+    int             workers;
+    size_t          busy_off;    // byte offsets from the start of the map
+    size_t          owner_off;
+    ProcWorkerStats slots[];
+    /* unsigned char status[count], int busy[count] and
+       int owner[count * passes] follow the slots */
+} SharedIndex;
+
+static unsigned char *status_array(SharedIndex *shm) {
+    return (unsigned char *)&shm->slots[shm->workers];
+}
+
+static int *busy_array(SharedIndex *shm) {
+    return (int *)((char *)shm + shm->busy_off);
+}
+
+static int *owner_array(SharedIndex *shm) {
+    return (int *)((char *)shm + shm->owner_off);
+}
+
+static int try_claim(int *owner, int me) {
+    int expected = UNIT_FREE;
+    return __atomic_compare_exchange_n(owner, &expected, me, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Claim the next work unit for slot number `me` (slot + 1). Returns
+ * the unit, or -1 once every unit is owned or done.
+ */
+static long claim_unit(SharedIndex *shm, int me) {
+    int *owner = owner_array(shm);
+    long total = (long)shm->count * shm->passes;
+
+    for (;;) {
+        long unit = __atomic_fetch_add(&shm->next, 1, __ATOMIC_RELAXED);
+        if (unit >= total) break;
+        if (try_claim(&owner[unit], me)) return unit;
+    }
+    // counter drained: pick up units nobody owns (a worker died holding
+    // them, or released by the parent)
+    for (long unit = 0; unit < total; ++unit)
+        if (__atomic_load_n(&owner[unit], __ATOMIC_SEQ_CST) == UNIT_FREE &&
+            try_claim(&owner[unit], me))
+            return unit;
+    return -1;
+}
+
+/* Wait until no other pass is processing item idx, then take it. */
+static void lock_item(SharedIndex *shm, int idx, int me) {
+    int *busy = busy_array(shm);
+    for (;;) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&busy[idx], &expected, me, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+            return;
+        struct timespec pause = { 0, 100000 };   // 0.1 ms
+        nanosleep(&pause, NULL);
+    }
+}
+
+static void worker_main(SharedIndex *shm, int slot, ProcItemFn fn, void *ctx) {
+    ProcWorkerStats *ws = &shm->slots[slot];
+    unsigned char *status = status_array(shm);
+    int *busy  = busy_array(shm);
+    int *owner = owner_array(shm);
+    int me = slot + 1;
+
+    for (;;) {
+        long unit = claim_unit(shm, me);
+        if (unit < 0) break;
+
+        int idx = (int)(unit % shm->count);
+        lock_item(shm, idx, me);
+        if (__atomic_load_n(&status[idx], __ATOMIC_SEQ_CST) == ITEM_POISON) {
+            __atomic_store_n(&owner[unit], UNIT_DONE, __ATOMIC_SEQ_CST);
+            __atomic_store_n(&busy[idx], 0, __ATOMIC_SEQ_CST);
+            continue;
+        }
+
+        __atomic_store_n(&ws->current, idx, __ATOMIC_SEQ_CST);
+
+        double t0 = wall_time();
+        ProcItemResult r;
+        memset(&r, 0, sizeof(r));
+        int rc = fn(idx, ctx, &r);
+        ws->busy_time_sec += wall_time() - t0;
+
+        if (rc == 0) {
+            ws->images_processed += 1;
+            ws->total_pixels     += r.pixels;
+            ws->outputs_written  += r.outputs;
+            ws->hough_votes      += r.hough_votes;
+            ws->hough_sec        += r.hough_sec;
+            if (r.width  > ws->max_width)  ws->max_width  = r.width;
+            if (r.height > ws->max_height) ws->max_height = r.height;
+        } else {
+            ws->images_failed += 1;
+        }
+        unsigned char expected = ITEM_PENDING;   // never overwrite POISON
+        __atomic_compare_exchange_n(&status[idx], &expected,
+                                    rc == 0 ? ITEM_DONE : ITEM_FAILED, 0,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+
+        __atomic_store_n(&ws->current, -1, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&owner[unit], UNIT_DONE, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&busy[idx], 0, __ATOMIC_SEQ_CST);
+    }
+
+    _exit(0);
+}
+
+static pid_t spawn_worker(SharedIndex *shm, int slot, ProcItemFn fn, void *ctx) {
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        worker_main(shm, slot, fn, ctx);
+    }
+    if (pid < 0) {
+        perror("[procpool] fork");
+        return -1;
+    }
+    shm->slots[slot].pid = (int)pid;
+    return pid;
+}
+
+static int slot_of(SharedIndex *shm, pid_t pid) {
+    for (int i = 0; i < shm->workers; ++i)
+        if (shm->slots[i].pid == (int)pid) return i;
+    return -1;
+}
+
+/*
+ * Clean up after the worker in `slot` died: the unit it owned is DONE
+ * if its item was poisoned (crashed inside fn), otherwise free again,
+ * and the item it had locked is released.
+ */
+static void release_dead_worker(SharedIndex *shm, int slot, int poisoned) {
+    int me = slot + 1;
+    int *busy  = busy_array(shm);
+    int *owner = owner_array(shm);
+    long total = (long)shm->count * shm->passes;
+
+    for (long unit = 0; unit < total; ++unit)
+        if (__atomic_load_n(&owner[unit], __ATOMIC_SEQ_CST) == me)
+            __atomic_store_n(&owner[unit], poisoned ? UNIT_DONE : UNIT_FREE,
+                             __ATOMIC_SEQ_CST);
+    for (int i = 0; i < shm->count; ++i)
+        if (__atomic_load_n(&busy[i], __ATOMIC_SEQ_CST) == me)
+            __atomic_store_n(&busy[i], 0, __ATOMIC_SEQ_CST);
+}
+
+/* Whether any unit is still free or owned by a live worker. */
+static int units_left(SharedIndex *shm) {
+    const int *owner = owner_array(shm);
+    long total = (long)shm->count * shm->passes;
+    for (long unit = 0; unit < total; ++unit)
+        if (__atomic_load_n(&owner[unit], __ATOMIC_SEQ_CST) != UNIT_DONE)
+            return 1;
+    return 0;
+}
+
+int procpool_run(int workers, int count, int passes, ProcItemFn fn, void *ctx,
+                 ProcPoolResult *result) {
+    if (!fn || !result || workers < 1 || count < 0 || passes < 1) return -1;
+    memset(result, 0, sizeof(*result));
+
+    size_t status_off = sizeof(SharedIndex) +
+                        (size_t)workers * sizeof(ProcWorkerStats);
+    size_t busy_off   = (status_off + (size_t)count + sizeof(int) - 1) /
+                        sizeof(int) * sizeof(int);
+    size_t owner_off  = busy_off + (size_t)count * sizeof(int);
+    size_t map_size   = owner_off + (size_t)count * passes * sizeof(int);
+    SharedIndex *shm = (SharedIndex *)mmap(NULL, map_size,
+                                           PROT_READ | PROT_WRITE,
+                                           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shm == MAP_FAILED) {
+        perror("[procpool] mmap");
+        return -1;
+    }
+    memset(shm, 0, map_size);
+    shm->count   = count;
+    shm->passes  = passes;
+    shm->workers   = workers;
+    shm->busy_off  = busy_off;
+    shm->owner_off = owner_off;
+    for (int i = 0; i < workers; ++i) shm->slots[i].current = -1;
+
+    int alive = 0;
+    for (int i = 0; i < workers; ++i)
+        if (spawn_worker(shm, i, fn, ctx) > 0) alive++;
+
+    int *poison = NULL;
+    int poison_count = 0;
+    int restarts = 0;
+
+    while (alive > 0) {
+        int wstatus;
+        pid_t pid = waitpid(-1, &wstatus, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        int slot = slot_of(shm, pid);
+        if (slot < 0) continue;
+        alive--;
+
+        if (!WIFSIGNALED(wstatus)) continue;   // normal exit: list drained
+
+        ProcWorkerStats *ws = &shm->slots[slot];
+        ws->crashes++;
+        int bad = __atomic_load_n(&ws->current, __ATOMIC_SEQ_CST);
+        if (bad >= 0) {
+            __atomic_store_n(&status_array(shm)[bad], ITEM_POISON,
+                             __ATOMIC_SEQ_CST);
+            int *grown = (int *)realloc(poison, (poison_count + 1) * sizeof(int));
+            if (grown) {
+                poison = grown;
+                poison[poison_count++] = bad;
+            }
+            ws->current = -1;
+        }
+        release_dead_worker(shm, slot, bad >= 0);
+        fprintf(stderr, "[procpool] Worker %d (pid %d) killed by signal %d "
+                        "on item %d; restarting\n",
+                slot, (int)pid, WTERMSIG(wstatus), bad);
+
+        if (units_left(shm) && spawn_worker(shm, slot, fn, ctx) > 0) {
+            alive++;
+            restarts++;
+        }
+    }
+
+    result->workers      = workers;
+    result->restarts     = restarts;
+    result->poison_count = poison_count;
+    result->poison       = poison;
+    result->per_worker   = (ProcWorkerStats *)malloc(workers * sizeof(ProcWorkerStats));
+    if (result->per_worker)
+        memcpy(result->per_worker, shm->slots, workers * sizeof(ProcWorkerStats));
+
+    munmap(shm, map_size);
+    return 0;
+}
+
+void procpool_result_free(ProcPoolResult *result) {
+    if (!result) return;
+    free(result->poison);
+    free(result->per_worker);
+    memset(result, 0, sizeof(*result));
+}
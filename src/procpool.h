@@ -0,0 +1,63 @@
+#ifndef PROCPOOL_H
+#define PROCPOOL_H
+
+/**
+ * Result of processing one item in a worker process.
+ */
+typedef struct {
+    long long pixels;
+    int       width;
+    int       height;
+    int       outputs;
+    long long hough_votes;      // see PipelineRunStats
+    double    hough_sec;
+} ProcItemResult;
+
+/**
+ * Process item `index`. Return 0 on success (fill *out), -1 if the item
+ * failed cleanly. A crash (signal) is handled by the pool instead.
+ */
+typedef int (*ProcItemFn)(int index, void *ctx, ProcItemResult *out);
+
+/**
+ * Per-worker counters, kept in the shared region and merged at the end.
+ */
+typedef struct {
+    int       pid;
+    int       current;          // index being processed, -1 when idle
+    int       images_processed;
+    int       images_failed;
+    int       crashes;          // times this slot's process died
+    long long total_pixels;
+    long long outputs_written;
+    int       max_width;
+    int       max_height;
+    double    busy_time_sec;
+    long long hough_votes;
+    double    hough_sec;
+} ProcWorkerStats;
+
+typedef struct {
+    int              workers;
+    int              restarts;
+    int              poison_count;
+    int             *poison;        // indices of items that crashed a worker
+    ProcWorkerStats *per_worker;    // `workers` entries
+} ProcPoolResult;
+
+/**
+ * Fork `workers` processes that claim items 0..count-1 (`passes` times
+ * over) through an atomic counter in a shared anonymous mapping and run
+ * fn on each. Passes of one item never run at the same time. A worker
+ * killed by a signal is restarted; the item it was processing is marked
+ * as poison and never retried, in any pass, and work it had claimed but
+ * not started is handed out again.
+ * Returns 0 on success, -1 on setup error.
+ * Free the result with procpool_result_free().
+ */
+int procpool_run(int workers, int count, int passes, ProcItemFn fn, void *ctx,
+                 ProcPoolResult *result);
+
+void procpool_result_free(ProcPoolResult *result);
+
+#endif // PROCPOOL_H
@@ -0,0 +1,398 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "filters.h"
+
+#include <string.h>
+
+/*
+ * PYTHON BINDINGS (module `imgfilters`)
+ * -------------------------------------
+ *
+ * Exposes the filters of filters.c to Python without copying pixels:
+ *
+ *   - Filters take any writable, C-contiguous (height, width, 3) buffer
+ *     of uint8 ("B"), uint16 ("H") or float32 ("f") samples, e.g. a
+ *     NumPy array. An Image header is pointed at the buffer memory and
+ *     the filter runs in place on it.
+ *   - load() returns an imgfilters.Image, which owns the decoded pixels
+ *     and exports them through the buffer protocol. numpy.asarray(img)
+ *     is a view of that memory, not a copy.
+ *
+ * The GIL is released around every decode, filter and encode, so
+ * several Python threads run the kernels concurrently. The module
+ * does not need NumPy at build time; any buffer exporter works.
+ */
+
+/* --- imgfilters.Image: owns a decoded Image, exports its pixels --- */
+
+typedef struct {
+    PyObject_HEAD
+    Image      *img;
+    Py_ssize_t  shape[3];
+    Py_ssize_t  strides[3];
+} PyImage;
+
+static const char *format_of(SampleType type) {
+    switch (type) {
+    case SAMPLE_U16: return "H";
+    case SAMPLE_F32: return "f";
+    default:         return "B";
+    }
+}
+
+static void PyImage_dealloc(PyImage *self) {
+    free_image(self->img);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int PyImage_getbuffer(PyImage *self, Py_buffer *view, int flags) {
+    Image *img = self->img;
+    view->obj        = (PyObject *)self;
+    view->buf        = img->data;
+    view->len        = (Py_ssize_t)image_bytes(img);
+    view->readonly   = 0;
+    view->itemsize   = (Py_ssize_t)sample_size(img->type);
+    view->format     = (flags & PyBUF_FORMAT) ? (char *)format_of(img->type) : NULL;
+    view->ndim       = (flags & PyBUF_ND) ? 3 : 1;
+    view->shape      = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides    = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal   = NULL;
+    Py_INCREF(self);
+    return 0;
+}
+
+static PyBufferProcs PyImage_as_buffer = {
+    (getbufferproc)PyImage_getbuffer,
+    NULL,
+};
+
+static PyObject *PyImage_get_width(PyImage *self, void *closure) {
+    (void)closure;
+    return PyLong_FromLong(self->img->width);
+}
+
+static PyObject *PyImage_get_height(PyImage *self, void *closure) {
+    (void)closure;
+    return PyLong_FromLong(self->img->height);
+}
+
+static PyObject *PyImage_get_type(PyImage *self, void *closure) {
+    (void)closure;
+    return PyUnicode_FromString(sample_type_name(self->img->type));
+}
+
+static PyGetSetDef PyImage_getset[] = {
+    {"width",  (getter)PyImage_get_width,  NULL, "Width in pixels.", NULL},
+    {"height", (getter)PyImage_get_height, NULL, "Height in pixels.", NULL},
+    {"type",   (getter)PyImage_get_type,   NULL, "Sample type: 'u8', 'u16' or 'f32'.", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject PyImageType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "imgfilters.Image",
+    .tp_basicsize = sizeof(PyImage),
+    .tp_dealloc   = (destructor)PyImage_dealloc,
+    .tp_as_buffer = &PyImage_as_buffer,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "Decoded RGB image; exports its pixels as a (height, width, 3) buffer.",
+    .tp_getset    = PyImage_getset,
+};
+
+/* --- borrowing caller buffers --- */
+
+/*
+ * Acquire a C-contiguous (height, width, 3) buffer and describe it as an
+ * Image header over the same memory. On success the caller must
+ * PyBuffer_Release(view).
+ */
+static int borrow_image(PyObject *obj, Py_buffer *view, Image *img, int writable) {
+    int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+    if (writable) flags |= PyBUF_WRITABLE;
+    if (PyObject_GetBuffer(obj, view, flags) != 0)
+        return -1;
+
+    const char *fmt = view->format ? view->format : "B";
+    // '=' and '<' are native on the little-endian hosts we build for
+    if (*fmt == '@' || *fmt == '=' || *fmt == '<') fmt++;
+
+    SampleType type;
+    if      (strcmp(fmt, "B") == 0 && view->itemsize == 1) type = SAMPLE_U8;
+    else if (strcmp(fmt, "H") == 0 && view->itemsize == 2) type = SAMPLE_U16;
+    else if (strcmp(fmt, "f") == 0 && view->itemsize == 4) type = SAMPLE_F32;
+    else {
+        PyErr_Format(PyExc_TypeError,
+                     "expected uint8, uint16 or float32 samples, got format '%s'",
+                     view->format ? view->format : "B");
+        PyBuffer_Release(view);
+        return -1;
+    }
+
+    if (view->ndim != 3 || view->shape[2] != 3 ||
+        view->shape[0] > INT_MAX || view->shape[1] > INT_MAX) {
+        PyErr_SetString(PyExc_ValueError,
+                        "expected a (height, width, 3) RGB buffer");
+        PyBuffer_Release(view);
+        return -1;
+    }
+
+    img->width    = (int)view->shape[1];
+    img->height   = (int)view->shape[0];
+    img->channels = 3;
+    img->type     = type;
+    img->data     = (unsigned char *)view->buf;
+    return 0;
+}
+
+/* --- module functions --- */
+
+static PyObject *py_load(PyObject *self, PyObject *args, PyObject *kwargs) {
+    (void)self;
+    static char *kwlist[] = {"path", "type", NULL};
+    PyObject *path_obj;
+    const char *type_name = "u8";
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O&|s", kwlist,
+                                     PyUnicode_FSConverter, &path_obj, &type_name))
+        return NULL;
+
+    SampleType type;
+    if (parse_sample_type(type_name, &type) != 0) {
+        Py_DECREF(path_obj);
+        PyErr_Format(PyExc_ValueError, "unknown sample type '%s'", type_name);
+        return NULL;
+    }
+
+    const char *path = PyBytes_AS_STRING(path_obj);
+    Image *img;
+    Py_BEGIN_ALLOW_THREADS
+    img = load_image_typed(path, type);
+    Py_END_ALLOW_THREADS
+    if (!img) {
+        PyErr_Format(PyExc_OSError, "failed to load image: %s", path);
+        Py_DECREF(path_obj);
+        return NULL;
+    }
+    Py_DECREF(path_obj);
+
+    PyImage *obj = PyObject_New(PyImage, &PyImageType);
+    if (!obj) {
+        free_image(img);
+        return NULL;
+    }
+    Py_ssize_t item = (Py_ssize_t)sample_size(type);
+    obj->img        = img;
+    obj->shape[0]   = img->height;
+    obj->shape[1]   = img->width;
+    obj->shape[2]   = 3;
+    obj->strides[2] = item;
+    obj->strides[1] = 3 * item;
+    obj->strides[0] = (Py_ssize_t)img->width * 3 * item;
+    return (PyObject *)obj;
+}
+
+static PyObject *py_info(PyObject *self, PyObject *args) {
+    (void)self;
+    PyObject *path_obj;
+    if (!PyArg_ParseTuple(args, "O&", PyUnicode_FSConverter, &path_obj))
+        return NULL;
+
+    int w = 0, h = 0, rc;
+    const char *path = PyBytes_AS_STRING(path_obj);
+    Py_BEGIN_ALLOW_THREADS
+    rc = image_info(path, &w, &h);
+    Py_END_ALLOW_THREADS
+    if (rc != 0) {
+        PyErr_Format(PyExc_OSError, "cannot read image header: %s", path);
+        Py_DECREF(path_obj);
+        return NULL;
+    }
+    Py_DECREF(path_obj);
+    return Py_BuildValue("(ii)", w, h);
+}
+
+static PyObject *py_save_png(PyObject *self, PyObject *args) {
+    (void)self;
+    PyObject *path_obj, *obj;
+    if (!PyArg_ParseTuple(args, "O&O", PyUnicode_FSConverter, &path_obj, &obj))
+        return NULL;
+
+    Py_buffer view;
+    Image img;
+    if (borrow_image(obj, &view, &img, 0) != 0) {
+        Py_DECREF(path_obj);
+        return NULL;
+    }
+
+    int rc;
+    const char *path = PyBytes_AS_STRING(path_obj);
+    Py_BEGIN_ALLOW_THREADS
+    rc = save_image_png(path, &img);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    if (rc != 0) {
+        PyErr_Format(PyExc_OSError, "failed to save PNG: %s", path);
+        Py_DECREF(path_obj);
+        return NULL;
+    }
+    Py_DECREF(path_obj);
+    Py_RETURN_NONE;
+}
+
+/* Run one in-place filter on a borrowed buffer and return the buffer. */
+static PyObject *run_filter(PyObject *obj, void (*fn)(Image *, int), int param) {
+    Py_buffer view;
+    Image img;
+    if (borrow_image(obj, &view, &img, 1) != 0) return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    fn(&img, param);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+
+    Py_INCREF(obj);
+    return obj;
+}
+
+static void grayscale_fn(Image *img, int unused) { (void)unused; apply_grayscale(img); }
+static void sobel_fn(Image *img, int unused)     { (void)unused; apply_sobel_edge(img); }
+static void box_blur_fn(Image *img, int radius)  { apply_box_blur(img, radius); }
+
+static PyObject *py_grayscale(PyObject *self, PyObject *obj) {
+    (void)self;
+    return run_filter(obj, grayscale_fn, 0);
+}
+
+static PyObject *py_sobel(PyObject *self, PyObject *obj) {
+    (void)self;
+    return run_filter(obj, sobel_fn, 0);
+}
+
+static PyObject *py_box_blur(PyObject *self, PyObject *args, PyObject *kwargs) {
+    (void)self;
+    static char *kwlist[] = {"image", "radius", NULL};
+    PyObject *obj;
+    int radius = 2;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", kwlist, &obj, &radius))
+        return NULL;
+    if (radius < 0) {
+        PyErr_SetString(PyExc_ValueError, "radius must be >= 0");
+        return NULL;
+    }
+    return run_filter(obj, box_blur_fn, radius);
+}
+
+static PyObject *py_pipeline_batch(PyObject *self, PyObject *args, PyObject *kwargs) {
+    (void)self;
+    static char *kwlist[] = {"images", "radius", NULL};
+    PyObject *seq_obj;
+    int radius = 2;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", kwlist, &seq_obj, &radius))
+        return NULL;
+    if (radius < 0) {
+        PyErr_SetString(PyExc_ValueError, "radius must be >= 0");
+        return NULL;
+    }
+
+    PyObject *seq = PySequence_Fast(seq_obj, "images must be a sequence");
+    if (!seq) return NULL;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    if (n > INT_MAX) {
+        Py_DECREF(seq);
+        PyErr_SetString(PyExc_ValueError, "too many images");
+        return NULL;
+    }
+    if (n == 0) {
+        Py_DECREF(seq);
+        Py_INCREF(seq_obj);
+        return seq_obj;
+    }
+
+    Py_buffer *views = (Py_buffer *)PyMem_Calloc((size_t)n, sizeof(Py_buffer));
+    Image *imgs      = (Image *)PyMem_Calloc((size_t)n, sizeof(Image));
+    Image **ptrs     = (Image **)PyMem_Calloc((size_t)n, sizeof(Image *));
+    if (!views || !imgs || !ptrs) {
+        PyMem_Free(views); PyMem_Free(imgs); PyMem_Free(ptrs);
+        Py_DECREF(seq);
+        return PyErr_NoMemory();
+    }
+
+    Py_ssize_t acquired = 0;
+    int rc = -1;
+    for (; acquired < n; ++acquired) {
+        PyObject *item = PySequence_Fast_GET_ITEM(seq, acquired);
+        if (borrow_image(item, &views[acquired], &imgs[acquired], 1) != 0)
+            goto done;
+        if (imgs[acquired].type != SAMPLE_U8) {
+            PyBuffer_Release(&views[acquired]);
+            PyErr_SetString(PyExc_TypeError,
+                            "pipeline_batch needs uint8 images");
+            goto done;
+        }
+        ptrs[acquired] = &imgs[acquired];
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    rc = apply_pipeline_batch(ptrs, (int)n, radius);
+    Py_END_ALLOW_THREADS
+    if (rc != 0) PyErr_NoMemory();
+
+done:
+    for (Py_ssize_t i = 0; i < acquired; ++i) PyBuffer_Release(&views[i]);
+    PyMem_Free(views);
+    PyMem_Free(imgs);
+    PyMem_Free(ptrs);
+    Py_DECREF(seq);
+    if (rc != 0) return NULL;
+    Py_INCREF(seq_obj);
+    return seq_obj;
+}
+
+static PyMethodDef imgfilters_methods[] = {
+    {"load", (PyCFunction)(void (*)(void))py_load, METH_VARARGS | METH_KEYWORDS,
+     "load(path, type='u8') -> Image\n\n"
+     "Decode an image file as RGB samples of type 'u8', 'u16' or 'f32'."},
+    {"info", py_info, METH_VARARGS,
+     "info(path) -> (width, height)\n\nRead the image header without decoding."},
+    {"save_png", py_save_png, METH_VARARGS,
+     "save_png(path, image)\n\n"
+     "Write a (height, width, 3) buffer as PNG (16-bit for uint16/float32)."},
+    {"grayscale", py_grayscale, METH_O,
+     "grayscale(image) -> image\n\nIn-place luminance conversion."},
+    {"box_blur", (PyCFunction)(void (*)(void))py_box_blur, METH_VARARGS | METH_KEYWORDS,
+     "box_blur(image, radius=2) -> image\n\nIn-place box blur."},
+    {"sobel", py_sobel, METH_O,
+     "sobel(image) -> image\n\nIn-place Sobel edge magnitude."},
+    {"pipeline_batch", (PyCFunction)(void (*)(void))py_pipeline_batch,
+     METH_VARARGS | METH_KEYWORDS,
+     "pipeline_batch(images, radius=2) -> images\n\n"
+     "Run grayscale -> box_blur(radius) -> sobel in place on a sequence of\n"
+     "uint8 images in one batched pass (see apply_pipeline_batch)."},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef imgfilters_module = {
+    PyModuleDef_HEAD_INIT,
+    "imgfilters",
+    "Zero-copy bindings for the image filters. Functions release the GIL\n"
+    "while they run, so calls from several threads execute in parallel.",
+    -1,
+    imgfilters_methods,
+    NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_imgfilters(void) {
+    if (PyType_Ready(&PyImageType) < 0) return NULL;
+
+    PyObject *m = PyModule_Create(&imgfilters_module);
+    if (!m) return NULL;
+
+    Py_INCREF(&PyImageType);
+    if (PyModule_AddObject(m, "Image", (PyObject *)&PyImageType) < 0) {
+        Py_DECREF(&PyImageType);
+        Py_DECREF(m);
+        return NULL;
+    }
+    return m;
+}
@@ -8,6 +8,9 @@
 #include <stddef.h>
 #include "filters.h"
 #include "timer.h"
+#include "pagecache.h"
+#include "energy.h"
+#include "jsonout.h"
 #include <strings.h>  
 typedef struct {
     int images_processed;
@@ -22,6 +25,20 @@ typedef struct {
     double cycles_per_pixel;
     int max_width;
     int max_height;
+    SampleType sample_type;
+    PageCacheMode page_cache;
+    int io_available;
+    long long io_read_bytes;
+    long long io_write_bytes;
+    long long io_rchar;
+    int energy_available;
+    double energy_package_j;
+    double energy_dram_j;
+    double energy_total_j;
+    double joules_per_image;
+    double joules_per_megapixel;
+    double avg_power_w;
+    double energy_delay_product;   // J * s
 } Metrics;
 
 static int ends_with(const char *name, const char *ext) {
@@ -66,8 +83,11 @@ static void write_serial_metrics_json(const char *json_path,
 
     fprintf(f, "{\n");
     fprintf(f, "  \"variant\": \"serial\",\n");
-    fprintf(f, "  \"input_dir\": \"%s\",\n", input_dir);
-    fprintf(f, "  \"output_dir\": \"%s\",\n", output_dir);
+    fprintf(f, "  \"input_dir\": ");
+    write_json_string(f, input_dir);
+    fprintf(f, ",\n  \"output_dir\": ");
+    write_json_string(f, output_dir);
+    fprintf(f, ",\n");
     fprintf(f, "  \"metrics\": {\n");
     fprintf(f, "    \"images_processed\": %d,\n", m->images_processed);
     fprintf(f, "    \"total_pixels\": %lld,\n", m->total_pixels);
@@ -81,7 +101,21 @@ static void write_serial_metrics_json(const char *json_path,
     fprintf(f, "    \"cycles_per_image\": %.3f,\n", m->cycles_per_image);
     fprintf(f, "    \"cycles_per_pixel\": %.3f,\n", m->cycles_per_pixel);
     fprintf(f, "    \"max_width\": %d,\n", m->max_width);
-    fprintf(f, "    \"max_height\": %d\n", m->max_height);
+    fprintf(f, "    \"max_height\": %d,\n", m->max_height);
+    fprintf(f, "    \"sample_type\": \"%s\",\n", sample_type_name(m->sample_type));
+    fprintf(f, "    \"page_cache_mode\": \"%s\",\n", page_cache_mode_name(m->page_cache));
+    fprintf(f, "    \"io_available\": %s,\n", m->io_available ? "true" : "false");
+    fprintf(f, "    \"io_read_bytes\": %lld,\n", m->io_read_bytes);
+    fprintf(f, "    \"io_write_bytes\": %lld,\n", m->io_write_bytes);
+    fprintf(f, "    \"io_rchar\": %lld,\n", m->io_rchar);
+    fprintf(f, "    \"energy_available\": %s,\n", m->energy_available ? "true" : "false");
+    fprintf(f, "    \"energy_package_j\": %.6f,\n", m->energy_package_j);
+    fprintf(f, "    \"energy_dram_j\": %.6f,\n", m->energy_dram_j);
+    fprintf(f, "    \"energy_total_j\": %.6f,\n", m->energy_total_j);
+    fprintf(f, "    \"joules_per_image\": %.9f,\n", m->joules_per_image);
+    fprintf(f, "    \"joules_per_megapixel\": %.9f,\n", m->joules_per_megapixel);
+    fprintf(f, "    \"avg_power_w\": %.6f,\n", m->avg_power_w);
+    fprintf(f, "    \"energy_delay_product\": %.9f\n", m->energy_delay_product);
     fprintf(f, "  }\n");
     fprintf(f, "}\n");
 
@@ -89,12 +123,44 @@ static void write_serial_metrics_json(const char *json_path,
     printf("[serial] Metrics written to %s\n", json_path);
 }
 
+/*
+ * Warm: read every input. Cold: drop every input and output from the
+ * page cache. Runs before the timers start.
+ */
+static void prepare_page_cache(DIR *dir, const char *input_dir,
+                               const char *output_dir, PageCacheMode mode) {
+    if (mode == PAGE_CACHE_NONE) return;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (!is_image_file(ent->d_name))
+            continue;
+
+        char in_path[512];
+        char out_path[512];
+        snprintf(in_path, sizeof(in_path), "%s/%s", input_dir, ent->d_name);
+        snprintf(out_path, sizeof(out_path), "%s/%s", output_dir, ent->d_name);
+
+        if (mode == PAGE_CACHE_WARM) {
+            page_cache_warm(in_path);
+        } else {
+            page_cache_evict(in_path);
+            page_cache_evict(out_path);
+        }
+    }
+    rewinddir(dir);
+}
+
 static void process_directory_serial(const char *input_dir,
                                      const char *output_dir,
+                                     SampleType sample_type,
+                                     PageCacheMode page_cache,
                                      Metrics *metrics) {
     memset(metrics, 0, sizeof(*metrics));
     metrics->max_width = 0;
     metrics->max_height = 0;
+    metrics->sample_type = sample_type;
+    metrics->page_cache = page_cache;
 
     ensure_directory(output_dir);
 
@@ -104,6 +170,16 @@ static void process_directory_serial(const char *input_dir,
         return;
     }
 
+    prepare_page_cache(dir, input_dir, output_dir, page_cache);
+
+    IoCounters io_before, io_after;
+    io_counters_read(&io_before);
+
+    EnergyMeter meter;
+    EnergyReading energy = {0};
+    energy_open(&meter);
+    energy_begin(&meter);
+
     double user_before, sys_before, user_after, sys_after;
     get_cpu_times(&user_before, &sys_before);
     double t_start = wall_time();
@@ -121,7 +197,7 @@ static void process_directory_serial(const char *input_dir,
         snprintf(in_path, sizeof(in_path), "%s/%s", input_dir, ent->d_name);
         snprintf(out_path, sizeof(out_path), "%s/%s", output_dir, ent->d_name);
 
-        Image *img = load_image(in_path);
+        Image *img = load_image_typed(in_path, sample_type);
         if (!img) {
             fprintf(stderr, "[serial] Skip failed load: %s\n", in_path);
             continue;
@@ -152,6 +228,15 @@ static void process_directory_serial(const char *input_dir,
     uint64_t c_end = read_tsc();
     double t_end = wall_time();
     get_cpu_times(&user_after, &sys_after);
+    energy_end(&meter, &energy);
+    energy_close(&meter);
+
+    if (io_counters_read(&io_after) == 0 && io_before.available) {
+        metrics->io_available   = 1;
+        metrics->io_read_bytes  = io_after.read_bytes  - io_before.read_bytes;
+        metrics->io_write_bytes = io_after.write_bytes - io_before.write_bytes;
+        metrics->io_rchar       = io_after.rchar       - io_before.rchar;
+    }
 
     metrics->wall_time_sec      = t_end - t_start;
     metrics->cpu_user_time_sec  = user_after - user_before;
@@ -177,17 +262,55 @@ static void process_directory_serial(const char *input_dir,
         metrics->avg_time_per_pixel_ns = 0.0;
         metrics->cycles_per_pixel = 0.0;
     }
+
+    // Energy per unit of work and energy-delay product (lower is better)
+    if (energy.available) {
+        metrics->energy_available     = 1;
+        metrics->energy_package_j     = energy.package_j;
+        metrics->energy_dram_j        = energy.dram_j;
+        metrics->energy_total_j       = energy.total_j;
+        metrics->energy_delay_product = energy.total_j * metrics->wall_time_sec;
+        if (metrics->wall_time_sec > 0.0)
+            metrics->avg_power_w = energy.total_j / metrics->wall_time_sec;
+        if (metrics->images_processed > 0)
+            metrics->joules_per_image = energy.total_j / metrics->images_processed;
+        if (metrics->total_pixels > 0)
+            metrics->joules_per_megapixel =
+                energy.total_j * 1e6 / (double)metrics->total_pixels;
+    }
 }
 
 int main(int argc, char **argv) {
     const char *input_dir = "data/input";
     const char *output_dir = "data/output_serial";
 
-    if (argc >= 2) input_dir = argv[1];
-    if (argc >= 3) output_dir = argv[2];
+    PageCacheMode page_cache = PAGE_CACHE_NONE;
+    SampleType sample_type = SAMPLE_U8;
+
+    // serial [input_dir] [output_dir] [--page-cache none|warm|cold]
+    //        [--depth u8|u16|f32]
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            if (parse_sample_type(argv[++i], &sample_type) != 0)
+                fprintf(stderr, "[serial] Unknown --depth %s (u8|u16|f32)\n", argv[i]);
+        } else if (strcmp(argv[i], "--page-cache") == 0 && i + 1 < argc) {
+            if (parse_page_cache_mode(argv[++i], &page_cache) != 0)
+                fprintf(stderr, "[serial] Unknown --page-cache %s "
+                                "(none|warm|cold)\n", argv[i]);
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            fprintf(stderr, "[serial] Unknown option: %s\n", argv[i]);
+        } else if (positional == 0) {
+            input_dir = argv[i];
+            positional++;
+        } else if (positional == 1) {
+            output_dir = argv[i];
+            positional++;
+        }
+    }
 
     Metrics m;
-    process_directory_serial(input_dir, output_dir, &m);
+    process_directory_serial(input_dir, output_dir, sample_type, page_cache, &m);
 
     printf("[serial] Images processed : %d\n", m.images_processed);
     printf("[serial] Total pixels     : %lld\n", m.total_pixels);
@@ -196,6 +319,14 @@ int main(int argc, char **argv) {
     printf("[serial] CPU sys  time(s) : %.6f\n", m.cpu_system_time_sec);
     printf("[serial] CPU cycles       : %llu\n",
            (unsigned long long)m.cpu_cycles);
+    printf("[serial] Sample type      : %s\n", sample_type_name(m.sample_type));
+    printf("[serial] Page cache       : %s, %lld bytes read from storage\n",
+           page_cache_mode_name(m.page_cache), m.io_read_bytes);
+    if (m.energy_available)
+        printf("[serial] Energy           : %.3f J (%.6f J/image, %.1f W)\n",
+               m.energy_total_j, m.joules_per_image, m.avg_power_w);
+    else
+        printf("[serial] Energy           : unavailable\n");
 
     write_serial_metrics_json("results/logs/serial_metrics.json",
                               &m, input_dir, output_dir);
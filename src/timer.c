@@ -31,6 +31,18 @@ void get_cpu_times(double *user_sec, double *sys_sec) {
                 (double)ru.ru_stime.tv_usec * 1e-6;
 }
 
+void get_children_cpu_times(double *user_sec, double *sys_sec) {
+    if (!user_sec || !sys_sec) return;
+
+    struct rusage ru;
+    getrusage(RUSAGE_CHILDREN, &ru);
+
+    *user_sec = (double)ru.ru_utime.tv_sec +
+                (double)ru.ru_utime.tv_usec * 1e-6;
+    *sys_sec  = (double)ru.ru_stime.tv_sec +
+                (double)ru.ru_stime.tv_usec * 1e-6;
+}
+
 uint64_t read_tsc() {
 #if defined(__x86_64__) || defined(__i386__)
     unsigned int lo, hi;
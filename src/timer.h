@@ -13,6 +13,12 @@ double wall_time();
  */
 void get_cpu_times(double *user_sec, double *sys_sec);
 
+/**
+ * Get CPU user and system times (in seconds) of terminated, waited-for
+ * child processes (multi-process mode).
+ */
+void get_children_cpu_times(double *user_sec, double *sys_sec);
+
 /**
  * Read CPU cycle counter (TSC on x86). On non-x86, falls back to
  * a nanosecond-based monotonic clock.